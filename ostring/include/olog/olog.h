@@ -0,0 +1,277 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <spdlog/common.h>
+
+#include "ostring/definitions.h"
+#include "ostring/deferred.h"
+
+// Asynchronous logging on top of ofmt and spdlog.
+// A call only captures its arguments as an ofmt::deferred blob in a ring buffer owned by the calling thread,
+// a background thread renders them with ofmt, transcodes to utf-8 once and feeds the sinks.
+//
+// olog::init_log_system();
+// olog::info(u"{0} joined, {1} players online", name, count);
+// LOG_FFL olog::error("lost connection");
+
+namespace olog {
+
+	enum class level : uint8_t
+	{
+		verbose,
+		debug,
+		info,
+		warn,
+		error,
+		fatal,
+		off
+	};
+
+	// what a call does when the queue of its thread is full
+	enum class overflow_policy : uint8_t
+	{
+		// wait for the background thread, nothing is lost
+		block,
+		// give up the record, dropped records are counted and reported
+		drop
+	};
+
+	struct log_options
+	{
+		// bytes of the queue of every thread, rounded up to a power of two,
+		// applies to threads which log for the first time after init
+		size_t queue_capacity = 1 << 20;
+		overflow_policy policy = overflow_policy::block;
+		level min_level = level::verbose;
+		// spdlog pattern set to every sink, kept as is when empty
+		std::string pattern;
+		// colored stdout when empty, sinks are only touched by the background thread
+		std::vector<spdlog::sink_ptr> sinks;
+	};
+
+	// (re)start the background thread, records pending from a previous init are flushed first
+	// logging without init starts it with default options
+	OPEN_STRING_EXPORT void init_log_system(log_options options = {});
+
+	// render every pending record then stop the background thread, later calls are ignored
+	OPEN_STRING_EXPORT void shutdown_log_system();
+
+	// block until records logged by this thread before the call reach the sinks, then flush the sinks
+	OPEN_STRING_EXPORT void flush();
+
+	OPEN_STRING_EXPORT void set_level(level lvl);
+
+	OPEN_STRING_EXPORT level get_level();
+
+	// records given up by overflow_policy::drop since the start of the process
+	OPEN_STRING_EXPORT uint64_t dropped_count();
+
+	namespace detail {
+
+		struct source_location
+		{
+			const char* file = nullptr;
+			int line = 0;
+			const char* function = nullptr;
+		};
+
+		// records and their payloads are aligned to this in the ring
+		constexpr size_t record_align = ostr::ofmt::deferred_align;
+
+		struct record_header
+		{
+			// of the whole record with padding
+			uint32_t size;
+			level lvl;
+			// renders the payload, a deferred blob
+			// nullptr for the filler before the ring wraps, only size and ops are written then
+			const ostr::ofmt::deferred_ops* ops;
+			// nanoseconds since epoch of system_clock
+			int64_t time;
+			source_location source;
+		};
+
+		static_assert(offsetof(record_header, ops) + sizeof(record_header::ops) <= record_align, "filler must fit the smallest gap.");
+
+		constexpr size_t payload_offset = ostr::ofmt::align_up(sizeof(record_header), record_align);
+
+		// single producer single consumer ring of records, one per logging thread
+		class OPEN_STRING_EXPORT thread_queue
+		{
+		public:
+
+			thread_queue(size_t capacity, overflow_policy policy, const std::atomic<level>* min_level);
+			~thread_queue();
+
+			thread_queue(const thread_queue&) = delete;
+			thread_queue& operator=(const thread_queue&) = delete;
+
+			[[nodiscard]] size_t capacity() const noexcept
+			{
+				return _capacity;
+			}
+
+			[[nodiscard]] level min_level() const noexcept
+			{
+				return _min_level->load(std::memory_order_relaxed);
+			}
+
+			// producer side
+			// @param size: multiple of record_align.
+			// @return: nullptr if the ring is full now.
+			std::byte* try_reserve(size_t size) noexcept
+			{
+				const size_t tail = _tail.load(std::memory_order_relaxed);
+				const size_t offset = tail & (_capacity - 1);
+				const size_t to_end = _capacity - offset;
+				const size_t needed = size <= to_end ? size : to_end + size;
+
+				if (needed > _capacity - (tail - _cached_head))
+				{
+					_cached_head = _head.load(std::memory_order_acquire);
+					if (needed > _capacity - (tail - _cached_head))
+						return nullptr;
+				}
+
+				if (size > to_end)
+				{
+					auto filler = reinterpret_cast<record_header*>(_buffer + offset);
+					filler->size = uint32_t(to_end);
+					filler->ops = nullptr;
+					_reserved_tail = tail + to_end + size;
+					return _buffer;
+				}
+				_reserved_tail = tail + size;
+				return _buffer + offset;
+			}
+
+			void commit() noexcept
+			{
+				_tail.store(_reserved_tail, std::memory_order_release);
+			}
+
+			// block or drop according to the policy once try_reserve failed
+			// @return: nullptr when dropped.
+			std::byte* reserve_slow(size_t size);
+
+			// consumer side
+			// @return: nullptr if empty.
+			record_header* front() noexcept;
+			void pop() noexcept;
+
+			[[nodiscard]] size_t head_position() const noexcept
+			{
+				return _head.load(std::memory_order_acquire);
+			}
+
+			[[nodiscard]] size_t tail_position() const noexcept
+			{
+				return _tail.load(std::memory_order_acquire);
+			}
+
+			// set by LOG_FFL, taken by the next call on the thread
+			source_location source;
+			size_t thread_id = 0;
+			overflow_policy policy;
+			std::atomic<uint64_t> dropped{ 0 };
+			// the owner thread exited, removed once drained
+			std::atomic<bool> closed{ false };
+
+		private:
+
+			std::byte* _buffer;
+			size_t _capacity;
+			const std::atomic<level>* _min_level;
+
+			alignas(64) std::atomic<size_t> _head{ 0 };
+			alignas(64) std::atomic<size_t> _tail{ 0 };
+			size_t _cached_head = 0;
+			size_t _reserved_tail = 0;
+		};
+
+		// the queue of the calling thread, created on first use
+		OPEN_STRING_EXPORT thread_queue* local_queue();
+	}
+
+	template<typename Fmt, typename...Args>
+	inline void log(level lvl, const Fmt& fmt, Args&&...args)
+	{
+		using blob_type = ostr::ofmt::deferred_blob<ostr::ofmt::captured_t<Fmt>, ostr::ofmt::captured_t<Args>...>;
+
+		detail::thread_queue* queue = detail::local_queue();
+		const detail::source_location source = std::exchange(queue->source, detail::source_location{});
+		if (lvl < queue->min_level())
+			return;
+
+		const ostr::ofmt::captured_t<Fmt>& fmt_arg = fmt;
+		const auto layout = blob_type::measure(fmt_arg, args...);
+		const size_t size = detail::payload_offset + layout.size;
+
+		std::byte* p = queue->try_reserve(size);
+		if (!p)
+		{
+			p = queue->reserve_slow(size);
+			if (!p) return;
+		}
+
+		auto header = reinterpret_cast<detail::record_header*>(p);
+		header->size = uint32_t(size);
+		header->lvl = lvl;
+		header->time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		header->source = source;
+		header->ops = blob_type::write(p + detail::payload_offset, layout, fmt_arg, std::forward<Args>(args)...);
+
+		queue->commit();
+		if (lvl == level::fatal)
+			flush();
+	}
+
+	template<typename Fmt, typename...Args>
+	inline void verbose(const Fmt& fmt, Args&&...args)
+	{
+		log(level::verbose, fmt, std::forward<Args>(args)...);
+	}
+
+	template<typename Fmt, typename...Args>
+	inline void debug(const Fmt& fmt, Args&&...args)
+	{
+		log(level::debug, fmt, std::forward<Args>(args)...);
+	}
+
+	template<typename Fmt, typename...Args>
+	inline void info(const Fmt& fmt, Args&&...args)
+	{
+		log(level::info, fmt, std::forward<Args>(args)...);
+	}
+
+	template<typename Fmt, typename...Args>
+	inline void warn(const Fmt& fmt, Args&&...args)
+	{
+		log(level::warn, fmt, std::forward<Args>(args)...);
+	}
+
+	template<typename Fmt, typename...Args>
+	inline void error(const Fmt& fmt, Args&&...args)
+	{
+		log(level::error, fmt, std::forward<Args>(args)...);
+	}
+
+	// flushes before returning
+	template<typename Fmt, typename...Args>
+	inline void fatal(const Fmt& fmt, Args&&...args)
+	{
+		log(level::fatal, fmt, std::forward<Args>(args)...);
+	}
+}
+
+// attach file, line and function to the next log call of this thread
+// LOG_FFL olog::error("lost connection");
+#define LOG_FFL ::olog::detail::local_queue()->source = ::olog::detail::source_location{ __FILE__, __LINE__, __func__ };
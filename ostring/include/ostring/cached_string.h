@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "definitions.h"
+#include "ostr.h"
+
+_NS_OSTR_BEGIN
+
+// A string keeping its utf-8 encoding once asked for, for text written to utf-8 sinks many times.
+// The encoding is made on the first utf8() and published with an atomic pointer,
+// later calls from any thread only read it. A mutation drops it.
+// u8_cached_string name(u"玩家"_o);
+// socket.send(name.utf8());
+class OPEN_STRING_EXPORT u8_cached_string
+{
+public:
+
+	u8_cached_string() = default;
+
+	u8_cached_string(string str)
+		: _str(std::move(str))
+	{
+	}
+
+	// the cache is not copied, the copy encodes again on first use
+	u8_cached_string(const u8_cached_string& rhs)
+		: _str(rhs._str)
+	{
+	}
+
+	u8_cached_string(u8_cached_string&& rhs) noexcept
+		: _str(std::move(rhs._str))
+		, _u8(rhs._u8.exchange(nullptr, std::memory_order_acq_rel))
+	{
+	}
+
+	u8_cached_string& operator=(const u8_cached_string& rhs)
+	{
+		if (this != &rhs)
+			assign(rhs._str);
+		return *this;
+	}
+
+	u8_cached_string& operator=(u8_cached_string&& rhs) noexcept
+	{
+		if (this != &rhs)
+		{
+			_str = std::move(rhs._str);
+			delete _u8.exchange(rhs._u8.exchange(nullptr, std::memory_order_acq_rel), std::memory_order_acq_rel);
+		}
+		return *this;
+	}
+
+	~u8_cached_string()
+	{
+		delete _u8.load(std::memory_order_acquire);
+	}
+
+	[[nodiscard]] const string& str() const noexcept
+	{
+		return _str;
+	}
+
+	[[nodiscard]] string_view to_sv() const
+	{
+		return _str.to_sv();
+	}
+
+	operator string_view() const
+	{
+		return to_sv();
+	}
+
+	// utf-8 of the string, encoded on the first call and kept until a mutation
+	// safe to call from many threads at once, not along with a mutation.
+	// @return: valid until the next mutation.
+	[[nodiscard]] std::string_view utf8() const;
+
+	[[nodiscard]] bool is_cached() const noexcept
+	{
+		return _u8.load(std::memory_order_acquire) != nullptr;
+	}
+
+	u8_cached_string& assign(string str)
+	{
+		invalidate();
+		_str = std::move(str);
+		return *this;
+	}
+
+	// change the string in place, the cached utf-8 is dropped
+	// cached.modify([](string& s) { s.trim(); });
+	template<typename F>
+	u8_cached_string& modify(F&& f)
+	{
+		invalidate();
+		std::forward<F>(f)(_str);
+		return *this;
+	}
+
+private:
+
+	void invalidate() noexcept
+	{
+		delete _u8.exchange(nullptr, std::memory_order_acq_rel);
+	}
+
+	string _str;
+	mutable std::atomic<std::string*> _u8{ nullptr };
+};
+
+_NS_OSTR_END
+
+template<>
+struct fmt::formatter<ostr::u8_cached_string, char> : fmt::formatter<fmt::string_view, char>
+{
+	// the cached bytes, nothing is encoded again
+	template<typename FormatContext>
+	auto format(const ostr::u8_cached_string& str, FormatContext& ctx)
+	{
+		const std::string_view u8 = str.utf8();
+		return fmt::formatter<fmt::string_view, char>::format(fmt::string_view(u8.data(), u8.size()), ctx);
+	}
+};
+
+template<>
+struct fmt::formatter<ostr::u8_cached_string, char16_t> : fmt::formatter<ostr::string_view, char16_t>
+{
+	template<typename FormatContext>
+	auto format(const ostr::u8_cached_string& str, FormatContext& ctx)
+	{
+		return fmt::formatter<ostr::string_view, char16_t>::format(str.to_sv(), ctx);
+	}
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <chrono>
+#include <ratio>
+#include <string>
+#include <string_view>
+
+#include "definitions.h"
+#include "format.h"
+
+_NS_OSTR_BEGIN
+
+namespace ofmt {
+
+	// Render a point of time with a strftime-like spec, in local time or utc.
+	// Supported: %Y %y %C %m %d %e %j %H %I %M %S %p %a %A %b %B %h %u %w %z
+	//            %F %T %R %D %r %c %n %t %%
+	//            %f fraction of seconds in the precision of the time point, %3f %6f %9f for a fixed width
+	// Every thread caches the rendering of the current minute, so consecutive calls
+	// only rewrite seconds and sub-second digits.
+	// @param spec: "%Y-%m-%d %H:%M:%S" when empty, may start with ':'.
+	// @param nanoseconds: since epoch.
+	// @param fraction_digits: how many digits %f writes.
+	OPEN_STRING_EXPORT void format_time_point(int64_t nanoseconds, int fraction_digits, bool utc, std::u16string_view spec, std::u16string& out);
+
+	// Render a duration with a spec.
+	// Supported: %H total hours, %M %S, %f %3f %6f %9f, %Q count, %q unit, %n %t %%
+	// @param spec: count with unit suffix when empty, "42ms", may start with ':'.
+	OPEN_STRING_EXPORT void format_duration(int64_t nanoseconds, int fraction_digits, std::u16string_view count, std::u16string_view unit, std::u16string_view spec, std::u16string& out);
+
+	// Digits needed to show a tick of Period in seconds, 3 for milli, 7 for 100 nanoseconds.
+	template<typename Period>
+	constexpr int fraction_digits()
+	{
+		int digits = 0;
+		for (intmax_t den = Period::den; den > 1 && digits < 9; den /= 10)
+			++digits;
+		return Period::num == 1 ? digits : 9;
+	}
+
+	// "ms", "s", "[1/3]s"
+	template<typename Period>
+	inline void append_unit(std::u16string& out)
+	{
+		if constexpr (std::is_same_v<Period, std::nano>) out.append(u"ns");
+		else if constexpr (std::is_same_v<Period, std::micro>) out.append(u"us");
+		else if constexpr (std::is_same_v<Period, std::milli>) out.append(u"ms");
+		else if constexpr (std::is_same_v<Period, std::ratio<1>>) out.append(u"s");
+		else if constexpr (std::is_same_v<Period, std::ratio<60>>) out.append(u"min");
+		else if constexpr (std::is_same_v<Period, std::ratio<3600>>) out.append(u"h");
+		else if constexpr (std::is_same_v<Period, std::ratio<86400>>) out.append(u"d");
+		else
+		{
+			out.push_back(u'[');
+			helper::string::append_int(Period::num, out);
+			if constexpr (Period::den != 1)
+			{
+				out.push_back(u'/');
+				helper::string::append_int(Period::den, out);
+			}
+			out.append(u"]s");
+		}
+	}
+
+	// time point shown in utc instead of local time
+	// ofmt::format(u"{0:%FT%TZ}", ofmt::utc(std::chrono::system_clock::now()))
+	template<typename Duration>
+	struct utc_time
+	{
+		std::chrono::time_point<std::chrono::system_clock, Duration> time;
+	};
+
+	template<typename Duration>
+	inline utc_time<Duration> utc(std::chrono::time_point<std::chrono::system_clock, Duration> time)
+	{
+		return { time };
+	}
+
+	template<typename Duration>
+	struct formatter<std::chrono::time_point<std::chrono::system_clock, Duration>>
+	{
+		static bool format(const std::chrono::time_point<std::chrono::system_clock, Duration>& arg, std::u16string_view param, std::u16string& out)
+		{
+			const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(arg.time_since_epoch()).count();
+			format_time_point(ns, fraction_digits<typename Duration::period>(), false, param, out);
+			return true;
+		}
+	};
+
+	template<typename Duration>
+	struct formatter<utc_time<Duration>>
+	{
+		static bool format(const utc_time<Duration>& arg, std::u16string_view param, std::u16string& out)
+		{
+			const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(arg.time.time_since_epoch()).count();
+			format_time_point(ns, fraction_digits<typename Duration::period>(), true, param, out);
+			return true;
+		}
+	};
+
+	template<typename Rep, typename Period>
+	struct formatter<std::chrono::duration<Rep, Period>>
+	{
+		static bool format(const std::chrono::duration<Rep, Period>& arg, std::u16string_view param, std::u16string& out)
+		{
+			std::u16string count;
+			to_string(arg.count(), u"", count);
+			std::u16string unit;
+			append_unit<Period>(unit);
+
+			const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(arg).count();
+			format_duration(ns, fraction_digits<Period>(), count, unit, param, out);
+			return true;
+		}
+	};
+}
+
+_NS_OSTR_END
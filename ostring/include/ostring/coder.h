@@ -1,7 +1,10 @@
 #pragma once
 #include "definitions.h"
+#include "types.h"
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <type_traits>
 
 _NS_OSTR_BEGIN
 
@@ -11,26 +14,271 @@ namespace coder {
 
 	OPEN_STRING_EXPORT bool convert_append(std::u16string_view sv16, std::string& out_u8);
 
-	// not used temporarily
-	/*bool convert_append(std::string_view sv8, std::u32string& out_u32)
+	// bytes as latin-1, each one the code unit of the same value
+	// @param out_u16: at least bytes.size() code units.
+	OPEN_STRING_EXPORT void widen_latin1(std::string_view bytes, char16_t* out_u16) noexcept;
+
+	// how many code units from the start are below 0x100, so fit in latin-1
+	OPEN_STRING_EXPORT size_t latin1_prefix(std::u16string_view sv16) noexcept;
+
+	// code units below 0x100 as latin-1 bytes, the reverse of widen_latin1
+	// @param sv16: every unit below 0x100, see latin1_prefix.
+	// @param out_bytes: at least sv16.size() bytes.
+	OPEN_STRING_EXPORT void narrow_latin1(std::u16string_view sv16, char* out_bytes) noexcept;
+
+	// utf-32 in and out, invalid input is written as U+FFFD
+	OPEN_STRING_EXPORT bool convert_append(std::string_view sv8, std::u32string& out_u32);
+
+	OPEN_STRING_EXPORT bool convert_append(std::u32string_view sv32, std::string& out_u8);
+
+	OPEN_STRING_EXPORT bool convert_append(std::u16string_view sv16, std::u32string& out_u32);
+
+	OPEN_STRING_EXPORT bool convert_append(std::u32string_view sv32, std::u16string& out_u16);
+
+	// wchar_t holds utf-16 on windows and utf-32 elsewhere
+	constexpr bool wchar_is_utf16 = sizeof(wchar_t) == sizeof(char16_t);
+
+	using wchar_unit = std::conditional_t<wchar_is_utf16, char16_t, char32_t>;
+
+	// the same code units, seen as the unicode type of their width
+	inline std::basic_string_view<wchar_unit> as_unicode(std::wstring_view svw) noexcept
+	{
+		return { reinterpret_cast<const wchar_unit*>(svw.data()), svw.size() };
+	}
+
+	inline bool convert_append(std::wstring_view svw, std::u16string& out_u16)
 	{
+		if constexpr (wchar_is_utf16)
+		{
+			out_u16.append(reinterpret_cast<const char16_t*>(svw.data()), svw.size());
+			return true;
+		}
+		else
+		{
+			return convert_append(as_unicode(svw), out_u16);
+		}
+	}
 
+	inline bool convert_append(std::wstring_view svw, std::string& out_u8)
+	{
+		return convert_append(as_unicode(svw), out_u8);
 	}
 
-	bool convert_append(std::u32string_view sv32, std::string& out_u8)
+	inline bool convert_append(std::u16string_view sv16, std::wstring& out_w)
 	{
+		if constexpr (wchar_is_utf16)
+		{
+			out_w.append(reinterpret_cast<const wchar_t*>(sv16.data()), sv16.size());
+			return true;
+		}
+		else
+		{
+			std::u32string temp;
+			const bool ans = convert_append(sv16, temp);
+			out_w.append(reinterpret_cast<const wchar_t*>(temp.data()), temp.size());
+			return ans;
+		}
+	}
 
+	inline bool convert_append(std::string_view sv8, std::wstring& out_w)
+	{
+		std::basic_string<wchar_unit> temp;
+		const bool ans = convert_append(sv8, temp);
+		out_w.append(reinterpret_cast<const wchar_t*>(temp.data()), temp.size());
+		return ans;
 	}
 
-	bool convert_append(std::u16string_view sv16, std::u32string& out_u32)
+	// code points of utf-8, counted as the bytes that are not continuation bytes
+	// exact for well-formed input, 16 bytes at a time.
+	OPEN_STRING_EXPORT size_t count_utf8_codepoints(std::string_view sv8) noexcept;
+
+	// byte offset where a code point starts, whole blocks of 16 bytes skipped by their count
+	// @return: sv8.size() when index is past the end.
+	OPEN_STRING_EXPORT size_t utf8_codepoint_offset(std::string_view sv8, size_t index) noexcept;
+
+	// utf-8 against utf-16 in code point order, neither is transcoded
+	// ill-formed input compares as the U+FFFD it decodes to.
+	// @return: < 0 when u8 sorts first, 0 when equal, > 0 when after.
+	OPEN_STRING_EXPORT int compare(std::string_view u8, std::u16string_view u16) noexcept;
+
+	OPEN_STRING_EXPORT bool equals(std::string_view u8, std::u16string_view u16) noexcept;
+
+	// a utf-16 byte order mark at the head of raw bytes
+	// @param bytes: moved past the mark when there is one.
+	// @param fallback: the order without a mark, big endian by the unicode standard.
+	// @return: the order the mark tells.
+	OPEN_STRING_EXPORT endian take_utf16_bom(std::string_view& bytes, endian fallback = endian::big) noexcept;
+
+	// raw utf-16 bytes in order e appended as native code units, an odd byte at the end is dropped
+	// bytes are swapped and surrogate pairs counted in the same pass.
+	// @return: surrogate pairs appended, lone surrogates are kept and not counted.
+	OPEN_STRING_EXPORT size_t append_utf16_bytes(std::string_view bytes, endian e, std::u16string& out_u16);
+
+	// code units appended as raw bytes in order e
+	// @param bom: write a byte order mark first.
+	OPEN_STRING_EXPORT void append_utf16_bytes(std::u16string_view sv16, endian e, std::string& out_bytes, bool bom = false);
+
+	// what a transcoder does with ill-formed input
+	enum class error_policy : uint8_t
+	{
+		// write U+FFFD, one per lone surrogate or maximal subpart of utf-8
+		replace,
+		// stop before it, transcode_result::read tells where it is
+		strict,
+		// keep lone surrogates, as 3 byte sequences in utf-8 (WTF-8) and back,
+		// other ill-formed utf-8 is still replaced since utf-16 cannot hold it
+		pass_through,
+	};
+
+	struct transcode_result
+	{
+		// code units consumed from the source
+		size_t read;
+		// code units written to the destination
+		size_t written;
+		// ill-formed input met, replaced or passed through, or stopped at under strict
+		bool ill_formed = false;
+	};
+
+	// Position of the first ill-formed sequence, SIZE_MAX if there is none.
+	// Overlongs, surrogates, code points past U+10FFFF, stray continuation bytes and a sequence cut by the end all count.
+	OPEN_STRING_EXPORT size_t find_invalid_utf8(std::string_view sv8) noexcept;
+
+	// Position of the first lone surrogate, SIZE_MAX if there is none.
+	OPEN_STRING_EXPORT size_t find_invalid_utf16(std::u16string_view sv16) noexcept;
+
+	inline bool is_valid_utf8(std::string_view sv8) noexcept
 	{
+		return find_invalid_utf8(sv8) == SIZE_MAX;
+	}
 
+	inline bool is_valid_utf16(std::u16string_view sv16) noexcept
+	{
+		return find_invalid_utf16(sv16) == SIZE_MAX;
 	}
 
-	bool convert_append(std::u32string_view sv32, std::u16string& out_u16)
+	// bytes enough to encode count utf-16 code units in utf-8
+	constexpr size_t utf8_capacity(size_t count)
 	{
+		return count * 3;
+	}
+
+	// Encode utf-16 into a caller buffer of at least utf8_capacity(sv16.size()) bytes.
+	// @param final: false to leave a lead surrogate closing sv16 unread, so that the next call completes the pair.
+	// @param policy: for unpaired surrogates.
+	OPEN_STRING_EXPORT transcode_result encode_utf8(std::u16string_view sv16, char* out_u8, bool final = true, error_policy policy = error_policy::replace) noexcept;
+
+	// code units enough to decode count utf-8 bytes in utf-16
+	constexpr size_t utf16_capacity(size_t count)
+	{
+		return count;
+	}
+
+	// Decode utf-8 into a caller buffer of at least utf16_capacity(sv8.size()) code units.
+	// @param final: false to leave an incomplete sequence closing sv8 unread, so that the next call completes it.
+	// @param policy: for ill-formed sequences.
+	OPEN_STRING_EXPORT transcode_result decode_utf8(std::string_view sv8, char16_t* out_u16, bool final = true, error_policy policy = error_policy::replace) noexcept;
+
+	// Exact bytes encode_utf8 writes for sv16 under the policy.
+	OPEN_STRING_EXPORT size_t utf8_length_from_utf16(std::u16string_view sv16, error_policy policy = error_policy::replace) noexcept;
+
+	// Exact code units decode_utf8 writes for sv8 under the policy.
+	OPEN_STRING_EXPORT size_t utf16_length_from_utf8(std::string_view sv8, error_policy policy = error_policy::replace) noexcept;
+
+	// Convert into caller memory of capacity code units, never allocates.
+	// Whole code points are written while they fit, the rest is left for another call,
+	// so a buffer sized by the *_length_from_* functions takes all of it.
+	// @return: code units read and written.
+	OPEN_STRING_EXPORT transcode_result convert_into(std::string_view sv8, char16_t* out_u16, size_t capacity, error_policy policy = error_policy::replace) noexcept;
+
+	OPEN_STRING_EXPORT transcode_result convert_into(std::u16string_view sv16, char* out_u8, size_t capacity, error_policy policy = error_policy::replace) noexcept;
+
+	// Encode utf-16 to an output iterator through a small stack buffer, no allocation.
+	template<typename OutputIt, typename Write>
+	inline OutputIt encode_utf8_to(std::u16string_view sv16, OutputIt out, Write&& write)
+	{
+		constexpr size_t chunk = 256;
+		char buffer[utf8_capacity(chunk)];
+		while (!sv16.empty())
+		{
+			const std::u16string_view part = sv16.substr(0, chunk);
+			const transcode_result result = encode_utf8(part, buffer, part.size() == sv16.size());
+			out = write(buffer, buffer + result.written, out);
+			sv16.remove_prefix(result.read);
+		}
+		return out;
+	}
+
+	// Decode utf-8 arriving in pieces, such as socket reads, without joining them first.
+	// The tail of a sequence cut by a piece is kept and completed by the next feed.
+	// utf8_decoder decoder;
+	// while (recv(buffer)) decoder.feed(buffer, text);
+	// decoder.finish(text);
+	class OPEN_STRING_EXPORT utf8_decoder
+	{
+	public:
+
+		// @param out_u16: at least utf16_capacity(pending() + chunk.size()) code units.
+		// @return: code units written.
+		size_t feed(std::string_view chunk, char16_t* out_u16) noexcept;
+
+		void feed(std::string_view chunk, std::u16string& out_u16);
+
+		// end of input, a pending incomplete sequence is written as U+FFFD
+		// @param out_u16: at least utf16_capacity(pending()) code units.
+		size_t finish(char16_t* out_u16) noexcept;
+
+		void finish(std::u16string& out_u16);
+
+		// bytes of an incomplete sequence held from the last feed
+		[[nodiscard]] size_t pending() const noexcept
+		{
+			return _size;
+		}
+
+		void reset() noexcept
+		{
+			_size = 0;
+		}
+
+	private:
+
+		char _pending[4];
+		size_t _size = 0;
+	};
+
+	// Encode utf-16 arriving in pieces to utf-8, a surrogate pair cut by a piece is joined.
+	class OPEN_STRING_EXPORT utf16_encoder
+	{
+	public:
+
+		// @param out_u8: at least utf8_capacity(pending() + chunk.size()) bytes.
+		// @return: bytes written.
+		size_t feed(std::u16string_view chunk, char* out_u8) noexcept;
+
+		void feed(std::u16string_view chunk, std::string& out_u8);
+
+		// end of input, a pending lead surrogate is written as U+FFFD
+		// @param out_u8: at least utf8_capacity(pending()) bytes.
+		size_t finish(char* out_u8) noexcept;
+
+		void finish(std::string& out_u8);
+
+		// code units held from the last feed, a lead surrogate waiting for its trail
+		[[nodiscard]] size_t pending() const noexcept
+		{
+			return _lead ? 1 : 0;
+		}
+
+		void reset() noexcept
+		{
+			_lead = 0;
+		}
+
+	private:
 
-	}*/
+		char16_t _lead = 0;
+	};
 };
 
 _NS_OSTR_END
@@ -0,0 +1,407 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "fmt/format.h"
+
+#include "coder.h"
+#include "definitions.h"
+#include "format.h"
+#include "ostr.h"
+#include "osv.h"
+
+_NS_OSTR_BEGIN
+
+// A view of text held one byte per code unit as latin-1, or as utf-16.
+// Lengths and positions are in code points as with string_view, a latin-1 one has no pairs.
+// visit() hands the units over as they are stored, operations on two views pick a loop per pair of widths.
+class OPEN_STRING_EXPORT compact_string_view
+{
+public:
+
+	constexpr compact_string_view() noexcept = default;
+
+	constexpr compact_string_view(std::string_view latin1) noexcept
+		: _data(latin1.data())
+		, _size(latin1.size())
+		, _wide(false)
+	{
+	}
+
+	constexpr compact_string_view(std::u16string_view utf16) noexcept
+		: _data(utf16.data())
+		, _size(utf16.size())
+		, _wide(true)
+	{
+	}
+
+	constexpr compact_string_view(const char* latin1) noexcept
+		: compact_string_view(std::string_view(latin1))
+	{
+	}
+
+	constexpr compact_string_view(const char16_t* utf16) noexcept
+		: compact_string_view(std::u16string_view(utf16))
+	{
+	}
+
+	compact_string_view(const string_view& sv) noexcept
+		: compact_string_view(sv.raw())
+	{
+	}
+
+	// held as latin-1
+	[[nodiscard]] constexpr bool is_compact() const noexcept
+	{
+		return !_wide;
+	}
+
+	// code units, bytes when compact
+	[[nodiscard]] constexpr size_t origin_length() const noexcept
+	{
+		return _size;
+	}
+
+	[[nodiscard]] size_t length() const noexcept
+	{
+		return _wide ? string_view(utf16()).length() : _size;
+	}
+
+	[[nodiscard]] constexpr bool is_empty() const noexcept
+	{
+		return _size == 0;
+	}
+
+	// call f with the units as stored, a std::string_view of latin-1 or a std::u16string_view
+	template<typename F>
+	decltype(auto) visit(F&& f) const
+	{
+		if (_wide)
+			return std::forward<F>(f)(utf16());
+		return std::forward<F>(f)(latin1());
+	}
+
+	// @param index: in code units.
+	[[nodiscard]] char16_t unit_at(size_t index) const noexcept
+	{
+		return _wide ? utf16()[index] : char16_t(uint8_t(latin1()[index]));
+	}
+
+	// code unit order, same as string_view::compare
+	[[nodiscard]] int compare(const compact_string_view& rhs) const noexcept;
+
+	[[nodiscard]] bool operator==(const compact_string_view& rhs) const noexcept;
+
+	[[nodiscard]] inline bool operator!=(const compact_string_view& rhs) const noexcept
+	{
+		return !operator==(rhs);
+	}
+
+	[[nodiscard]] inline bool operator<(const compact_string_view& rhs) const noexcept
+	{
+		return compare(rhs) < 0;
+	}
+
+	[[nodiscard]] inline bool operator<=(const compact_string_view& rhs) const noexcept
+	{
+		return compare(rhs) <= 0;
+	}
+
+	[[nodiscard]] inline bool operator>(const compact_string_view& rhs) const noexcept
+	{
+		return compare(rhs) > 0;
+	}
+
+	[[nodiscard]] inline bool operator>=(const compact_string_view& rhs) const noexcept
+	{
+		return compare(rhs) >= 0;
+	}
+
+	[[nodiscard]] compact_string_view substring(size_t offset = 0, size_t count = SIZE_MAX) const noexcept;
+
+	// @return: offset in code points, SIZE_MAX if not found.
+	[[nodiscard]] size_t index_of(const compact_string_view& pattern, case_sensitivity cs = case_sensitivity::sensitive) const noexcept;
+
+	[[nodiscard]] size_t last_index_of(const compact_string_view& pattern, case_sensitivity cs = case_sensitivity::sensitive) const noexcept;
+
+	[[nodiscard]] bool start_with(const compact_string_view& sv_start) const noexcept
+	{
+		return _size >= sv_start._size && unit_slice(0, sv_start._size) == sv_start;
+	}
+
+	[[nodiscard]] bool end_with(const compact_string_view& sv_end) const noexcept
+	{
+		return _size >= sv_end._size && unit_slice(_size - sv_end._size, sv_end._size) == sv_end;
+	}
+
+	// same value as string_view::get_hash of the same text
+	[[nodiscard]] uint32_t get_hash() const noexcept
+	{
+		return visit([](auto units) { return helper::hash::hash_crc32(units); });
+	}
+
+	// widened to utf-16 when compact
+	[[nodiscard]] string to_string() const;
+
+	[[nodiscard]] bool encode_to_utf8(std::string& u8) const;
+
+	// @return: empty when wide.
+	[[nodiscard]] std::string_view latin1() const noexcept
+	{
+		return _wide ? std::string_view() : std::string_view(static_cast<const char*>(_data), _size);
+	}
+
+	// @return: empty when compact.
+	[[nodiscard]] std::u16string_view utf16() const noexcept
+	{
+		return _wide ? std::u16string_view(static_cast<const char16_t*>(_data), _size) : std::u16string_view();
+	}
+
+private:
+
+	// code units [from, from + count), same width
+	compact_string_view unit_slice(size_t from, size_t count) const noexcept
+	{
+		return _wide ? compact_string_view(utf16().substr(from, count)) : compact_string_view(latin1().substr(from, count));
+	}
+
+	const void* _data = "";
+	size_t _size = 0;
+	bool _wide = false;
+};
+
+// String stored as latin-1 while every code unit is below 0x100, and as utf-16 from the first one above.
+// Ascii heavy text takes half the memory of string, a string stays wide once widened until assigned again.
+// Deliberately a separate type, string keeps its utf-16 storage and api;
+// convert with compact_string(str) and to_string().
+// compact_string name(u"player");
+// name.is_compact() == true
+// name += u"玩家";
+// name.is_compact() == false
+class OPEN_STRING_EXPORT compact_string
+{
+public:
+
+	compact_string() = default;
+	compact_string(compact_string&&) = default;
+	compact_string(const compact_string&) = default;
+	compact_string& operator=(compact_string&&) = default;
+	compact_string& operator=(const compact_string&) = default;
+
+	// bytes as latin-1, same as the string constructors taking char
+	compact_string(const char* latin1)
+		: _latin1(latin1)
+	{
+	}
+
+	compact_string(std::string_view latin1)
+		: _latin1(latin1)
+	{
+	}
+
+	// narrowed when every unit fits
+	compact_string(std::u16string_view utf16)
+	{
+		assign(compact_string_view(utf16));
+	}
+
+	compact_string(const char16_t* utf16)
+		: compact_string(std::u16string_view(utf16))
+	{
+	}
+
+	compact_string(const string_view& sv)
+		: compact_string(sv.raw())
+	{
+	}
+
+	compact_string(const string& str)
+		: compact_string(str.raw())
+	{
+	}
+
+	compact_string(const compact_string_view& sv)
+	{
+		assign(sv);
+	}
+
+	compact_string& assign(const compact_string_view& sv);
+
+	[[nodiscard]] compact_string_view to_sv() const noexcept
+	{
+		return _wide ? compact_string_view(std::u16string_view(_utf16)) : compact_string_view(std::string_view(_latin1));
+	}
+
+	operator compact_string_view() const noexcept
+	{
+		return to_sv();
+	}
+
+	[[nodiscard]] bool is_compact() const noexcept
+	{
+		return !_wide;
+	}
+
+	[[nodiscard]] size_t length() const noexcept
+	{
+		return to_sv().length();
+	}
+
+	[[nodiscard]] size_t origin_length() const noexcept
+	{
+		return _wide ? _utf16.size() : _latin1.size();
+	}
+
+	[[nodiscard]] bool is_empty() const noexcept
+	{
+		return origin_length() == 0;
+	}
+
+	// bytes the units take, not counting the capacity left
+	[[nodiscard]] size_t storage_size() const noexcept
+	{
+		return _wide ? _utf16.size() * sizeof(char16_t) : _latin1.size();
+	}
+
+	template<typename F>
+	decltype(auto) visit(F&& f) const
+	{
+		return to_sv().visit(std::forward<F>(f));
+	}
+
+	[[nodiscard]] int compare(const compact_string_view& rhs) const noexcept
+	{
+		return to_sv().compare(rhs);
+	}
+
+	[[nodiscard]] bool operator==(const compact_string& rhs) const noexcept
+	{
+		return to_sv() == rhs.to_sv();
+	}
+
+	[[nodiscard]] bool operator!=(const compact_string& rhs) const noexcept
+	{
+		return to_sv() != rhs.to_sv();
+	}
+
+	[[nodiscard]] bool operator<(const compact_string& rhs) const noexcept
+	{
+		return to_sv() < rhs.to_sv();
+	}
+
+	[[nodiscard]] bool operator<=(const compact_string& rhs) const noexcept
+	{
+		return to_sv() <= rhs.to_sv();
+	}
+
+	[[nodiscard]] bool operator>(const compact_string& rhs) const noexcept
+	{
+		return to_sv() > rhs.to_sv();
+	}
+
+	[[nodiscard]] bool operator>=(const compact_string& rhs) const noexcept
+	{
+		return to_sv() >= rhs.to_sv();
+	}
+
+	// widens this string first when rhs does not fit in latin-1
+	compact_string& append(const compact_string_view& rhs);
+
+	compact_string& operator+=(const compact_string_view& rhs)
+	{
+		return append(rhs);
+	}
+
+	[[nodiscard]] compact_string operator+(const compact_string_view& rhs) const
+	{
+		compact_string str = *this;
+		str.append(rhs);
+		return str;
+	}
+
+	// compact_string(u"abcdefg").substring(2, 3) == compact_string(u"cde");
+	[[nodiscard]] compact_string substring(size_t from, size_t size = SIZE_MAX) const
+	{
+		return to_sv().substring(from, size);
+	}
+
+	// @param from: from where to search, in code points.
+	// @param length: how many code points from there to search in.
+	[[nodiscard]] size_t index_of(const compact_string_view& substr, size_t from = 0, size_t length = SIZE_MAX, case_sensitivity cs = case_sensitivity::sensitive) const;
+
+	[[nodiscard]] size_t last_index_of(const compact_string_view& substr, size_t from = 0, size_t length = SIZE_MAX, case_sensitivity cs = case_sensitivity::sensitive) const;
+
+	[[nodiscard]] uint32_t get_hash() const noexcept
+	{
+		return to_sv().get_hash();
+	}
+
+	[[nodiscard]] string to_string() const
+	{
+		return to_sv().to_string();
+	}
+
+	[[nodiscard]] bool encode_to_utf8(std::string& u8) const
+	{
+		return to_sv().encode_to_utf8(u8);
+	}
+
+private:
+
+	// move the latin-1 units into utf-16
+	void widen();
+
+	// only one of them is in use, told by _wide
+	std::string _latin1;
+	std::u16string _utf16;
+	bool _wide = false;
+};
+
+namespace ofmt {
+	template <>
+	inline bool to_string<compact_string_view>(const compact_string_view& arg, std::u16string_view param, std::u16string& out)
+	{
+		if (!arg.is_compact())
+		{
+			out.append(arg.utf16());
+			return true;
+		}
+		const size_t start = out.size();
+		out.resize(start + arg.origin_length());
+		coder::widen_latin1(arg.latin1(), out.data() + start);
+		return true;
+	}
+
+	template <>
+	inline bool to_string<compact_string>(const compact_string& arg, std::u16string_view param, std::u16string& out)
+	{
+		return to_string<compact_string_view>(arg.to_sv(), param, out);
+	}
+}
+
+_NS_OSTR_END
+
+// takes the same specs as string_view, a compact one is widened first
+template<>
+struct fmt::formatter<ostr::compact_string_view, char16_t> : fmt::formatter<ostr::string_view, char16_t>
+{
+	template<typename FormatContext>
+	auto format(const ostr::compact_string_view& sv, FormatContext& ctx)
+	{
+		if (!sv.is_compact())
+			return fmt::formatter<ostr::string_view, char16_t>::format(ostr::string_view(sv.utf16()), ctx);
+		const ostr::string wide = sv.to_string();
+		return fmt::formatter<ostr::string_view, char16_t>::format(wide.to_sv(), ctx);
+	}
+};
+
+template<>
+struct fmt::formatter<ostr::compact_string, char16_t> : fmt::formatter<ostr::compact_string_view, char16_t>
+{
+	template<typename FormatContext>
+	auto format(const ostr::compact_string& str, FormatContext& ctx)
+	{
+		return fmt::formatter<ostr::compact_string_view, char16_t>::format(str.to_sv(), ctx);
+	}
+};
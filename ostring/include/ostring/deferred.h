@@ -0,0 +1,470 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "definitions.h"
+#include "coder.h"
+#include "ostr.h"
+#include "osv.h"
+#include "format.h"
+
+_NS_OSTR_BEGIN
+
+namespace ofmt {
+
+	// blobs and the captured arguments in them are aligned to this
+	constexpr size_t deferred_align = 16;
+
+	constexpr size_t align_up(size_t value, size_t align)
+	{
+		return (value + align - 1) & ~(align - 1);
+	}
+
+	template<typename T>
+	struct string_traits
+	{
+		using char_type = void;
+	};
+
+	template<typename C>
+	struct string_traits<const C*>
+	{
+		using char_type = std::conditional_t<std::is_same_v<C, char> || std::is_same_v<C, char16_t> || std::is_same_v<C, wchar_t> || std::is_same_v<C, char32_t>, C, void>;
+		static std::basic_string_view<C> view(const C* str) { return str ? std::basic_string_view<C>(str) : std::basic_string_view<C>(); }
+	};
+
+	template<typename C>
+	struct string_traits<C*> : string_traits<const C*> {};
+
+	template<typename C, typename Traits, typename Alloc>
+	struct string_traits<std::basic_string<C, Traits, Alloc>>
+	{
+		using char_type = C;
+		static std::basic_string_view<C> view(const std::basic_string<C, Traits, Alloc>& str) { return { str.data(), str.size() }; }
+	};
+
+	template<typename C, typename Traits>
+	struct string_traits<std::basic_string_view<C, Traits>>
+	{
+		using char_type = C;
+		static std::basic_string_view<C> view(std::basic_string_view<C, Traits> str) { return { str.data(), str.size() }; }
+	};
+
+	template<typename Alloc>
+	struct string_traits<basic_string<Alloc>>
+	{
+		using char_type = char16_t;
+		static std::u16string_view view(const basic_string<Alloc>& str) { return str.raw(); }
+	};
+
+	template<>
+	struct string_traits<string_view>
+	{
+		using char_type = char16_t;
+		static std::u16string_view view(const string_view& str) { return str.raw(); }
+	};
+
+	template<typename T>
+	constexpr bool is_string_v = !std::is_void_v<typename string_traits<T>::char_type>;
+
+	// the type an argument is captured as, "abc" -> const char*
+	template<typename T>
+	using captured_t = std::decay_t<const T&>;
+
+	// how an argument lives in a blob
+	// strings are copied inline as length and code units, the source may die before rendering,
+	// trivially copyable values are copied as bytes,
+	// other values are copy or move constructed in place, copied and destroyed with the blob.
+	// Specialize to store a type in a cheaper form.
+	template<typename T, typename = void>
+	struct capture
+	{
+		using decoded = const T&;
+
+		static constexpr size_t align = alignof(T);
+		static_assert(align <= deferred_align, "over aligned argument.");
+
+		static size_t size(const T&) { return sizeof(T); }
+
+		template<typename U>
+		static void write(std::byte* p, U&& arg) { new (p) T(std::forward<U>(arg)); }
+
+		static decoded read(const std::byte* p) { return *std::launder(reinterpret_cast<const T*>(p)); }
+
+		// to is a bitwise copy of from
+		static void copy(const std::byte* from, std::byte* to)
+		{
+			if constexpr (std::is_copy_constructible_v<T>)
+				new (to) T(read(from));
+		}
+
+		static void destroy(std::byte* p) { std::launder(reinterpret_cast<T*>(p))->~T(); }
+	};
+
+	template<typename T>
+	struct capture<T, std::enable_if_t<std::is_trivially_copyable_v<T> && !is_string_v<T> && !is_named_arg<T>::value>>
+	{
+		using decoded = T;
+
+		static constexpr size_t align = alignof(T);
+		static_assert(align <= deferred_align, "over aligned argument.");
+
+		static size_t size(const T&) { return sizeof(T); }
+
+		static void write(std::byte* p, const T& arg) { std::memcpy(p, &arg, sizeof(T)); }
+
+		static decoded read(const std::byte* p)
+		{
+			T value;
+			std::memcpy(&value, p, sizeof(T));
+			return value;
+		}
+
+		static void copy(const std::byte*, std::byte*) {}
+
+		static void destroy(std::byte*) {}
+	};
+
+	template<typename T>
+	struct capture<T, std::enable_if_t<is_string_v<T>>>
+	{
+		using char_type = typename string_traits<T>::char_type;
+		using decoded = std::basic_string_view<char_type>;
+
+		static constexpr size_t align = alignof(uint32_t);
+
+		static size_t size(const T& arg) { return sizeof(uint32_t) + string_traits<T>::view(arg).size() * sizeof(char_type); }
+
+		static void write(std::byte* p, const T& arg)
+		{
+			const auto view = string_traits<T>::view(arg);
+			const uint32_t length = uint32_t(view.size());
+			std::memcpy(p, &length, sizeof(length));
+			std::memcpy(p + sizeof(length), view.data(), view.size() * sizeof(char_type));
+		}
+
+		static decoded read(const std::byte* p)
+		{
+			uint32_t length;
+			std::memcpy(&length, p, sizeof(length));
+			return decoded(reinterpret_cast<const char_type*>(p + sizeof(length)), length);
+		}
+
+		static void copy(const std::byte*, std::byte*) {}
+
+		static void destroy(std::byte*) {}
+	};
+
+	// a named argument read back from a blob
+	template<typename D>
+	struct captured_named_arg
+	{
+		std::u16string_view name;
+		uint32_t hash;
+		D value;
+	};
+
+	template<typename D>
+	struct is_named_arg<captured_named_arg<D>> : std::true_type {};
+
+	template<typename D>
+	inline bool to_string(const captured_named_arg<D>& arg, std::u16string_view param, std::u16string& out)
+	{
+		return to_string(arg.value, param, out);
+	}
+
+	// the hash, the name with its length, then the value
+	// the name is kept so a lookup can tell two names of the same hash apart
+	template<typename T>
+	struct capture<named_arg<T>>
+	{
+		using value_capture = capture<captured_t<T>>;
+		using decoded = captured_named_arg<typename value_capture::decoded>;
+
+		static constexpr size_t name_offset = 2 * sizeof(uint32_t);
+		static constexpr size_t align = value_capture::align > alignof(uint32_t) ? value_capture::align : alignof(uint32_t);
+
+		static size_t value_offset(size_t name_length)
+		{
+			return align_up(name_offset + name_length * sizeof(char16_t), value_capture::align);
+		}
+
+		static size_t value_offset(const std::byte* p)
+		{
+			uint32_t length;
+			std::memcpy(&length, p + sizeof(uint32_t), sizeof(length));
+			return value_offset(length);
+		}
+
+		static size_t size(const named_arg<T>& arg) { return value_offset(arg.name.size()) + value_capture::size(arg.value); }
+
+		static void write(std::byte* p, const named_arg<T>& arg)
+		{
+			const uint32_t length = uint32_t(arg.name.size());
+			std::memcpy(p, &arg.hash, sizeof(arg.hash));
+			std::memcpy(p + sizeof(uint32_t), &length, sizeof(length));
+			std::memcpy(p + name_offset, arg.name.data(), length * sizeof(char16_t));
+			value_capture::write(p + value_offset(length), arg.value);
+		}
+
+		static decoded read(const std::byte* p)
+		{
+			uint32_t hash;
+			uint32_t length;
+			std::memcpy(&hash, p, sizeof(hash));
+			std::memcpy(&length, p + sizeof(uint32_t), sizeof(length));
+			const std::u16string_view name(reinterpret_cast<const char16_t*>(p + name_offset), length);
+			return decoded{ name, hash, value_capture::read(p + value_offset(length)) };
+		}
+
+		static void copy(const std::byte* from, std::byte* to)
+		{
+			const size_t offset = value_offset(from);
+			value_capture::copy(from + offset, to + offset);
+		}
+
+		static void destroy(std::byte* p)
+		{
+			const size_t offset = value_offset(p);
+			value_capture::destroy(p + offset);
+		}
+	};
+
+	// type erased operations on a blob
+	struct deferred_ops
+	{
+		// append the result to out, can be called many times
+		void (*render)(const std::byte* blob, std::u16string& out);
+		// destroy the captured arguments
+		void (*destroy)(std::byte* blob);
+		// construct a blob at to from a blob of size bytes, nullptr when an argument can not be copied
+		void (*copy)(const std::byte* from, std::byte* to, size_t size);
+	};
+
+	// byte offsets of the format and the arguments, the blob starts with them
+	template<size_t N>
+	struct deferred_layout
+	{
+		size_t offsets[N] = {};
+		// of the whole blob, multiple of deferred_align
+		size_t size = 0;
+	};
+
+	// "abc" and u"abc" alike, utf-8 is decoded
+	template<typename C>
+	inline void append_text(std::basic_string_view<C> text, std::u16string& out)
+	{
+		if constexpr (std::is_same_v<C, char>)
+			coder::convert_append(text, out);
+		else
+			out.append(text.cbegin(), text.cend());
+	}
+
+	// Blob layout: offset table | format | arguments, every part aligned for its type.
+	// @param Fmt, Args: captured_t of the format and the arguments.
+	template<typename Fmt, typename...Args>
+	struct deferred_blob
+	{
+		static_assert(is_string_v<Fmt>, "format must be a string.");
+
+		static constexpr size_t count = sizeof...(Args) + 1;
+		static constexpr size_t table_size = sizeof(size_t) * count;
+
+		template<typename F, typename...As>
+		static deferred_layout<count> measure(const F& fmt, const As&...args)
+		{
+			deferred_layout<count> layout;
+			size_t i = 0;
+			size_t offset = table_size;
+			layout.offsets[i++] = offset;
+			offset += capture<Fmt>::size(fmt);
+			((offset = align_up(offset, capture<Args>::align), layout.offsets[i++] = offset, offset += capture<Args>::size(args)), ...);
+			layout.size = align_up(offset, deferred_align);
+			return layout;
+		}
+
+		// @param blob: layout.size bytes aligned to deferred_align.
+		template<typename F, typename...As>
+		static const deferred_ops* write(std::byte* blob, const deferred_layout<count>& layout, const F& fmt, As&&...args)
+		{
+			std::memcpy(blob, layout.offsets, table_size);
+			size_t i = 0;
+			capture<Fmt>::write(blob + layout.offsets[i++], fmt);
+			(capture<Args>::write(blob + layout.offsets[i++], std::forward<As>(args)), ...);
+			return &ops;
+		}
+
+		static void render(const std::byte* blob, std::u16string& out)
+		{
+			render(blob, out, std::index_sequence_for<Args...>{});
+		}
+
+		template<size_t...I>
+		static void render(const std::byte* blob, std::u16string& out, std::index_sequence<I...>)
+		{
+			const auto offsets = reinterpret_cast<const size_t*>(blob);
+			const auto fmt = capture<Fmt>::read(blob + offsets[0]);
+
+			if constexpr (sizeof...(Args) == 0)
+			{
+				append_text(fmt, out);
+			}
+			else
+			{
+				std::tuple<typename capture<Args>::decoded...> args{ capture<Args>::read(blob + offsets[I + 1])... };
+				if constexpr (std::is_same_v<typename capture<Fmt>::char_type, char16_t>)
+				{
+					format_to(out, fmt, std::get<I>(args)...);
+				}
+				else
+				{
+					std::u16string wide_fmt;
+					append_text(fmt, wide_fmt);
+					format_to(out, wide_fmt, std::get<I>(args)...);
+				}
+			}
+		}
+
+		static void destroy(std::byte* blob)
+		{
+			destroy(blob, std::index_sequence_for<Args...>{});
+		}
+
+		template<size_t...I>
+		static void destroy(std::byte* blob, std::index_sequence<I...>)
+		{
+			const auto offsets = reinterpret_cast<const size_t*>(blob);
+			(capture<Args>::destroy(blob + offsets[I + 1]), ...);
+		}
+
+		static void copy(const std::byte* from, std::byte* to, size_t size)
+		{
+			std::memcpy(to, from, size);
+			const auto offsets = reinterpret_cast<const size_t*>(from);
+			size_t i = 1;
+			((capture<Args>::copy(from + offsets[i], to + offsets[i]), ++i), ...);
+		}
+
+		static constexpr bool copyable = (std::is_copy_constructible_v<Args> && ...);
+
+		static constexpr deferred_ops ops = { &render, &destroy, copyable ? &copy : nullptr };
+	};
+
+	// A format string and its arguments captured now, rendered later, maybe on another thread.
+	// Same "{index,alignment:param}" rules as format, strings are copied so the sources may die.
+	// The blob is one allocation, moving a deferred only moves the pointer.
+	// ofmt::deferred d(u"{0} got {1,4} coins", name, 3);
+	// ... d.render() == u"Tom got    3 coins"
+	class deferred
+	{
+	public:
+
+		deferred() noexcept = default;
+
+		template<typename Fmt, typename...Args>
+		explicit deferred(const Fmt& fmt, Args&&...args)
+		{
+			using blob_type = deferred_blob<captured_t<Fmt>, captured_t<Args>...>;
+			const captured_t<Fmt>& fmt_arg = fmt;
+			const auto layout = blob_type::measure(fmt_arg, args...);
+			_blob = allocate(layout.size);
+			_size = layout.size;
+			_ops = blob_type::write(_blob, layout, fmt_arg, std::forward<Args>(args)...);
+		}
+
+		deferred(const deferred& rhs)
+		{
+			if (!rhs._blob)
+				return;
+			assert(rhs._ops->copy && "an argument can not be copied.");
+			_blob = allocate(rhs._size);
+			_size = rhs._size;
+			rhs._ops->copy(rhs._blob, _blob, _size);
+			_ops = rhs._ops;
+		}
+
+		deferred(deferred&& rhs) noexcept
+			: _ops(std::exchange(rhs._ops, nullptr))
+			, _blob(std::exchange(rhs._blob, nullptr))
+			, _size(std::exchange(rhs._size, 0))
+		{
+		}
+
+		deferred& operator=(deferred rhs) noexcept
+		{
+			std::swap(_ops, rhs._ops);
+			std::swap(_blob, rhs._blob);
+			std::swap(_size, rhs._size);
+			return *this;
+		}
+
+		~deferred()
+		{
+			if (!_blob)
+				return;
+			_ops->destroy(_blob);
+			::operator delete(_blob, std::align_val_t(deferred_align));
+		}
+
+		[[nodiscard]] bool empty() const noexcept
+		{
+			return _blob == nullptr;
+		}
+
+		// bytes held by the blob
+		[[nodiscard]] size_t size() const noexcept
+		{
+			return _size;
+		}
+
+		// append the result back
+		void render_to(std::u16string& out) const
+		{
+			if (_blob)
+				_ops->render(_blob, out);
+		}
+
+		// append the result back in utf-8
+		void render_to(std::string& out) const
+		{
+			std::u16string text;
+			render_to(text);
+			coder::convert_append(text, out);
+		}
+
+		[[nodiscard]] string render() const
+		{
+			std::u16string text;
+			render_to(text);
+			return string(text);
+		}
+
+		[[nodiscard]] std::string render_utf8() const
+		{
+			std::string out;
+			render_to(out);
+			return out;
+		}
+
+	private:
+
+		static std::byte* allocate(size_t size)
+		{
+			return static_cast<std::byte*>(::operator new(size, std::align_val_t(deferred_align)));
+		}
+
+		const deferred_ops* _ops = nullptr;
+		std::byte* _blob = nullptr;
+		size_t _size = 0;
+	};
+}
+
+_NS_OSTR_END
@@ -4,3 +4,11 @@
 #define _NS_OSTR_END	}
 
 #define OPEN_STRING_EXPORT __declspec(dllexport)
+
+// for extern template declarations, which can not take dllexport (msvc C4910)
+// the explicit instantiations export, users of a shared build import them
+#if defined(OPEN_STRING_SHARED) && !defined(OPEN_STRING_BUILD)
+#define OPEN_STRING_TEMPLATE_IMPORT __declspec(dllimport)
+#else
+#define OPEN_STRING_TEMPLATE_IMPORT
+#endif
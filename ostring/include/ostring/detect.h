@@ -0,0 +1,41 @@
+#pragma once
+#include "definitions.h"
+#include <cstdint>
+#include <string_view>
+
+_NS_OSTR_BEGIN
+
+namespace coder {
+
+	// encodings detect can tell apart
+	enum class encoding : uint8_t
+	{
+		unknown,
+		// ascii is reported as utf-8
+		utf8,
+		utf16le,
+		utf16be,
+		// also gbk and gb2312
+		gb18030,
+	};
+
+	struct detection
+	{
+		encoding detected = encoding::unknown;
+		// bytes of a byte order mark at the head, to be skipped
+		size_t bom_size = 0;
+		// 0 to 100, 100 for a byte order mark or valid utf-8 with multi byte sequences
+		uint8_t confidence = 0;
+	};
+
+	constexpr size_t default_detect_sample = 64 * 1024;
+
+	// guess the encoding of unlabeled bytes from their head
+	// a byte order mark wins. Else the zero bytes at even and odd offsets,
+	// counted in one simd pass, tell utf-16 apart, then the sample is validated as utf-8,
+	// then scored as gb18030 by how many sequences are well formed and common hanzi.
+	// @param sample: bytes looked at, a sequence cut by its end is not held against any encoding.
+	OPEN_STRING_EXPORT detection detect(std::string_view bytes, size_t sample = default_detect_sample) noexcept;
+};
+
+_NS_OSTR_END
@@ -3,8 +3,10 @@
 #include <vector>
 #include <string>
 #include <string_view>
+#include <initializer_list>
 
 #include "definitions.h"
+#include "types.h"
 #include "helpers.h"
 
 #include <assert.h>
@@ -13,8 +15,18 @@ _NS_OSTR_BEGIN
 
 namespace ofmt {
 
+	// Specialize to support a family of types which can not be
+	// reached by a to_string specialization or argument dependent lookup,
+	// e.g. formatter<std::chrono::duration<Rep, Period>>.
+	// static bool format(const T& arg, std::u16string_view param, std::u16string& out);
+	template<typename T, typename = void>
+	struct formatter;
+
 	template<typename T>
-	bool to_string(const T& arg, std::u16string_view param, std::u16string& out) = delete;
+	bool to_string(const T& arg, std::u16string_view param, std::u16string& out)
+	{
+		return formatter<T>::format(arg, param, out);
+	}
 
 	template <class T, class Traits>
 	inline bool to_string(const std::basic_string_view<T, Traits>& arg, std::u16string_view param, std::u16string& out)
@@ -55,55 +67,135 @@ namespace ofmt {
 	template<>
 	inline bool to_string<std::u16string_view>(const std::u16string_view& arg, std::u16string_view param, std::u16string& out)
 	{
-		out = arg;
+		out.append(arg);
 		return true;
 	}
 
 	template<>
 	inline bool to_string<int>(const int& arg, std::u16string_view param, std::u16string& out)
 	{
-		helper::string::from_int(arg, out);
+		helper::string::append_int(arg, out);
 		return true;
 	}
 
 	template<>
-	inline bool to_string<float>(const float& arg, std::u16string_view param, std::u16string& out)
+	inline bool to_string<unsigned int>(const unsigned int& arg, std::u16string_view param, std::u16string& out)
+	{
+		helper::string::append_int(arg, out);
+		return true;
+	}
+
+	template<>
+	inline bool to_string<long>(const long& arg, std::u16string_view param, std::u16string& out)
+	{
+		helper::string::append_int(arg, out);
+		return true;
+	}
+
+	template<>
+	inline bool to_string<unsigned long>(const unsigned long& arg, std::u16string_view param, std::u16string& out)
 	{
-		helper::string::from_float_round(arg, out);
+		helper::string::append_int(arg, out);
 		return true;
 	}
 
+	template<>
+	inline bool to_string<long long>(const long long& arg, std::u16string_view param, std::u16string& out)
+	{
+		helper::string::append_int(arg, out);
+		return true;
+	}
+
+	template<>
+	inline bool to_string<unsigned long long>(const unsigned long long& arg, std::u16string_view param, std::u16string& out)
+	{
+		helper::string::append_int(arg, out);
+		return true;
+	}
+
+	// parse float param, ":[.precision][type]"
+	// type: f/F fixed, e/E scientific, g/G general, shortest digits when precision is absent
+	// {0:.2f} -> 3.14, {0:e} -> 3.14159e+00, {0:.3g} -> 3.14
+	inline bool parse_float_param(std::u16string_view param, float_format& format, int& precision, bool& upper)
+	{
+		format = float_format::general;
+		precision = -1;
+		upper = false;
+
+		size_t i = 0;
+		if (i < param.size() && param[i] == u':')
+			++i;
+		if (i < param.size() && param[i] == u'.')
+		{
+			++i;
+			precision = 0;
+			for (; i < param.size() && helper::character::is_number(param[i]); ++i)
+				precision = precision * 10 + helper::character::to_number(param[i]);
+		}
+		if (i < param.size())
+		{
+			switch (param[i])
+			{
+			case u'F': upper = true; [[fallthrough]];
+			case u'f': format = float_format::fixed; break;
+			case u'E': upper = true; [[fallthrough]];
+			case u'e': format = float_format::scientific; break;
+			case u'G': upper = true; [[fallthrough]];
+			case u'g': format = float_format::general; break;
+			default: return false;
+			}
+			++i;
+		}
+		return i == param.size();
+	}
+
+	template<>
+	inline bool to_string<float>(const float& arg, std::u16string_view param, std::u16string& out)
+	{
+		float_format format;
+		int precision;
+		bool upper;
+		const bool valid = parse_float_param(param, format, precision, upper);
+		helper::string::append_float(arg, out, format, precision, upper);
+		return valid;
+	}
+
+	template<>
+	inline bool to_string<double>(const double& arg, std::u16string_view param, std::u16string& out)
+	{
+		float_format format;
+		int precision;
+		bool upper;
+		const bool valid = parse_float_param(param, format, precision, upper);
+		helper::string::append_float(arg, out, format, precision, upper);
+		return valid;
+	}
+
 
 	template<typename Arg0>
 	inline void to_string_index(size_t index, int alignment, std::u16string& out, std::u16string_view param, Arg0&& a0)
 	{
 		if (index != 0) return;
 
-		// TODO: performance hit here when construct string
-		//	|	|	|	|	|	|	|	|
-		//	v	v	v	v	v	v	v	v
-		std::u16string str;
-		//	^	^	^	^	^	^	^	^
-		//	|	|	|	|	|	|	|	|
-		// TODO: performance hit here when construct string
+		// write in place, then pad the written range if needed
+		const size_t start = out.size();
+		to_string(a0, param, out);
 
-		to_string(a0, param, str);
+		const size_t alignment_abs = std::abs(alignment);
+		const size_t written = out.size() - start;
 
-		size_t alignment_abs = std::abs(alignment);
-
-		if (alignment_abs > str.size())
+		if (alignment_abs > written)
 		{
-			size_t space_count = alignment_abs - str.size();
+			size_t space_count = alignment_abs - written;
 			if (alignment < 0)
 			{
-				str.append(space_count, u' ');
+				out.append(space_count, u' ');
 			}
 			else
 			{
-				str = std::u16string(space_count, u' ').append(str);
+				out.insert(start, space_count, u' ');
 			}
 		}
-		out.append(str);
 	}
 
 	template<typename Arg0, typename...Args>
@@ -123,128 +215,365 @@ namespace ofmt {
 		return std::u16string(fmt);
 	}
 
-	template<typename...Args>
-	inline std::u16string format(std::u16string_view fmt, Args&&...args)
+	// crc32 over both bytes of every code unit,
+	// unlike string_view::get_hash which only sees the low byte
+	constexpr uint32_t name_hash(std::u16string_view name)
 	{
-		size_t prev_holder = 0;
+		uint32_t ans = 0xFFFFFFFF;
+		for (size_t i = 0; i < name.size(); ++i)
+		{
+			ans = ((ans >> 8) ^ helper::hash::crc_table[(ans ^ name[i]) & 0x000000FF]);
+			ans = ((ans >> 8) ^ helper::hash::crc_table[(ans ^ (name[i] >> 8)) & 0x000000FF]);
+		}
+		return ans ^ 0xFFFFFFFF;
+	}
 
-		// TODO: performance hit here when construct string
-		//	|	|	|	|	|	|	|	|
-		//	v	v	v	v	v	v	v	v
-		std::u16string ans;
-		//	^	^	^	^	^	^	^	^
-		//	|	|	|	|	|	|	|	|
-		// TODO: performance hit here when construct string
+	// argument referred by name, "{player_name}"
+	// the name is hashed once when constructed, lookup compares names only when hashes match
+	template<typename T>
+	struct named_arg
+	{
+		std::u16string_view name;
+		uint32_t hash;
+		const T& value;
+	};
+
+	// ofmt::format(u"{player} got {count} coins", ofmt::arg(u"player", name), ofmt::arg(u"count", 3))
+	// named arguments take a positional slot as well
+	template<typename T>
+	constexpr named_arg<T> arg(std::u16string_view name, const T& value)
+	{
+		return { name, name_hash(name), value };
+	}
+
+	template<typename T>
+	struct is_named_arg : std::false_type {};
+
+	template<typename T>
+	struct is_named_arg<named_arg<T>> : std::true_type {};
+
+	template<typename T>
+	inline bool to_string(const named_arg<T>& arg, std::u16string_view param, std::u16string& out)
+	{
+		return to_string(arg.value, param, out);
+	}
+
+	// hash of a named argument, 0 for a positional one
+	template<typename T>
+	constexpr uint32_t arg_name_hash(const T& arg)
+	{
+		if constexpr (is_named_arg<std::decay_t<T>>::value)
+			return arg.hash;
+		else
+			return 0;
+	}
+
+	// name of a named argument, empty for a positional one
+	template<typename T>
+	constexpr std::u16string_view arg_name(const T& arg)
+	{
+		if constexpr (is_named_arg<std::decay_t<T>>::value)
+			return arg.name;
+		else
+			return {};
+	}
+
+	// slot of the named argument with specific name, hashes are compared first
+	// @return: SIZE_MAX if not found
+	inline size_t find_named_arg(const uint32_t* hashes, const std::u16string_view* names, size_t count, uint32_t hash, std::u16string_view name)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (hashes[i] == hash && names[i] == name)
+				return i;
+		}
+		return SIZE_MAX;
+	}
+
+	// "{index,alignment:param}" or "{name,alignment:param}"
+	struct placeholder
+	{
+		// argument slot, SIZE_MAX when referred by name
+		size_t index = 0;
+		// name_hash of the name, 0 when referred by index
+		uint32_t name_hash = 0;
+		// empty when referred by index
+		std::u16string_view name;
+		int alignment = 0;
+		// starts with ':' if any
+		std::u16string_view param;
+		// the whole placeholder as written, braces included
+		std::u16string_view text;
+	};
+
+	// Split a format string into literals and placeholders.
+	// "{{" and "}}" are emitted as literal "{" and "}".
+	// A placeholder not closed, or automatic "{}" and manual "{0}" indices in one string, is a format error:
+	// parsing stops there and the rest is emitted as a literal as it is.
+	// @param on_literal: void(std::u16string_view), may be called with empty views.
+	// @param on_placeholder: void(const placeholder&).
+	// @return: false on a format error.
+	template<typename L, typename P>
+	inline bool parse_format(std::u16string_view fmt, L&& on_literal, P&& on_placeholder)
+	{
+		size_t prev_holder = 0;
+		size_t auto_index = 0;
+		bool manual_index = false;
 
-		int auto_index = -1;
-		
 		for (size_t i = 0; i < fmt.size(); ++i)
 		{
-			char16_t c = fmt.data()[i];
+			const char16_t c = fmt[i];
 			if (c == u'{')
 			{
-				++i;
 				// "{{" -> "{"
-				if (fmt.data()[i] == u'{')
+				if (i + 1 < fmt.size() && fmt[i + 1] == u'{')
 				{
-					ans.append(fmt.substr(prev_holder, i - prev_holder));
-					prev_holder = i + 1;
+					on_literal(fmt.substr(prev_holder, i + 1 - prev_holder));
+					prev_holder = (++i) + 1;
 					continue;
 				}
-				if (fmt.data()[i] == u'}')
+				on_literal(fmt.substr(prev_holder, i - prev_holder));
+				const size_t holder_begin = i;
+				++i;
+
+				placeholder holder;
+				if (i < fmt.size() && helper::character::is_number(fmt[i]))
+				{
+					if (auto_index != 0)
+					{
+						on_literal(fmt.substr(holder_begin));
+						return false;
+					}
+					manual_index = true;
+					for (; i < fmt.size() && helper::character::is_number(fmt[i]); ++i)
+						holder.index = holder.index * 10 + helper::character::to_number(fmt[i]);
+				}
+				else if (i < fmt.size() && fmt[i] != u',' && fmt[i] != u':' && fmt[i] != u'}')
 				{
-					++auto_index;
+					const size_t name_begin = i;
+					while (i < fmt.size() && fmt[i] != u',' && fmt[i] != u':' && fmt[i] != u'}')
+						++i;
+					holder.index = SIZE_MAX;
+					holder.name = fmt.substr(name_begin, i - name_begin);
+					holder.name_hash = name_hash(holder.name);
 				}
-				ans.append(fmt.substr(prev_holder, i - prev_holder - 1));
-				size_t index = 0;
-				size_t param_colon = SIZE_MAX;
-				int alignment = 0;
-				
-				for (; i < fmt.size(); ++i)
+				else
 				{
-					c = fmt.data()[i];
-					if (ostr::helper::character::is_number(c))
+					if (manual_index)
 					{
-						assert(auto_index == -1 && "auto index not allowed when using manual index.");
-						index = index * 10 + helper::character::to_number(c);
-						continue;
+						on_literal(fmt.substr(holder_begin));
+						return false;
 					}
-					if (c == u',')
+					holder.index = auto_index++;
+				}
+
+				if (i < fmt.size() && fmt[i] == u',')
+				{
+					++i;
+					int sign = 1;
+					if (i < fmt.size() && (fmt[i] == u'-' || fmt[i] == u'+'))
 					{
+						sign = fmt[i] == u'-' ? -1 : 1;
 						++i;
-						int sign = 1;
-						if (fmt.data()[i] == u'-')
-						{
-							sign = -1;
-							++i;
-						}
-						else if (fmt.data()[i] == u'+')
-						{
-							++i;
-						}
-						for (; i < fmt.size(); ++i)
-						{
-							c = fmt.data()[i];
-							if (helper::character::is_number(c))
-							{
-								alignment = alignment * 10 + helper::character::to_number(c);
-								continue;
-							}
-							if (c == u':' || c == u'}')
-							{
-								alignment *= sign;
-								break;
-							}
-						}
 					}
-					if (c == u':')
+					for (; i < fmt.size() && helper::character::is_number(fmt[i]); ++i)
+						holder.alignment = holder.alignment * 10 + helper::character::to_number(fmt[i]);
+					holder.alignment *= sign;
+				}
+
+				if (i < fmt.size() && fmt[i] == u':')
+				{
+					const size_t param_colon = i;
+					while (i < fmt.size() && fmt[i] != u'}')
+						++i;
+					holder.param = fmt.substr(param_colon, i - param_colon);
+				}
+
+				if (i >= fmt.size() || fmt[i] != u'}')
+				{
+					on_literal(fmt.substr(holder_begin));
+					return false;
+				}
+				holder.text = fmt.substr(holder_begin, i + 1 - holder_begin);
+				on_placeholder(static_cast<const placeholder&>(holder));
+				prev_holder = i + 1;
+			}
+			// "}}" -> "}"
+			else if (c == u'}' && i + 1 < fmt.size() && fmt[i + 1] == u'}')
+			{
+				on_literal(fmt.substr(prev_holder, i + 1 - prev_holder));
+				prev_holder = (++i) + 1;
+			}
+		}
+		on_literal(fmt.substr(prev_holder));
+		return true;
+	}
+
+	// append the result back
+	// a name not among the arguments is written as it is, "{name}"
+	// @return: false on a format error, see parse_format, or when a name is not found.
+	template<typename...Args>
+	inline bool format_to(std::u16string& out, std::u16string_view fmt, Args&&...args)
+	{
+		const uint32_t hashes[] = { arg_name_hash(args)... };
+		const std::u16string_view names[] = { arg_name(args)... };
+		bool names_found = true;
+
+		const bool parsed = parse_format(fmt,
+			[&out](std::u16string_view literal)
+			{
+				out.append(literal);
+			},
+			[&](const placeholder& holder)
+			{
+				const size_t index = (holder.index != SIZE_MAX)
+					? holder.index
+					: find_named_arg(hashes, names, sizeof...(Args), holder.name_hash, holder.name);
+				if (index == SIZE_MAX)
+				{
+					out.append(holder.text);
+					names_found = false;
+					return;
+				}
+				to_string_index(index, holder.alignment, out, holder.param, args...);
+			});
+		return parsed && names_found;
+	}
+
+	template<typename...Args>
+	inline std::u16string format(std::u16string_view fmt, Args&&...args)
+	{
+		std::u16string ans;
+		ans.reserve(fmt.size() + sizeof...(Args) * 8);
+		format_to(ans, fmt, std::forward<Args>(args)...);
+		return ans;
+	}
+
+	// A format string parsed once, rendered many times.
+	// Names listed at construction are resolved to argument slots here,
+	// other names are resolved by hash when rendering.
+	// parsed_format f(u"{player} got {count} coins", { u"player", u"count" });
+	// f.format(name, 3) == f.format(ofmt::arg(u"player", name), ofmt::arg(u"count", 3))
+	class parsed_format
+	{
+	public:
+
+		explicit parsed_format(std::u16string_view fmt, std::initializer_list<std::u16string_view> names = {})
+			: _fmt(fmt)
+		{
+			const std::u16string_view view(_fmt);
+			_valid = parse_format(view,
+				[this, view](std::u16string_view literal)
+				{
+					if (literal.empty()) return;
+					segment seg;
+					seg.offset = literal.data() - view.data();
+					seg.length = literal.size();
+					_segments.push_back(seg);
+				},
+				[this, view, &names](const placeholder& holder)
+				{
+					segment seg;
+					seg.is_placeholder = true;
+					seg.index = holder.index;
+					seg.name_hash = holder.name_hash;
+					seg.alignment = holder.alignment;
+					seg.offset = holder.param.empty() ? 0 : holder.param.data() - view.data();
+					seg.length = holder.param.size();
+					seg.name_offset = holder.name.empty() ? 0 : holder.name.data() - view.data();
+					seg.name_length = holder.name.size();
+					seg.text_offset = holder.text.data() - view.data();
+					seg.text_length = holder.text.size();
+					if (seg.index == SIZE_MAX)
 					{
-						param_colon = i;
-						for (; i < fmt.size(); ++i)
+						size_t slot = 0;
+						for (const auto& name : names)
 						{
-							if (fmt.data()[i] == u'}')
+							if (name_hash(name) == seg.name_hash && name == holder.name)
 							{
-								c = fmt.data()[i];
+								seg.index = slot;
 								break;
 							}
+							++slot;
 						}
 					}
-					if (c == u'}')
-					{
-						to_string_index(
-							(auto_index == -1) ? index : auto_index,
-							alignment,
-							ans,
-							(param_colon == SIZE_MAX) ? u"" : fmt.substr(param_colon, i - param_colon),
-							std::forward<Args>(args)...
-						);
-						prev_holder = i + 1;
-						break;
-					}
-					else
-					{
-						assert(false && "unknown format.");
-					}
-				}
-					
-			}
-			// "}}" -> "}"
-			else if (c == u'}')
+					_segments.push_back(seg);
+				});
+		}
+
+		template<typename...Args>
+		[[nodiscard]] std::u16string format(Args&&...args) const
+		{
+			std::u16string ans;
+			ans.reserve(_fmt.size() + sizeof...(Args) * 8);
+			format_to(ans, std::forward<Args>(args)...);
+			return ans;
+		}
+
+		// append the result back, same rules as ofmt::format_to
+		// @return: false when the format is not valid or a name is not found.
+		template<typename...Args>
+		bool format_to(std::u16string& out, Args&&...args) const
+		{
+			const std::u16string_view view(_fmt);
+			bool names_found = true;
+			const uint32_t hashes[] = { 0u, arg_name_hash(args)... };
+			const std::u16string_view names[] = { std::u16string_view(), arg_name(args)... };
+			for (const segment& seg : _segments)
 			{
-				++i;
-				if (fmt.data()[i] == u'}')
+				if (!seg.is_placeholder)
+				{
+					out.append(view.substr(seg.offset, seg.length));
+					continue;
+				}
+				const size_t index = (seg.index != SIZE_MAX)
+					? seg.index
+					: find_named_arg(hashes + 1, names + 1, sizeof...(Args), seg.name_hash, view.substr(seg.name_offset, seg.name_length));
+				if (index == SIZE_MAX)
 				{
-					ans.append(fmt.substr(prev_holder, i - prev_holder));
-					prev_holder = i + 1;
+					out.append(view.substr(seg.text_offset, seg.text_length));
+					names_found = false;
 					continue;
 				}
+				if constexpr (sizeof...(Args) > 0)
+					to_string_index(index, seg.alignment, out, view.substr(seg.offset, seg.length), args...);
 			}
+			return _valid && names_found;
 		}
-		ans.append(fmt.substr(prev_holder));
 
-		return ans;
-	}
+		[[nodiscard]] std::u16string_view raw() const noexcept
+		{
+			return _fmt;
+		}
+
+		// false on a format error, the segments then end with the rest of the string as a literal
+		// names are only known when rendering, format_to reports one not found
+		[[nodiscard]] bool is_valid() const noexcept
+		{
+			return _valid;
+		}
+
+	private:
+
+		// a literal, or a placeholder with its param
+		struct segment
+		{
+			size_t offset = 0;
+			size_t length = 0;
+			size_t index = 0;
+			uint32_t name_hash = 0;
+			size_t name_offset = 0;
+			size_t name_length = 0;
+			size_t text_offset = 0;
+			size_t text_length = 0;
+			int alignment = 0;
+			bool is_placeholder = false;
+		};
 
+		std::u16string _fmt;
+		std::vector<segment> _segments;
+		bool _valid = true;
+	};
 
 }
 
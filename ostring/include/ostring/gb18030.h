@@ -0,0 +1,107 @@
+#pragma once
+#include "definitions.h"
+#include "coder.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+_NS_OSTR_BEGIN
+
+// GB18030, the chinese national encoding, to and from utf-16.
+// It is a superset of GBK and GB2312 and maps every unicode code point:
+// one byte for ascii, two bytes from a generated table, four bytes by ranges of the linear code.
+namespace coder {
+
+	// bytes of gb18030 any count of utf-16 code units fits in
+	constexpr size_t gb18030_capacity(size_t u16_count) noexcept
+	{
+		return u16_count * 4;
+	}
+
+	// decode gb18030 into utf-16, runs of ascii are widened 16 bytes at a time
+	// an invalid byte is one U+FFFD, so is an unassigned four byte code, pass_through is taken as replace.
+	// @param out_u16: at least utf16_capacity(gb.size()) code units.
+	// @param final: false to stop before an incomplete sequence at the end, read tells where.
+	OPEN_STRING_EXPORT transcode_result decode_gb18030(std::string_view gb, char16_t* out_u16, bool final = true, error_policy policy = error_policy::replace) noexcept;
+
+	// encode utf-16 into gb18030, a lone surrogate is U+FFFD, pass_through is taken as replace
+	// @param out_gb: at least gb18030_capacity(sv16.size()) bytes.
+	// @param final: false to stop before a lead surrogate at the end.
+	OPEN_STRING_EXPORT transcode_result encode_gb18030(std::u16string_view sv16, char* out_gb, bool final = true, error_policy policy = error_policy::replace) noexcept;
+
+	OPEN_STRING_EXPORT bool convert_append_gb18030(std::string_view gb, std::u16string& out_u16);
+
+	OPEN_STRING_EXPORT bool convert_append_gb18030(std::u16string_view sv16, std::string& out_gb);
+
+	// Decode gb18030 arriving in pieces, a sequence cut by a piece is completed by the next feed.
+	// gb18030_decoder decoder;
+	// while (recv(buffer)) decoder.feed(buffer, text);
+	// decoder.finish(text);
+	class OPEN_STRING_EXPORT gb18030_decoder
+	{
+	public:
+
+		// @param out_u16: at least utf16_capacity(pending() + chunk.size()) code units.
+		// @return: code units written.
+		size_t feed(std::string_view chunk, char16_t* out_u16) noexcept;
+
+		void feed(std::string_view chunk, std::u16string& out_u16);
+
+		// end of input, a pending incomplete sequence is written as U+FFFD
+		// @param out_u16: at least utf16_capacity(pending()) code units.
+		size_t finish(char16_t* out_u16) noexcept;
+
+		void finish(std::u16string& out_u16);
+
+		// bytes of a cut two or four byte code held from the last feed, 3 at most
+		[[nodiscard]] size_t pending() const noexcept
+		{
+			return _size;
+		}
+
+		void reset() noexcept
+		{
+			_size = 0;
+		}
+
+	private:
+
+		char _pending[3];
+		size_t _size = 0;
+	};
+
+	// Encode utf-16 arriving in pieces to gb18030, a surrogate pair cut by a piece is joined.
+	class OPEN_STRING_EXPORT gb18030_encoder
+	{
+	public:
+
+		// @param out_gb: at least gb18030_capacity(pending() + chunk.size()) bytes.
+		// @return: bytes written.
+		size_t feed(std::u16string_view chunk, char* out_gb) noexcept;
+
+		void feed(std::u16string_view chunk, std::string& out_gb);
+
+		// end of input, a pending lead surrogate is written as U+FFFD
+		// @param out_gb: at least gb18030_capacity(pending()) bytes.
+		size_t finish(char* out_gb) noexcept;
+
+		void finish(std::string& out_gb);
+
+		// code units held from the last feed, a lead surrogate waiting for its trail
+		[[nodiscard]] size_t pending() const noexcept
+		{
+			return _lead ? 1 : 0;
+		}
+
+		void reset() noexcept
+		{
+			_lead = 0;
+		}
+
+	private:
+
+		char16_t _lead = 0;
+	};
+};
+
+_NS_OSTR_END
@@ -4,6 +4,10 @@
 #include <string_view>
 #include <vector>
 #include <functional>
+#include <limits>
+#include <cmath>
+#include "fmt/format.h"
+#include "simd.h"
 #include "definitions.h"
 #include "types.h"
 
@@ -89,13 +93,26 @@ namespace helper
 			if (!c0) return; 
 			char8_t utf8_mask;
 			out_utf8_length = utf8_sequence_length(c0, utf8_mask);
+			// a stray continuation byte or a lead of more than 4 bytes, skip just it
+			if (out_utf8_length == 0 || out_utf8_length > 4)
+			{
+				out_utf8_length = 1;
+				out_utf32 = 0xFFFD;
+				return;
+			}
 			out_utf32 = c0 & (~utf8_mask);
-			for (size_t i = 1; i < out_utf8_length; ++i)
+			for (small_size_t i = 1; i < out_utf8_length; ++i)
 			{
 				const char8_t ci = utf8[i];
+				// cut short, by the terminator as well, the bytes read so far stand for one U+FFFD
+				if ((ci & 0xC0) != 0x80)
+				{
+					out_utf8_length = i;
+					out_utf32 = 0xFFFD;
+					return;
+				}
 				out_utf32 <<= UTF8_BIT_SEQUENCE_FOLLOWING;
-				const size_t assert_zero = utf8_sequence_length(ci, utf8_mask); (void)assert_zero;
-				out_utf32 |= ci & (~utf8_mask);
+				out_utf32 |= ci & 0x3F;
 			}
 		}
 
@@ -126,18 +143,23 @@ namespace helper
 			}
 		}
 
-		inline void utf16_to_utf32(char16_t const* const utf16, small_size_t& out_utf16_length, char32_t& out_utf32, endian e = endian::big)
+		// a code unit read from or written in byte order e, swapped when e is not the native one
+		inline constexpr char16_t swap_endian(char16_t c, endian e)
+		{
+			return e == endian::native ? c : static_cast<char16_t>((c << 8) | (c >> 8));
+		}
+
+		inline void utf16_to_utf32(char16_t const* const utf16, small_size_t& out_utf16_length, char32_t& out_utf32, endian e = endian::native)
 		{
-			// assume little endian temporarily
 			out_utf32 = 0;
 			out_utf16_length = 0;
 			if (!utf16) return;
-			char16_t c0 = utf16[0];
+			char16_t c0 = swap_endian(utf16[0], e);
 			if (!c0) return;
 			out_utf32 = c0;
 			if (is_lead_surrogate(c0))
 			{
-				char16_t c1 = utf16[1];
+				char16_t c1 = swap_endian(utf16[1], e);
 				const bool assert_true = is_trail_surrogate(c1);
 				if (assert_true)
 				{
@@ -159,9 +181,8 @@ namespace helper
 			}
 		}
 
-		inline void utf32_to_utf16(char32_t utf32, surrogate_pair& out_utf16_char, small_size_t& out_utf16_length, endian e = endian::big)
+		inline void utf32_to_utf16(char32_t utf32, surrogate_pair& out_utf16_char, small_size_t& out_utf16_length, endian e = endian::native)
 		{
-			// assume little endian temporarily
 			if (!utf32) return;
 
 			out_utf16_char[0] = 0;
@@ -180,6 +201,8 @@ namespace helper
 				out_utf16_length = 1;
 				out_utf16_char[0] = static_cast<char16_t>( utf32 );
 			}
+			out_utf16_char[0] = swap_endian(out_utf16_char[0], e);
+			out_utf16_char[1] = swap_endian(out_utf16_char[1], e);
 		}
 
 		// convert utf8 sequence into utf16 char(s)
@@ -187,7 +210,7 @@ namespace helper
 		// @param out_utf8_length: length of utf8 sequence
 		// @param out_utf16_char: utf16 char wich hold the real value of grapheme
 		// @param out_utf16_length: array length of param out_utf16_char, 2 when surrogate pair
-		inline void utf8_to_utf16(const char8_t* utf8, small_size_t& out_utf8_length, surrogate_pair& out_utf16_char, small_size_t& out_utf16_length, endian e = endian::big)
+		inline void utf8_to_utf16(const char8_t* utf8, small_size_t& out_utf8_length, surrogate_pair& out_utf16_char, small_size_t& out_utf16_length, endian e = endian::native)
 		{
 			char32_t value;
 			utf8_to_utf32(utf8, out_utf8_length, value);
@@ -199,7 +222,7 @@ namespace helper
 		// @param out_utf8_length: length of utf8 sequence
 		// @param out_utf16_char: utf16 char wich hold the real value of grapheme
 		// @param out_utf16_length: array length of param out_utf16_char, 2 when surrogate pair
-		inline void utf16_to_utf8(char16_t const* const utf16, small_size_t& out_utf16_length, utf8_sequence& out_utf8, small_size_t& out_utf8_length, endian e = endian::big)
+		inline void utf16_to_utf8(char16_t const* const utf16, small_size_t& out_utf16_length, utf8_sequence& out_utf8, small_size_t& out_utf8_length, endian e = endian::native)
 		{
 			char32_t value;
 			utf16_to_utf32(utf16, out_utf16_length, value, e);
@@ -266,52 +289,371 @@ namespace helper
 			return ans;
 		}
 
+		// "00" "01" ... "99", used to emit decimal digits two at a time
+		constexpr char digit_pairs[] =
+			"0001020304050607080910111213141516171819"
+			"2021222324252627282930313233343536373839"
+			"4041424344454647484950515253545556575859"
+			"6061626364656667686970717273747576777879"
+			"8081828384858687888990919293949596979899";
+
+		// append decimal representation of an integer of any width
+		// @param arg: the integer, INT_MIN, INT64_MIN etc. are handled
+		// @param out: string to append back
+		template<typename I, typename T>
+		inline void append_int(I arg, std::basic_string<T>& out)
+		{
+			static_assert(std::is_integral_v<I>, "append_int only works for integers.");
+			using U = std::make_unsigned_t<I>;
+			U value = static_cast<U>(arg);
+			if constexpr (std::is_signed_v<I>)
+			{
+				if (arg < 0)
+				{
+					out.push_back(T('-'));
+					value = U(0) - value;
+				}
+			}
+
+			T buffer[std::numeric_limits<U>::digits10 + 1];
+			T* const end = buffer + std::size(buffer);
+			T* p = end;
+			while (value >= 100)
+			{
+				const size_t i = static_cast<size_t>(value % 100) * 2;
+				value /= 100;
+				*--p = T(digit_pairs[i + 1]);
+				*--p = T(digit_pairs[i]);
+			}
+			if (value >= 10)
+			{
+				const size_t i = static_cast<size_t>(value) * 2;
+				*--p = T(digit_pairs[i + 1]);
+				*--p = T(digit_pairs[i]);
+			}
+			else
+			{
+				*--p = T('0' + static_cast<char>(value));
+			}
+			out.append(p, end);
+		}
+
 		template<typename T>
 		inline void from_int(int arg, std::basic_string<T>& out)
 		{
 			out.clear();
-			if (arg == 0)
+			append_int(arg, out);
+		}
+
+		// lay out decimal digits as a float number
+		// value == digits * 10^exp
+		// @param digits: decimal significand, no leading zeros, may be empty for zero
+		// @param precision: digits after point for fixed and scientific, significant digits for general, -1 for shortest
+		template<typename T>
+		inline void append_float_digits(const char* digits, int count, int exp, float_format format, int precision, bool upper, std::basic_string<T>& out)
+		{
+			if (count == 0)
+			{
+				digits = "0";
+				count = 1;
+			}
+
+			// exponent of the leading digit, 1.23e+04 -> 4
+			const int leading_exp = count + exp - 1;
+			bool scientific = format == float_format::scientific;
+			if (format == float_format::general)
+			{
+				// same thresholds as printf %g, which takes precision 0 as 1, and fmt for the shortest
+				const int upper_limit = precision > 0 ? precision : (precision == 0 ? 1 : 16);
+				scientific = leading_exp < -4 || leading_exp >= upper_limit;
+			}
+
+			if (scientific)
 			{
-				out.append(1, u'0');
+				const int padding = (format == float_format::scientific && precision > count - 1) ? precision - (count - 1) : 0;
+				out.push_back(T(digits[0]));
+				if (count > 1 || padding > 0)
+				{
+					out.push_back(T('.'));
+					out.append(digits + 1, digits + count);
+					out.append(padding, T('0'));
+				}
+				out.push_back(upper ? T('E') : T('e'));
+				out.push_back(leading_exp < 0 ? T('-') : T('+'));
+				const int abs_exp = std::abs(leading_exp);
+				if (abs_exp < 10)
+					out.push_back(T('0'));
+				append_int(abs_exp, out);
 				return;
 			}
-			int i = std::abs(arg);
-			size_t size = (size_t)(floor(log10(i)) + 1) + (arg < 0 ? 1 : 0);
-			out.append(size, u'0');
-			if (arg < 0) {
-				--size;
-				out[size] = u'-';
+
+			// count of digits before the point
+			const int point = count + exp;
+			int fraction = 0;
+			if (point <= 0)
+			{
+				out.push_back(T('0'));
+				out.push_back(T('.'));
+				out.append(-point, T('0'));
+				out.append(digits, digits + count);
+				fraction = count - point;
 			}
-			for (int p = 0; p < size; ++p)
+			else if (point >= count)
+			{
+				out.append(digits, digits + count);
+				out.append(point - count, T('0'));
+			}
+			else
 			{
-				out[p] = (i % 10 + u'0');
-				i /= 10;
+				out.append(digits, digits + point);
+				out.push_back(T('.'));
+				out.append(digits + point, digits + count);
+				fraction = count - point;
+			}
+
+			if (format == float_format::fixed && precision > fraction)
+			{
+				if (fraction == 0)
+					out.push_back(T('.'));
+				out.append(precision - fraction, T('0'));
 			}
-			std::reverse(out.begin(), out.end());
+		}
+
+		// append a float number
+		// shortest representation which round-trips when precision < 0 (dragonbox),
+		// correctly rounded digits otherwise (grisu with dragon4 fallback)
+		// @param format: fixed, scientific, or general which chooses by magnitude
+		// @param precision: digits after point for fixed and scientific, significant digits for general
+		// @param upper: use "E", "INF", "NAN"
+		template<typename F, typename T>
+		inline void append_float(F arg, std::basic_string<T>& out, float_format format = float_format::general, int precision = -1, bool upper = false)
+		{
+			static_assert(std::is_same_v<F, float> || std::is_same_v<F, double>, "append_float only works for float and double.");
+			if (std::isnan(arg))
+			{
+				const char* nan = upper ? "NAN" : "nan";
+				out.append(nan, nan + 3);
+				return;
+			}
+			if (std::signbit(arg))
+			{
+				out.push_back(T('-'));
+				arg = -arg;
+			}
+			if (std::isinf(arg))
+			{
+				const char* inf = upper ? "INF" : "inf";
+				out.append(inf, inf + 3);
+				return;
+			}
+
+			if (precision < 0)
+			{
+				const auto dec = fmt::detail::dragonbox::to_decimal(arg);
+				char digits[std::numeric_limits<decltype(dec.significand)>::digits10 + 1];
+				char* const end = digits + std::size(digits);
+				char* p = end;
+				auto significand = dec.significand;
+				do
+				{
+					*--p = static_cast<char>('0' + significand % 10);
+					significand /= 10;
+				} while (significand != 0);
+				append_float_digits(p, static_cast<int>(end - p), dec.exponent, format, precision, upper, out);
+				return;
+			}
+
+			fmt::detail::float_specs specs = {};
+			specs.format = format == float_format::fixed ? fmt::detail::float_format::fixed
+				: format == float_format::scientific ? fmt::detail::float_format::exp
+				: fmt::detail::float_format::general;
+			specs.binary32 = std::is_same_v<F, float>;
+			specs.use_grisu = true;
+
+			// significant digits wanted by fmt
+			int digits_precision = precision;
+			if (format == float_format::scientific)
+				++digits_precision;
+			else if (format == float_format::general && precision == 0)
+				digits_precision = 1;
+
+			fmt::memory_buffer digits;
+			int exp = fmt::detail::format_float(static_cast<double>(arg), digits_precision, specs, digits);
+			// all digits rounded away, 0.0004 -> 0.00
+			if (digits.size() == 0 && format == float_format::fixed)
+				exp = -precision;
+			append_float_digits(digits.data(), static_cast<int>(digits.size()), exp, format, precision, upper, out);
 		}
 
 		template<typename T>
 		inline void from_float_round(float arg, std::basic_string<T>& out)
 		{
 			out.clear();
-			// TODO: use Schubfach algorithm to round float
-			// which implemented by dragon box
-			float n = std::abs(arg);
-			float i;
-			float f = modff(n, &i);
-			from_int((int)i, out);
+			append_float(arg, out);
+		}
 
-			out.push_back(u'.');
+		template<typename T>
+		struct from_chars_result
+		{
+			const T* ptr;
+			std::errc ec;
+		};
 
-			while (f > 0.01)
+		// value of a digit in base 36, UINT8_MAX when not a digit
+		template<typename T>
+		inline uint8_t digit_value(T c)
+		{
+			if (c >= T('0') && c <= T('9')) return static_cast<uint8_t>(c - T('0'));
+			if (c >= T('a') && c <= T('z')) return static_cast<uint8_t>(c - T('a') + 10);
+			if (c >= T('A') && c <= T('Z')) return static_cast<uint8_t>(c - T('A') + 10);
+			return UINT8_MAX;
+		}
+
+		// narrow 8 code units into 8 bytes, in memory order
+		// code units above 0xff become 0xff, which is never a digit
+		template<typename T>
+		inline uint64_t load_eight_bytes(const T* p)
+		{
+			if constexpr (sizeof(T) == 1)
 			{
-				f *= 10;
-				float ip;
-				f = std::modff(f, &ip);
-				out.push_back((int)ip + u'0');
+				uint64_t v = 0;
+				for (int i = 0; i < 8; ++i)
+					v |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (i * 8);
+				return v;
+			}
+			else
+			{
+#if OSTR_SSE2
+				const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+				uint64_t v;
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(&v), _mm_packus_epi16(units, units));
+				return v;
+#else
+				uint64_t v = 0;
+				for (int i = 0; i < 8; ++i)
+					v |= static_cast<uint64_t>(p[i] > 0xff ? 0xff : p[i]) << (i * 8);
+				return v;
+#endif
 			}
 		}
 
+		// are all 8 bytes ascii digits
+		inline bool is_eight_digits(uint64_t v)
+		{
+			return ((v & 0xF0F0F0F0F0F0F0F0) | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+		}
+
+		// parse 8 ascii digits in one step, SWAR
+		// "12345678" -> 12345678
+		inline uint32_t parse_eight_digits(uint64_t v)
+		{
+			constexpr uint64_t mask = 0x000000FF000000FF;
+			constexpr uint64_t mul1 = 0x000F424000000064; // 100 + (1000000ULL << 32)
+			constexpr uint64_t mul2 = 0x0000271000000001; // 1 + (10000ULL << 32)
+			v -= 0x3030303030303030;
+			v = (v * 10) + (v >> 8);
+			v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+			return static_cast<uint32_t>(v);
+		}
+
+		// parse an integer like std::from_chars
+		// no whitespace or base prefix skipped, a leading '+' is accepted, '-' only for signed types
+		// @param out: the value, untouched when failed
+		// @param base: 2 to 36
+		// @return: ptr to the first code unit not consumed, ec == std::errc() when succeed
+		template<typename T, typename I>
+		inline from_chars_result<T> from_chars(const T* first, const T* last, I& out, int base = 10)
+		{
+			static_assert(std::is_integral_v<I>, "from_chars only works for integers.");
+			constexpr size_t max_u64_digits = 20;
+			constexpr uint64_t min_20_digits = 10000000000000000000ull;
+
+			if (base < 2 || base > 36)
+				return { first, std::errc::invalid_argument };
+
+			const T* p = first;
+			bool negative = false;
+			if (p < last && (*p == T('-') || *p == T('+')))
+			{
+				negative = *p == T('-');
+				if (negative && !std::is_signed_v<I>)
+					return { first, std::errc::invalid_argument };
+				++p;
+			}
+
+			const T* const digits_begin = p;
+			while (p < last && *p == T('0'))
+				++p;
+			const T* const significant = p;
+
+			uint64_t value = 0;
+			bool overflow = false;
+			if (base == 10)
+			{
+				while (last - p >= 8)
+				{
+					const uint64_t eight = load_eight_bytes(p);
+					if (!is_eight_digits(eight))
+						break;
+					value = value * 100000000 + parse_eight_digits(eight);
+					p += 8;
+				}
+				for (; p < last; ++p)
+				{
+					const auto d = static_cast<std::make_unsigned_t<T>>(*p - T('0'));
+					if (d >= 10) break;
+					value = value * 10 + d;
+				}
+				// at most 20 digits fit, and a wrapped 20-digit value starting with 1 is below 10^19
+				const size_t count = p - significant;
+				if (count > max_u64_digits)
+					overflow = true;
+				else if (count == max_u64_digits)
+					overflow = *significant > T('1') || value < min_20_digits;
+			}
+			else
+			{
+				const uint64_t max_div = UINT64_MAX / base;
+				const uint64_t max_rem = UINT64_MAX % base;
+				for (; p < last; ++p)
+				{
+					const uint8_t d = digit_value(*p);
+					if (d >= base) break;
+					if (value > max_div || (value == max_div && d > max_rem))
+						overflow = true;
+					value = value * base + d;
+				}
+			}
+
+			if (p == digits_begin)
+				return { first, std::errc::invalid_argument };
+
+			using U = std::make_unsigned_t<I>;
+			const uint64_t limit = negative
+				? static_cast<uint64_t>(std::numeric_limits<I>::max()) + 1
+				: static_cast<uint64_t>(std::numeric_limits<I>::max());
+			if (overflow || value > limit)
+				return { p, std::errc::result_out_of_range };
+
+			out = negative
+				? static_cast<I>(U(0) - static_cast<U>(value))
+				: static_cast<I>(value);
+			return { p, std::errc() };
+		}
+
+		// parse a float number like std::from_chars with chars_format::general
+		// "[+-](digits[.digits]|.digits)[(e|E)[+-]digits]", inf, infinity and nan, case insensitive
+		// correctly rounded: Eisel-Lemire, with an exact fallback for hard cases, no allocation
+		// @param out: the value, untouched when failed or out of range
+		// @return: ptr to the first code unit not consumed, ec == std::errc() when succeed
+		OPEN_STRING_EXPORT from_chars_result<char> from_chars(const char* first, const char* last, double& out);
+
+		OPEN_STRING_EXPORT from_chars_result<char> from_chars(const char* first, const char* last, float& out);
+
+		OPEN_STRING_EXPORT from_chars_result<char16_t> from_chars(const char16_t* first, const char16_t* last, double& out);
+
+		OPEN_STRING_EXPORT from_chars_result<char16_t> from_chars(const char16_t* first, const char16_t* last, float& out);
+
 		// calculate surrogate pair inside, only work for char16_t
 		template<typename _Iter, typename = ::std::enable_if<::std::is_same_v<::std::iterator_traits<_Iter>, char16_t>>>
 		inline size_t count_surrogate_pair(_Iter from, _Iter end)
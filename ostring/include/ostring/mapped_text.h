@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+#include "osv.h"
+
+_NS_OSTR_BEGIN
+
+// Read-only utf-8 file mapped into memory, decoded to utf-16 a page at a time.
+// A page is decoded the first time it is touched and kept in a small LRU cache,
+// so only the regions read are paged in and transcoded. Not thread safe.
+// mapped_text text("big.log");
+// const size_t at = text.index_of(u"ERROR");
+// string_view around = text.substring(at, 80);
+class OPEN_STRING_EXPORT mapped_text
+{
+public:
+
+	// bytes of utf-8 per page, moved forward to the next code point boundary
+	static constexpr size_t page_size = 64 * 1024;
+
+	static constexpr size_t default_cache_pages = 16;
+
+	// @param path: in the native narrow encoding.
+	// @param cache_pages: decoded pages kept, 2 at least.
+	explicit mapped_text(const char* path, size_t cache_pages = default_cache_pages);
+
+	~mapped_text();
+
+	mapped_text(const mapped_text&) = delete;
+	mapped_text& operator=(const mapped_text&) = delete;
+
+	// the file could be opened and mapped, an empty file counts
+	[[nodiscard]] bool is_open() const noexcept
+	{
+		return _open;
+	}
+
+	[[nodiscard]] size_t byte_size() const noexcept
+	{
+		return _size;
+	}
+
+	[[nodiscard]] size_t page_count() const noexcept
+	{
+		return (_size + page_size - 1) / page_size;
+	}
+
+	// pages transcoded so far, a page evicted and touched again counts twice
+	[[nodiscard]] size_t pages_decoded() const noexcept
+	{
+		return _decoded;
+	}
+
+	// decoded text of a page, ill-formed bytes as U+FFFD
+	// @return: valid until the page is evicted, that is until cache_pages other pages are touched.
+	string_view page(size_t index);
+
+	// code points of the whole text, every page is counted once
+	size_t length();
+
+	// code points [offset, offset + count), cut to the end of the text
+	// offsets are counted page by page up to the one asked for, only the first time.
+	// @return: into the page cache when within one page, else joined into a buffer valid until the next call.
+	string_view substring(size_t offset, size_t count);
+
+	// the first match at or after from, pages scanned in order
+	// @param pattern: shorter than a page.
+	// @return: offset in code points, SIZE_MAX if not found.
+	size_t index_of(const string_view& pattern, size_t from = 0);
+
+private:
+
+	struct cached_page
+	{
+		std::u16string text;
+		size_t page = SIZE_MAX;
+		uint64_t used = 0;
+	};
+
+	// a unit of a page and its code point offset within the page
+	struct page_position
+	{
+		size_t page = SIZE_MAX;
+		size_t unit = 0;
+		size_t codepoint = 0;
+	};
+
+	// byte offset where the page begins, after any continuation bytes
+	size_t page_begin(size_t index) const noexcept;
+
+	void decode(size_t index, std::u16string& out) const;
+
+	// code point offset where the page begins
+	size_t page_offset(size_t index);
+
+	// page holding the code point offset, page_count() past the end
+	size_t locate(size_t offset);
+
+	// unit index of the code point count into a page, text is its decoded text
+	size_t unit_index(size_t index, std::u16string_view text, size_t count);
+
+	// code points before the unit index of a page
+	size_t codepoint_index(size_t index, std::u16string_view text, size_t unit);
+
+	bool _open = false;
+	const char* _data = nullptr;
+	size_t _size = 0;
+
+	std::vector<cached_page> _cache;
+	size_t _cache_pages;
+	// slot in _cache of every page, SIZE_MAX if not cached
+	std::vector<size_t> _slots;
+	uint64_t _tick = 0;
+	size_t _decoded = 0;
+
+	// code point offset of each page counted so far, the first is 0
+	std::vector<size_t> _offsets;
+	// surrogate pairs of each page counted so far, units and code points are the same without
+	std::vector<size_t> _pairs;
+	// the last position converted in a page with pairs, later ones in the page resume from it
+	page_position _last;
+
+	std::u16string _scratch;
+	std::u16string _joined;
+};
+
+_NS_OSTR_END
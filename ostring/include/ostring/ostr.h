@@ -1,43 +1,114 @@
 #pragma once
 #include "definitions.h"
+#include <cstring>
+#include <memory>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 #include <algorithm>
 
+#include "detect.h"
 #include "format.h"
 #include "helpers.h"
 #include "osv.h"
 
 _NS_OSTR_BEGIN
 
-class OPEN_STRING_EXPORT string
+template<typename Alloc>
+class basic_string;
+
+class string_builder;
+
+namespace ofmt {
+	// the arguments start with std::allocator_arg, told apart from plain ones
+	template<typename...Args>
+	constexpr bool leads_with_allocator_arg = false;
+
+	template<typename First, typename...Rest>
+	constexpr bool leads_with_allocator_arg<First, Rest...> = std::is_same_v<std::decay_t<First>, std::allocator_arg_t>;
+
+	// formatted into memory from alloc, rendered first in a buffer reused by the thread
+	// ofmt::format(std::allocator_arg, std::pmr::polymorphic_allocator<char16_t>(&arena), u"{0} got {1}", name, 3)
+	// a memory resource is taken by the overload after pmr::string
+	template<typename Alloc, typename...Args, typename = std::enable_if_t<!std::is_convertible_v<Alloc, std::pmr::memory_resource*>>>
+	inline basic_string<Alloc> format(std::allocator_arg_t, const Alloc& alloc, std::u16string_view fmt, Args&&...args)
+	{
+		thread_local std::u16string scratch;
+		thread_local size_t depth = 0;
+		// an argument formatted the same way inside gets a buffer of its own
+		++depth;
+		struct depth_guard
+		{
+			~depth_guard() { --depth; }
+		} guard;
+		std::u16string nested;
+		std::u16string& out = depth == 1 ? scratch : nested;
+		out.clear();
+		format_to(out, fmt, std::forward<Args>(args)...);
+		return basic_string<Alloc>(std::u16string_view(out), alloc);
+	}
+}
+
+// The string of code points on utf-16 storage from allocator Alloc.
+// string uses std::allocator, pmr::string takes a memory resource such as an arena.
+// Strings produced from one are allocated the same way unless an allocator is passed.
+// std::pmr::monotonic_buffer_resource arena;
+// pmr::string name(u"玩家"_o, &arena);
+template<typename Alloc = std::allocator<char16_t>>
+class basic_string
 {
+	// members are compiled in ostr.cpp for these two only
+	static_assert(std::is_same_v<Alloc, std::allocator<char16_t>> || std::is_same_v<Alloc, std::pmr::polymorphic_allocator<char16_t>>,
+		"basic_string takes std::allocator<char16_t> or std::pmr::polymorphic_allocator<char16_t>.");
+
 public:
 
-	string() = default;
-	string(string&&) = default;
-	string(const string&) = default;
-	string& operator=(string&&) = default;
-	string& operator=(const string&) = default;
+	using allocator_type = Alloc;
+	using storage_type = std::basic_string<char16_t, std::char_traits<char16_t>, Alloc>;
 
-	template<typename T>
-	string(const T* src, size_t len = SIZE_MAX)
-	{
-		using ut = std::make_unsigned_t< T >;
-		using up = std::add_pointer_t< std::add_const_t< ut > >;
-		std::basic_string_view<ut> sv((up)(src));
-		if(len != SIZE_MAX)
-			sv = sv.substr(0, len);
-		_str.assign(sv.cbegin(), sv.cend());
-		calculate_surrogate();
+	basic_string() = default;
+	basic_string(basic_string&&) = default;
+	basic_string(const basic_string&) = default;
+	basic_string& operator=(basic_string&&) = default;
+	basic_string& operator=(const basic_string&) = default;
+
+	explicit basic_string(const allocator_type& alloc) noexcept
+		: _str(alloc)
+	{
+	}
+
+	basic_string(const basic_string& rhs, const allocator_type& alloc)
+		: _str(rhs._str, alloc)
+		, _surrogate_pair_count(rhs._surrogate_pair_count)
+	{
+	}
+
+	// bytes are taken as latin-1 and widened in one pass, they never make a surrogate
+	// @param len: code units at most, the string still ends at a zero.
+	template<typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+	basic_string(const T* src, size_t len = SIZE_MAX, const allocator_type& alloc = allocator_type())
+		: _str(alloc)
+	{
+		size_t count;
+		if constexpr (sizeof(T) == 1)
+		{
+			const void* const zero = len == SIZE_MAX ? nullptr : std::memchr(src, 0, len);
+			count = len == SIZE_MAX ? std::strlen(reinterpret_cast<const char*>(src)) : zero ? size_t(static_cast<const T*>(zero) - src) : len;
+		}
+		else
+		{
+			count = std::basic_string_view<T>(src).size();
+			count = count < len ? count : len;
+		}
+		assign_units(src, count);
 	}
 
 	// Initializes a new instance of the string class with the value 
 	// indicated by a specified pointer to a pointer to 16-bit characters,
 	// and the endian it is.
 	// @param src: the c-style 16-bit characters.
-	string(const char16_t* src)
-		: _str(src)
+	basic_string(const char16_t* src, const allocator_type& alloc = allocator_type())
+		: _str(src, alloc)
 	{
 		calculate_surrogate();
 	}
@@ -47,8 +118,8 @@ public:
 	// and the endian it is.
 	// @param src: the c-style wide char.
 	// @param length: how many count to use.
-	string(const char16_t* src, size_t length)
-		: _str(src, length)
+	basic_string(const char16_t* src, size_t length, const allocator_type& alloc = allocator_type())
+		: _str(src, length, alloc)
 	{
 		calculate_surrogate();
 	}
@@ -57,47 +128,89 @@ public:
 	// cccc..[count]..cccc
 	// @param c: the char used to init.
 	// @param count: how may c.
-	string(const char16_t c, size_t count = 1)
-		: _surrogate_pair_count(0)
+	basic_string(const char16_t c, size_t count = 1, const allocator_type& alloc = allocator_type())
+		: _str(alloc)
+		, _surrogate_pair_count(0)
 	{
 		// ansi as well as BMP in first plane can trans to wide char without side effect
 		_str.resize(count, c);
 	}
 
 	template<typename T>
-	string(const std::basic_string<T>& str)
+	basic_string(const std::basic_string<T>& str, const allocator_type& alloc = allocator_type())
+		: _str(alloc)
 	{
-		using ut = std::make_unsigned_t< T >;
-		_str.assign((const ut*)str.data(), (const ut*)(str.data() + str.size()));
-		calculate_surrogate();
+		assign_units(str.data(), str.size());
 	}
 
 	template<typename T>
-	string(std::basic_string_view<T> str)
+	basic_string(std::basic_string_view<T> str, const allocator_type& alloc = allocator_type())
+		: _str(alloc)
 	{
-		using ut = std::make_unsigned_t< T >;
-		_str.assign((const ut*)str.data(), (const ut*)(str.data() + str.size()));
-		calculate_surrogate();
+		assign_units(str.data(), str.size());
 	}
 
-	string(const std::u16string& str)
-		: _str(str)
+	basic_string(const std::u16string& str, const allocator_type& alloc = allocator_type())
+		: _str(str.data(), str.size(), alloc)
 	{
 		calculate_surrogate();
 	}
 
-	string(std::u16string_view sv)
-		: _str(sv)
+	basic_string(std::u16string_view sv, const allocator_type& alloc = allocator_type())
+		: _str(sv, alloc)
 	{
 		calculate_surrogate();
 	}
 
-	string(string_view sv)
-		: _str(sv.raw())
+	basic_string(string_view sv, const allocator_type& alloc = allocator_type())
+		: _str(sv.raw(), alloc)
 	{
 		calculate_surrogate();
 	}
 
+	// utf-32 code points, each one outside the first plane becomes a surrogate pair
+	// surrogates and values past U+10FFFF are written as U+FFFD.
+	basic_string(std::u32string_view sv, const allocator_type& alloc = allocator_type())
+		: _str(alloc)
+	{
+		decode_from_utf32(sv);
+	}
+
+	basic_string(const std::u32string& str, const allocator_type& alloc = allocator_type())
+		: basic_string(std::u32string_view(str), alloc)
+	{
+	}
+
+	basic_string(const char32_t* src, const allocator_type& alloc = allocator_type())
+		: basic_string(std::u32string_view(src), alloc)
+	{
+	}
+
+	// wide chars, utf-16 where wchar_t is 2 bytes and utf-32 where it is 4
+	basic_string(std::wstring_view sv, const allocator_type& alloc = allocator_type())
+		: _str(alloc)
+	{
+		decode_from_wide(sv);
+	}
+
+	basic_string(const std::wstring& str, const allocator_type& alloc = allocator_type())
+		: basic_string(std::wstring_view(str), alloc)
+	{
+	}
+
+	basic_string(const wchar_t* src, const allocator_type& alloc = allocator_type())
+		: basic_string(std::wstring_view(src), alloc)
+	{
+	}
+
+	// raw utf-16 bytes, as read from a file or the wire
+	// @param e: order of the bytes, a byte order mark at the head wins over it.
+	basic_string(std::string_view bytes, endian e, const allocator_type& alloc = allocator_type())
+		: _str(alloc)
+	{
+		decode_from_utf16_bytes(bytes, e);
+	}
+
 	inline operator const string_view() const
 	{
 		return to_sv();
@@ -108,6 +221,11 @@ public:
 		return _str.c_str();
 	}
 
+	[[nodiscard]] allocator_type get_allocator() const noexcept
+	{
+		return _str.get_allocator();
+	}
+
 	// @return: the length of string.
 	[[nodiscard]] size_t length() const;
 
@@ -117,7 +235,7 @@ public:
 		return length() == 0;
 	}
 
-	[[nodiscard]] inline int compare(const string& rhs) const
+	[[nodiscard]] inline int compare(const basic_string& rhs) const
 	{
 		return _str.compare(rhs._str);
 	}
@@ -125,7 +243,7 @@ public:
 	// Are they totally equal?
 	// @param rhs: another string.
 	// @return: true if totally equal.
-	[[nodiscard]] inline bool operator==(const string& rhs) const
+	[[nodiscard]] inline bool operator==(const basic_string& rhs) const
 	{
 		return _str == rhs._str;
 	}
@@ -133,7 +251,7 @@ public:
 	// Are they different?
 	// @param rhs: another string.
 	// @return: true if different.
-	[[nodiscard]] inline bool operator!=(const string& rhs) const
+	[[nodiscard]] inline bool operator!=(const basic_string& rhs) const
 	{
 		return _str != rhs._str;
 	}
@@ -141,7 +259,7 @@ public:
 	// Compare with unicode value.
 	// @param rhs: another string.
 	// @return: true if less than rhs.
-	[[nodiscard]] inline bool operator<(const string& rhs) const
+	[[nodiscard]] inline bool operator<(const basic_string& rhs) const
 	{
 		return _str < rhs._str;
 	}
@@ -149,7 +267,7 @@ public:
 	// Compare with unicode value.
 	// @param rhs: another string.
 	// @return: true if less than or equal to rhs.
-	[[nodiscard]] inline bool operator<=(const string& rhs) const
+	[[nodiscard]] inline bool operator<=(const basic_string& rhs) const
 	{
 		return _str <= rhs._str;
 	}
@@ -157,7 +275,7 @@ public:
 	// Compare with unicode value.
 	// @param rhs: another string.
 	// @return: true if greater thsn rhs.
-	[[nodiscard]] inline bool operator>(const string& rhs) const
+	[[nodiscard]] inline bool operator>(const basic_string& rhs) const
 	{
 		return _str > rhs._str;
 	}
@@ -165,7 +283,7 @@ public:
 	// Compare with unicode value.
 	// @param rhs: another string.
 	// @return: true if greater than or equal to rhs.
-	[[nodiscard]] inline bool operator>=(const string& rhs) const
+	[[nodiscard]] inline bool operator>=(const basic_string& rhs) const
 	{
 		return _str >= rhs._str;
 	}
@@ -174,20 +292,26 @@ public:
 	// string("this") + "rhs" == string("thisrhs")
 	// @param rhs: append rhs back this string.
 	// @return: ref this string.
-	string& operator+=(const string& rhs);
+	basic_string& operator+=(const basic_string& rhs);
 
 	// Append back, get a new string instance without modify this string.
 	// string("this") + "rhs" == string("thisrhs")
 	// @param rhs: append rhs back this string.
 	// @return: a new result string instance.
-	[[nodiscard]] string operator+(const string& rhs);
+	[[nodiscard]] basic_string operator+(const basic_string& rhs) const&;
+
+	// the temporary on the left is appended to and moved out, a + b + c copies nothing twice
+	[[nodiscard]] basic_string operator+(const basic_string& rhs)&&;
 
 	// Get a new substring from specific position with specific size
 	// string("abcdefg").substring(2, 3) == string("cde");
 	// @param from: from where to start, 0 if from begin.
 	// @param size: how many chars you want.
-	// @return: the new substring instance
-	[[nodiscard]] string substring(size_t from, size_t size = SIZE_MAX) const;
+	// @return: the new substring instance, from the allocator of this string
+	[[nodiscard]] basic_string substring(size_t from, size_t size = SIZE_MAX) const;
+
+	// @param alloc: where the substring is allocated.
+	[[nodiscard]] basic_string substring(size_t from, size_t size, const allocator_type& alloc) const;
 
 	// Get the index of specific string
 	// string("abcdefg").index_of("cde") == 2;
@@ -210,45 +334,149 @@ public:
 		return string_view(*this).search(predicate);
 	}
 
-	string& replace_origin(size_t from, size_t count, const string_view& dest, case_sensitivity cs = case_sensitivity::sensitive);
+	basic_string& replace_origin(size_t from, size_t count, const string_view& dest, case_sensitivity cs = case_sensitivity::sensitive);
 
-	string& replace_origin(const string_view& src, const string_view& dest, case_sensitivity cs = case_sensitivity::sensitive);
+	basic_string& replace_origin(const string_view& src, const string_view& dest, case_sensitivity cs = case_sensitivity::sensitive);
 
 	// Returns a new string in which all occurrences of a specified string in the current instance
 	// are replaced with another specified string.
 	// @return: how many substrings have been replaced
-	[[nodiscard]] string replace_copy(const string_view& src, const string_view& dest, case_sensitivity cs = case_sensitivity::sensitive) const;
+	[[nodiscard]] basic_string replace_copy(const string_view& src, const string_view& dest, case_sensitivity cs = case_sensitivity::sensitive) const;
 
-	template<typename...Args>
-	[[nodiscard]] string format(Args&&...args) const
+	[[nodiscard]] basic_string replace_copy(const string_view& src, const string_view& dest, case_sensitivity cs, const allocator_type& alloc) const;
+
+	template<typename...Args, typename = std::enable_if_t<!ofmt::leads_with_allocator_arg<Args...>>>
+	[[nodiscard]] basic_string format(Args&&...args) const
 	{
 		// return fmt::format(_str.c_str(), go_str(std::forward<Args>(args))...);
-		return ofmt::format(_str.c_str(), std::forward<Args>(args)...);
+		return basic_string(ofmt::format(_str.c_str(), std::forward<Args>(args)...), get_allocator());
+	}
+
+	// formatted into memory from alloc, anything an allocator_type is made from
+	// str.format(std::allocator_arg, &arena, 3)
+	template<typename A, typename...Args>
+	[[nodiscard]] basic_string format(std::allocator_arg_t, const A& alloc, Args&&...args) const
+	{
+		return ofmt::format(std::allocator_arg, allocator_type(alloc), raw(), std::forward<Args>(args)...);
 	}
 
-	string& trim_start();
+	basic_string& trim_start();
 
-	string& trim_end();
+	basic_string& trim_end();
 
-	inline string& trim()
+	inline basic_string& trim()
 	{
 		return trim_start().trim_end();
 	}
 
-	[[nodiscard]] string trim_start_copy() const;
+	[[nodiscard]] basic_string trim_start_copy() const;
+
+	[[nodiscard]] basic_string trim_end_copy() const;
+
+	[[nodiscard]] basic_string trim_copy() const;
 
-	[[nodiscard]] string trim_end_copy() const;
+	[[nodiscard]] basic_string trim_start_copy(const allocator_type& alloc) const;
 
-	[[nodiscard]] string trim_copy() const;
+	[[nodiscard]] basic_string trim_end_copy(const allocator_type& alloc) const;
+
+	[[nodiscard]] basic_string trim_copy(const allocator_type& alloc) const;
 
 	[[nodiscard]] inline std::u16string_view raw() const
 	{
 		return std::u16string_view( _str );
 	}
 
+	// appended in memory from the allocator of this string
 	bool decode_from_utf8(std::string_view u8) noexcept
 	{
-		return coder::convert_append(u8, _str);
+		const size_t start = _str.size();
+		_str.resize(start + coder::utf16_capacity(u8.size()));
+		_str.resize(start + coder::decode_utf8(u8, _str.data() + start).written);
+		calculate_surrogate();
+		return true;
+	}
+
+	// bytes in the encoding coder::detect guessed, its byte order mark skipped
+	// @return: false for an unknown encoding, nothing is appended then.
+	bool decode_from(std::string_view bytes, const coder::detection& detection)
+	{
+		bytes.remove_prefix(std::min(detection.bom_size, bytes.size()));
+		switch (detection.detected)
+		{
+		case coder::encoding::utf8:
+			return decode_from_utf8(bytes);
+		case coder::encoding::utf16le:
+			return decode_from_utf16_bytes(bytes, endian::little);
+		case coder::encoding::utf16be:
+			return decode_from_utf16_bytes(bytes, endian::big);
+		case coder::encoding::gb18030:
+			return decode_from_gb18030(bytes);
+		default:
+			return false;
+		}
+	}
+
+	bool decode_from_utf32(std::u32string_view u32) noexcept
+	{
+		const bool ans = append_converted([u32](std::u16string& out) { return coder::convert_append(u32, out); });
+		calculate_surrogate();
+		return ans;
+	}
+
+	bool decode_from_wide(std::wstring_view w) noexcept
+	{
+		const bool ans = append_converted([w](std::u16string& out) { return coder::convert_append(w, out); });
+		calculate_surrogate();
+		return ans;
+	}
+
+	// gb18030, gbk or gb2312 appended, invalid bytes as U+FFFD
+	bool decode_from_gb18030(std::string_view gb)
+	{
+		const size_t start = _str.size();
+		_str.resize(start + coder::utf16_capacity(gb.size()));
+		_str.resize(start + coder::decode_gb18030(gb, _str.data() + start).written);
+		calculate_surrogate();
+		return true;
+	}
+
+	// raw utf-16 bytes appended, surrogate pairs are counted while the bytes are swapped
+	// @param e: order of the bytes, a byte order mark at the head wins over it.
+	// @return: false when an odd byte at the end was dropped.
+	bool decode_from_utf16_bytes(std::string_view bytes, endian e = endian::big)
+	{
+		e = coder::take_utf16_bom(bytes, e);
+		const size_t start = _str.size();
+		const bool lead = start != 0 && helper::codepoint::is_lead_surrogate(_str.back());
+		append_converted([&](std::u16string& out) { _surrogate_pair_count += coder::append_utf16_bytes(bytes, e, out); return true; });
+		if (lead && _str.size() > start && helper::codepoint::is_trail_surrogate(_str[start]))
+			++_surrogate_pair_count;
+		return bytes.size() % 2 == 0;
+	}
+
+	[[nodiscard]] bool encode_to_utf8(std::string& u8) const noexcept
+	{
+		return coder::convert_append(raw(), u8);
+	}
+
+	[[nodiscard]] bool encode_to_utf32(std::u32string& u32) const noexcept
+	{
+		return coder::convert_append(raw(), u32);
+	}
+
+	[[nodiscard]] bool encode_to_wide(std::wstring& w) const noexcept
+	{
+		return coder::convert_append(raw(), w);
+	}
+
+	bool encode_to_gb18030(std::string& gb) const
+	{
+		return coder::convert_append_gb18030(raw(), gb);
+	}
+
+	void encode_to_utf16_bytes(std::string& bytes, endian e = endian::big, bool bom = false) const
+	{
+		coder::append_utf16_bytes(raw(), e, bytes, bom);
 	}
 
 	[[nodiscard]] uint32_t get_hash() const noexcept
@@ -258,8 +486,48 @@ public:
 
 private:
 
+	// fills the storage and the pair count it tracked
+	friend class string_builder;
+
 	void calculate_surrogate();
 
+	// run a coder appending to a std::u16string, straight into the storage when it is one
+	// otherwise through a buffer reused by the thread.
+	template<typename F>
+	bool append_converted(F&& convert)
+	{
+		if constexpr (std::is_same_v<storage_type, std::u16string>)
+		{
+			return std::forward<F>(convert)(_str);
+		}
+		else
+		{
+			thread_local std::u16string scratch;
+			scratch.clear();
+			const bool ans = std::forward<F>(convert)(scratch);
+			_str.append(scratch);
+			return ans;
+		}
+	}
+
+	// each unit widened or truncated to a code unit of the same value
+	template<typename T>
+	void assign_units(const T* src, size_t count)
+	{
+		if constexpr (sizeof(T) == 1)
+		{
+			_str.resize(count);
+			coder::widen_latin1(std::string_view(reinterpret_cast<const char*>(src), count), _str.data());
+			_surrogate_pair_count = 0;
+		}
+		else
+		{
+			using ut = std::make_unsigned_t< T >;
+			_str.assign(reinterpret_cast<const ut*>(src), reinterpret_cast<const ut*>(src) + count);
+			calculate_surrogate();
+		}
+	}
+
 	size_t position_codepoint_to_index(size_t codepoint_count_to_iterator) const;
 
 	size_t position_index_to_codepoint(size_t index) const;
@@ -282,23 +550,46 @@ private:
 	template<typename T, typename = void, typename = std::enable_if_t<is_c_str<T>::value>>
 	static auto go_str(T&& t)
 	{
-		return string(t);
+		return basic_string(t);
 	}
 
 private:
 
-	std::u16string _str;
+	storage_type _str;
 
 	size_t _surrogate_pair_count = 0;
 
 };
 
-inline bool operator==(const ostr::string& lhs, const ostr::string_view& rhs)
+using string = basic_string<>;
+
+namespace pmr
+{
+	using string = basic_string<std::pmr::polymorphic_allocator<char16_t>>;
+}
+
+namespace ofmt {
+	// formatted into a memory resource such as an arena
+	// ofmt::format(std::allocator_arg, &arena, u"{0} got {1}", name, 3)
+	template<typename...Args>
+	inline pmr::string format(std::allocator_arg_t, std::pmr::memory_resource* resource, std::u16string_view fmt, Args&&...args)
+	{
+		return format(std::allocator_arg, std::pmr::polymorphic_allocator<char16_t>(resource), fmt, std::forward<Args>(args)...);
+	}
+}
+
+// members are compiled once in ostr.cpp for these two, and exported from there
+extern template class OPEN_STRING_TEMPLATE_IMPORT basic_string<std::allocator<char16_t>>;
+extern template class OPEN_STRING_TEMPLATE_IMPORT basic_string<std::pmr::polymorphic_allocator<char16_t>>;
+
+template<typename Alloc>
+inline bool operator==(const basic_string<Alloc>& lhs, const ostr::string_view& rhs)
 {
 	return lhs.to_sv() == rhs;
 }
 
-inline bool operator==(const ostr::string_view& lhs, const ostr::string& rhs)
+template<typename Alloc>
+inline bool operator==(const ostr::string_view& lhs, const basic_string<Alloc>& rhs)
 {
 	return rhs == lhs;
 }
@@ -310,22 +601,36 @@ namespace ofmt {
 		out.append(arg.raw());
 		return true;
 	}
+
+	template<typename Alloc>
+	struct formatter<basic_string<Alloc>>
+	{
+		static bool format(const basic_string<Alloc>& arg, std::u16string_view param, std::u16string& out)
+		{
+			out.append(arg.raw());
+			return true;
+		}
+	};
 }
 
 _NS_OSTR_END
 
-template<>
-struct fmt::formatter<ostr::string, char16_t>
+template<typename Alloc>
+struct fmt::formatter<ostr::basic_string<Alloc>, char16_t> : fmt::formatter<ostr::string_view, char16_t>
 {
-	template<typename ParseContext>
-	constexpr auto parse(ParseContext& ctx)
+	template<typename FormatContext>
+	auto format(const ostr::basic_string<Alloc>& str, FormatContext& ctx)
 	{
-		return ctx.begin();
+		return fmt::formatter<ostr::string_view, char16_t>::format(ostr::string_view(str.raw()), ctx);
 	}
+};
 
+template<typename Alloc>
+struct fmt::formatter<ostr::basic_string<Alloc>, char> : fmt::formatter<ostr::string_view, char>
+{
 	template<typename FormatContext>
-	auto format(ostr::string str, FormatContext& ctx)
+	auto format(const ostr::basic_string<Alloc>& str, FormatContext& ctx)
 	{
-		return fmt::format_to(ctx.out(), u"{}", str.raw());
+		return fmt::formatter<ostr::string_view, char>::format(ostr::string_view(str.raw()), ctx);
 	}
 };
@@ -11,6 +11,7 @@
 #include "format.h"
 #include "helpers.h"
 #include "coder.h"
+#include "gb18030.h"
 
 _NS_OSTR_BEGIN
 
@@ -209,7 +210,47 @@ public:
 		return trim_start().trim_end();
 	}
 
-	[[nodiscard]] int to_int() const noexcept;
+	// Parse an integer from the head, like std::from_chars.
+	// No whitespace skipped, a leading '+' is accepted, '-' only for signed types.
+	// string_view(u"-42px").parse_int(i) == { std::errc(), 3 } && i == -42
+	// @param out: the value, untouched when failed.
+	// @param base: 2 to 36.
+	// @return: error code and how many code units consumed.
+	template<typename I>
+	[[nodiscard]] parse_result parse_int(I& out, int base = 10) const noexcept
+	{
+		const char16_t* first = _str.data();
+		const auto result = helper::string::from_chars(first, first + _str.size(), out, base);
+		return { result.ec, static_cast<size_t>(result.ptr - first) };
+	}
+
+	// Parse a float number from the head, like std::from_chars.
+	// No whitespace skipped, locale independent, correctly rounded, never allocates.
+	// string_view(u"-1.5e3,2").parse_float(d) == { std::errc(), 6 } && d == -1500.0
+	// @param out: float or double, untouched when failed or out of range.
+	// @return: error code and how many code units consumed.
+	template<typename F>
+	[[nodiscard]] parse_result parse_float(F& out) const noexcept
+	{
+		static_assert(std::is_same_v<F, float> || std::is_same_v<F, double>, "parse_float only works for float and double.");
+		const char16_t* first = _str.data();
+		const auto result = helper::string::from_chars(first, first + _str.size(), out);
+		return { result.ec, static_cast<size_t>(result.ptr - first) };
+	}
+
+	// Parse the whole view as a float number, surrounding spaces ignored.
+	// @return: the value, 0 when invalid or out of range.
+	[[nodiscard]] double to_double() const noexcept;
+
+	[[nodiscard]] float to_float() const noexcept;
+
+	// Parse the whole view as an integer, surrounding spaces ignored.
+	// @return: the value, 0 when invalid or out of range.
+	[[nodiscard]] int to_int(int base = 10) const noexcept;
+
+	[[nodiscard]] int64_t to_int64(int base = 10) const noexcept;
+
+	[[nodiscard]] uint64_t to_uint64(int base = 10) const noexcept;
 
 	[[nodiscard]] constexpr uint32_t get_hash() const noexcept
 	{
@@ -235,6 +276,28 @@ public:
 		return coder::convert_append(_str, u8);
 	}
 
+	[[nodiscard]] bool encode_to_utf32(std::u32string& u32) const noexcept
+	{
+		return coder::convert_append(_str, u32);
+	}
+
+	[[nodiscard]] bool encode_to_wide(std::wstring& w) const noexcept
+	{
+		return coder::convert_append(_str, w);
+	}
+
+	bool encode_to_gb18030(std::string& gb) const
+	{
+		return coder::convert_append_gb18030(_str, gb);
+	}
+
+	// code units as raw bytes in order e
+	// @param bom: write a byte order mark first.
+	void encode_to_utf16_bytes(std::string& bytes, endian e = endian::big, bool bom = false) const
+	{
+		coder::append_utf16_bytes(_str, e, bytes, bom);
+	}
+
 private:
 
 	size_t position_codepoint_to_index(size_t codepoint_count_to_iterator) const noexcept;
@@ -248,6 +311,17 @@ private:
 	std::u16string_view _str;
 };
 
+// a utf-8 token against a string without decoding it, in code point order
+[[nodiscard]] inline bool equals(std::string_view u8, const string_view& u16) noexcept
+{
+	return coder::equals(u8, u16.raw());
+}
+
+[[nodiscard]] inline int compare(std::string_view u8, const string_view& u16) noexcept
+{
+	return coder::compare(u8, u16.raw());
+}
+
 struct sv_hasher
 {
 	inline uint32_t operator()(string_view sv) const
@@ -275,18 +349,51 @@ namespace ofmt {
 
 _NS_OSTR_END 
 
+// takes the same specs as u16string_view, "{:>8}"
+template<>
+struct fmt::formatter<ostr::string_view, char16_t> : fmt::formatter<fmt::basic_string_view<char16_t>, char16_t>
+{
+	template<typename FormatContext>
+	auto format(const ostr::string_view& sv, FormatContext& ctx)
+	{
+		const std::u16string_view raw = sv.raw();
+		return fmt::formatter<fmt::basic_string_view<char16_t>, char16_t>::format(fmt::basic_string_view<char16_t>(raw.data(), raw.size()), ctx);
+	}
+};
+
+// encoded to utf-8 right into the output of fmt, through a buffer when padded
 template<>
-struct fmt::formatter<ostr::string_view, char16_t>
+struct fmt::formatter<ostr::string_view, char> : fmt::formatter<fmt::string_view, char>
 {
 	template<typename ParseContext>
 	constexpr auto parse(ParseContext& ctx)
 	{
-		return ctx.begin();
+		_plain = ctx.begin() == ctx.end() || *ctx.begin() == '}';
+		return fmt::formatter<fmt::string_view, char>::parse(ctx);
 	}
 
 	template<typename FormatContext>
-	auto format(ostr::string_view sv, FormatContext& ctx)
+	auto format(const ostr::string_view& sv, FormatContext& ctx)
 	{
-		return fmt::format_to(ctx.out(), u"{}", sv.raw());
+		if (!_plain)
+		{
+			std::string u8;
+			ostr::coder::encode_utf8_to(sv.raw(), std::back_inserter(u8),
+				[](const char* begin, const char* end, auto out)
+				{
+					return std::copy(begin, end, out);
+				});
+			return fmt::formatter<fmt::string_view, char>::format(fmt::string_view(u8.data(), u8.size()), ctx);
+		}
+		return ostr::coder::encode_utf8_to(sv.raw(), ctx.out(),
+			[](const char* begin, const char* end, auto out)
+			{
+				return fmt::detail::copy_str<char>(begin, end, out);
+			});
 	}
+
+private:
+
+	// no spec, nothing to pad
+	bool _plain = true;
 };
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "coder.h"
+#include "definitions.h"
+#include "osv.h"
+
+_NS_OSTR_BEGIN
+
+// Streaming utf-8 input from a file descriptor, line by line.
+// Bytes are read in fixed chunks and decoded into one reusable utf-16 buffer,
+// a sequence split between two chunks is joined. Memory stays at two chunks plus the longest line.
+// u8_reader in(fd);
+// for (string_view line; in.next_line(line);)
+//     handle(line);
+class OPEN_STRING_EXPORT u8_reader
+{
+public:
+
+	static constexpr size_t default_chunk_size = 64 * 1024;
+
+	// @param fd: not owned, kept open on destruction.
+	// @param chunk_size: bytes per read, 64 at least.
+	// @param prefetch: read the next chunk on a thread of its own while the current one is decoded.
+	explicit u8_reader(int fd, size_t chunk_size = default_chunk_size, bool prefetch = false);
+
+	~u8_reader();
+
+	u8_reader(const u8_reader&) = delete;
+	u8_reader& operator=(const u8_reader&) = delete;
+
+	// the next line without its "\n" or "\r\n", the last one may end without any
+	// @param line: valid until the next call.
+	// @return: false at the end of input.
+	bool next_line(string_view& line);
+
+	// the next record ended by the delimiter, which is left out
+	// @param record: valid until the next call.
+	// @return: false at the end of input.
+	bool next_record(char16_t delimiter, string_view& record);
+
+	[[nodiscard]] int fd() const noexcept
+	{
+		return _fd;
+	}
+
+	[[nodiscard]] size_t chunk_size() const noexcept
+	{
+		return _chunk_size;
+	}
+
+	// bytes taken from the file descriptor so far
+	[[nodiscard]] uint64_t bytes_read() const noexcept
+	{
+		return _read;
+	}
+
+	// no read failed so far, a failure ends the input
+	[[nodiscard]] bool good() const noexcept
+	{
+		return !_failed;
+	}
+
+private:
+
+	struct chunk
+	{
+		std::unique_ptr<char[]> buffer;
+		size_t size = 0;
+		bool filled = false;
+		bool failed = false;
+	};
+
+	// decode one more chunk into the text
+	// @return: false at the end of input.
+	bool fill();
+
+	void read_chunk(chunk& c);
+
+	void prefetch_loop();
+
+	int _fd;
+	size_t _chunk_size;
+	chunk _chunks[2];
+	size_t _current = 0;
+	uint64_t _read = 0;
+	bool _failed = false;
+	bool _eof = false;
+
+	// holds the bytes of a sequence cut by the end of a chunk
+	coder::utf8_decoder _decoder;
+
+	// decoded text, records are cut from _begin and the delimiter is searched from _scan
+	std::u16string _text;
+	size_t _begin = 0;
+	size_t _scan = 0;
+
+	std::thread _prefetcher;
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	bool _stop = false;
+};
+
+_NS_OSTR_END
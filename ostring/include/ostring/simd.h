@@ -0,0 +1,20 @@
+#pragma once
+
+// Compile time simd detection.
+// Every path guarded by these macros has a scalar fallback.
+
+// x64 always has sse2
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__)
+#define OSTR_SSE2 1
+#include <emmintrin.h>
+#else
+#define OSTR_SSE2 0
+#endif
+
+// ssse3 only when the compiler may emit it, msvc says so with /arch:AVX
+#if OSTR_SSE2 && (defined(__SSSE3__) || defined(__AVX__))
+#define OSTR_SSSE3 1
+#include <tmmintrin.h>
+#else
+#define OSTR_SSSE3 0
+#endif
@@ -0,0 +1,147 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "coder.h"
+#include "definitions.h"
+#include "format.h"
+#include "helpers.h"
+#include "ostr.h"
+#include "osv.h"
+
+_NS_OSTR_BEGIN
+
+// Builds a large string from many pieces without moving what is already appended.
+// Pieces are copied into a list of chunks which grow geometrically, surrogate pairs are counted as they come,
+// build() copies them out with one allocation. clear() keeps the chunks for the next round.
+// string_builder sb;
+// for (auto& p : players)
+//     sb.append(p.name).format(u" got {0}\n", p.coins);
+// string text = sb.build();
+class OPEN_STRING_EXPORT string_builder
+{
+public:
+
+	// code units of the first chunk
+	static constexpr size_t default_chunk_size = 1024;
+
+	// @param chunk_size: code units of the first chunk, 16 at least.
+	explicit string_builder(size_t chunk_size = default_chunk_size);
+
+	string_builder(string_builder&&) = default;
+	string_builder& operator=(string_builder&&) = default;
+	string_builder(const string_builder&) = delete;
+	string_builder& operator=(const string_builder&) = delete;
+
+	string_builder& append(std::u16string_view units);
+
+	string_builder& append(const string_view& sv)
+	{
+		return append(sv.raw());
+	}
+
+	// the pairs the string counted already are taken as they are
+	template<typename Alloc>
+	string_builder& append(const basic_string<Alloc>& str)
+	{
+		const std::u16string_view units = str.raw();
+		return append_counted(units, units.size() - str.length());
+	}
+
+	string_builder& append(const char16_t* str)
+	{
+		return append(std::u16string_view(str));
+	}
+
+	// surrogates and values past U+10FFFF are written as U+FFFD
+	string_builder& append(codepoint cp);
+
+	// decoded into the chunks, invalid bytes as U+FFFD
+	string_builder& append_utf8(std::string_view u8);
+
+	// render with ofmt then append, same rules as ofmt::format
+	template<typename...Args>
+	string_builder& format(std::u16string_view fmt, Args&&...args)
+	{
+		_scratch.clear();
+		ofmt::format_to(_scratch, fmt, std::forward<Args>(args)...);
+		return append(std::u16string_view(_scratch));
+	}
+
+	template<typename T>
+	string_builder& operator<<(const T& piece)
+	{
+		return append(piece);
+	}
+
+	// code points appended
+	[[nodiscard]] size_t length() const noexcept
+	{
+		return _units - _pairs;
+	}
+
+	// code units appended
+	[[nodiscard]] size_t origin_length() const noexcept
+	{
+		return _units;
+	}
+
+	[[nodiscard]] bool is_empty() const noexcept
+	{
+		return _units == 0;
+	}
+
+	// code units the chunks hold, used or not
+	[[nodiscard]] size_t capacity() const noexcept;
+
+	// everything appended as one string, allocated once
+	[[nodiscard]] string build() const
+	{
+		return build(std::allocator<char16_t>());
+	}
+
+	template<typename Alloc>
+	[[nodiscard]] basic_string<Alloc> build(const Alloc& alloc) const
+	{
+		basic_string<Alloc> ans(alloc);
+		ans._str.reserve(_units);
+		for (size_t i = 0; i <= _current && i < _chunks.size(); ++i)
+			ans._str.append(_chunks[i].data.get(), _chunks[i].size);
+		ans._surrogate_pair_count = _pairs;
+		return ans;
+	}
+
+	// forget what is appended, the chunks are kept
+	void clear() noexcept;
+
+private:
+
+	struct chunk
+	{
+		std::unique_ptr<char16_t[]> data;
+		size_t size = 0;
+		size_t capacity = 0;
+	};
+
+	// copy units known to hold pairs surrogate pairs, the one joined with the last append is counted here
+	string_builder& append_counted(std::u16string_view units, size_t pairs);
+
+	// space for at least count units in one piece at the end of the current chunk
+	chunk& reserve_contiguous(size_t count);
+
+	// the next chunk to write, a kept one or a new one twice the size of the last
+	chunk& next_chunk(size_t at_least);
+
+	std::vector<chunk> _chunks;
+	size_t _current = 0;
+	size_t _chunk_size;
+	size_t _units = 0;
+	size_t _pairs = 0;
+	// the last unit appended, a lead surrogate waiting for its trail
+	char16_t _last = 0;
+	std::u16string _scratch;
+};
+
+_NS_OSTR_END
@@ -1,5 +1,7 @@
 #pragma once
 #include "definitions.h"
+#include <cstdint>
+#include <system_error>
 
 _NS_OSTR_BEGIN
 
@@ -17,7 +19,13 @@ using char_array = const T [N];
 enum class endian : uint8_t
 {
 	big,
-	little
+	little,
+	// byte order of the target, the one char16_t has in memory
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	native = big,
+#else
+	native = little,
+#endif
 };
 
 enum class case_sensitivity : uint8_t
@@ -26,5 +34,22 @@ enum class case_sensitivity : uint8_t
 	insensitive
 }; 
 
+enum class float_format : uint8_t
+{
+	general,
+	fixed,
+	scientific
+};
+
+// result of parsing a value from the head of a string
+struct parse_result
+{
+	// std::errc() when succeed
+	// invalid_argument when no value found, result_out_of_range when overflow
+	std::errc ec;
+	// count of code units consumed
+	size_t length;
+};
+
 _NS_OSTR_END
 
@@ -0,0 +1,555 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <iterator> // For std::forward_iterator_tag
+#include <cstddef>  // For std::ptrdiff_t
+#include <cstring>
+#include "fmt/format.h"
+
+#include "definitions.h"
+#include "types.h"
+#include "coder.h"
+#include "format.h"
+#include "helpers.h"
+#include "ostr.h"
+#include "osv.h"
+
+_NS_OSTR_BEGIN
+
+// Text held as utf-8, with the surface of string_view.
+// Positions and lengths are in code points as with string_view, counted 16 bytes at a time.
+// The bytes are taken as well-formed, coder::is_valid_utf8 tells.
+class OPEN_STRING_EXPORT u8string_view
+{
+public:
+
+	struct iterator
+	{
+		using iterator_category = std::forward_iterator_tag;
+		using difference_type = std::ptrdiff_t;
+		using value_type = codepoint;
+		using pointer = value_type*;
+		using reference = value_type&;
+
+		using pointer_const = const codepoint*;
+
+		using raw_it = std::string_view::const_iterator;
+
+		iterator(raw_it it, raw_it begin, raw_it end)
+			: _it(it)
+			, _begin(begin)
+			, _end(end)
+		{
+			refresh_cp();
+		}
+
+		const codepoint& operator*() const { return _cp; }
+		pointer_const operator->() { return &_cp; }
+
+		// Prefix increment
+		iterator& operator++()
+		{
+			_it += _len;
+			refresh_cp();
+			return *this;
+		}
+
+		// Postfix increment
+		iterator operator++(int)
+		{
+			iterator tmp = *this;
+			++(*this);
+			return tmp;
+		}
+
+		size_t get_origin_index() const
+		{
+			return _it - _begin;
+		}
+
+		small_size_t get_origin_length() const
+		{
+			return _len;
+		}
+
+		bool operator== (const iterator& rhs) { return _it == rhs._it; }
+		bool operator!= (const iterator& rhs) { return _it != rhs._it; }
+		bool operator< (const iterator& rhs) { return _it < rhs._it; }
+		bool operator> (const iterator& rhs) { return _it > rhs._it; }
+		bool operator<= (const iterator& rhs) { return _it <= rhs._it; }
+		bool operator>= (const iterator& rhs) { return _it >= rhs._it; }
+		size_t operator- (const iterator& rhs) { return coder::count_utf8_codepoints(std::string_view(&*rhs._it, _it - rhs._it)); }
+
+	private:
+
+		void refresh_cp()
+		{
+			if (_it == _end) return;
+			// decoded from a copy ending in zeros, a sequence cut by the end is one U+FFFD up to it
+			char8_t sequence[5] = {};
+			std::memcpy(sequence, &*_it, static_cast<size_t>(std::min<ptrdiff_t>(4, _end - _it)));
+			helper::codepoint::utf8_to_utf32(sequence, _len, _cp);
+			// a zero byte is a code point as well
+			if (_len == 0)
+				_len = 1;
+		}
+
+	private:
+
+		raw_it _it;
+		raw_it _begin;
+		raw_it _end;
+		codepoint _cp = 0;
+		small_size_t _len = 0;
+	};
+
+	using const_iterator = iterator;
+
+	const_iterator cbegin() const { return iterator(_str.cbegin(), _str.cbegin(), _str.cend()); }
+	const_iterator cend() const { return iterator(_str.cend(), _str.cbegin(), _str.cend()); }
+	const_iterator begin() const { return cbegin(); }
+	const_iterator end() const { return cend(); }
+
+	constexpr u8string_view() noexcept = default;
+
+	constexpr u8string_view(const u8string_view&) noexcept = default;
+
+	constexpr u8string_view& operator=(const u8string_view&) noexcept = default;
+
+	constexpr u8string_view(const char* str) noexcept
+		: _str(str)
+	{}
+
+	constexpr u8string_view(const char* str, size_t count) noexcept
+		: _str(str, count)
+	{}
+
+	constexpr u8string_view(std::string_view sv) noexcept
+		: _str(sv)
+	{}
+
+	// byte order of utf-8 is code point order
+	[[nodiscard]] int compare(const u8string_view& rhs) const noexcept
+	{
+		return _str.compare(rhs._str);
+	}
+
+	[[nodiscard]] bool operator==(const u8string_view& rhs) const noexcept
+	{
+		return _str == rhs._str;
+	}
+
+	[[nodiscard]] inline bool operator!=(const u8string_view& rhs) const noexcept
+	{
+		return !operator==(rhs);
+	}
+
+	[[nodiscard]] inline bool operator<(const u8string_view& rhs) const noexcept
+	{
+		return compare(rhs) < 0;
+	}
+
+	[[nodiscard]] inline bool operator<=(const u8string_view& rhs) const noexcept
+	{
+		return compare(rhs) <= 0;
+	}
+
+	[[nodiscard]] inline bool operator>(const u8string_view& rhs) const noexcept
+	{
+		return compare(rhs) > 0;
+	}
+
+	[[nodiscard]] inline bool operator>=(const u8string_view& rhs) const noexcept
+	{
+		return compare(rhs) >= 0;
+	}
+
+	// bytes
+	[[nodiscard]] inline constexpr size_t origin_length() const noexcept
+	{
+		return _str.length();
+	}
+
+	// code points
+	[[nodiscard]] size_t length() const noexcept
+	{
+		return coder::count_utf8_codepoints(_str);
+	}
+
+	[[nodiscard]] constexpr bool is_empty() const noexcept
+	{
+		return origin_length() == 0;
+	}
+
+	[[nodiscard]] u8string_view remove_prefix(size_t count) const noexcept;
+
+	[[nodiscard]] u8string_view remove_suffix(size_t count) const noexcept;
+
+	[[nodiscard]] u8string_view left(size_t count) const noexcept;
+
+	[[nodiscard]] u8string_view right(size_t count) const noexcept;
+
+	[[nodiscard]] u8string_view substring(size_t offset = 0, size_t count = SIZE_MAX) const noexcept;
+
+	// @return: offset in code points, SIZE_MAX if not found.
+	[[nodiscard]] size_t index_of(const u8string_view& pattern, case_sensitivity cs = case_sensitivity::sensitive) const noexcept;
+
+	[[nodiscard]] size_t last_index_of(const u8string_view& pattern, case_sensitivity cs = case_sensitivity::sensitive) const noexcept;
+
+	template<typename F>
+	[[nodiscard]] size_t search(F&& predicate) const noexcept
+	{
+		auto it_begin = cbegin();
+		auto it_end = cend();
+		auto it = std::find_if(it_begin, it_end, std::forward<F>(predicate));
+		if (it == it_end) return SIZE_MAX;
+		return it - it_begin;
+	}
+
+	bool split(const u8string_view& splitter, u8string_view* lhs, u8string_view* rhs) const noexcept;
+
+	size_t split(const u8string_view& splitter, std::vector<u8string_view>& str, bool cull_empty = false) const noexcept;
+
+	[[nodiscard]] inline bool start_with(const u8string_view& sv_start) const noexcept
+	{
+		return _str.substr(0, sv_start._str.size()) == sv_start._str;
+	}
+
+	[[nodiscard]] inline bool end_with(const u8string_view& sv_end) const noexcept
+	{
+		return _str.size() >= sv_end._str.size() && _str.substr(_str.size() - sv_end._str.size()) == sv_end._str;
+	}
+
+	[[nodiscard]] u8string_view trim_start() const noexcept;
+
+	[[nodiscard]] u8string_view trim_end() const noexcept;
+
+	[[nodiscard]] inline u8string_view trim() const noexcept
+	{
+		return trim_start().trim_end();
+	}
+
+	// same as string_view::parse_int, length in bytes
+	template<typename I>
+	[[nodiscard]] parse_result parse_int(I& out, int base = 10) const noexcept
+	{
+		const char* first = _str.data();
+		const auto result = helper::string::from_chars(first, first + _str.size(), out, base);
+		return { result.ec, static_cast<size_t>(result.ptr - first) };
+	}
+
+	// same as string_view::parse_float, length in bytes
+	template<typename F>
+	[[nodiscard]] parse_result parse_float(F& out) const noexcept
+	{
+		static_assert(std::is_same_v<F, float> || std::is_same_v<F, double>, "parse_float only works for float and double.");
+		const char* first = _str.data();
+		const auto result = helper::string::from_chars(first, first + _str.size(), out);
+		return { result.ec, static_cast<size_t>(result.ptr - first) };
+	}
+
+	[[nodiscard]] constexpr uint32_t get_hash() const noexcept
+	{
+		return helper::hash::hash_crc32(_str);
+	}
+
+	// format rule: fmtlib @ https://github.com/fmtlib/fmt
+	template<typename...Args>
+	[[nodiscard]] std::string format(Args&&...args) const
+	{
+		return fmt::format(_str, std::forward<Args>(args)...);
+	}
+
+	[[nodiscard]] constexpr std::string_view raw() const noexcept
+	{
+		return _str;
+	}
+
+	// decoded to utf-16, ill-formed bytes as U+FFFD
+	[[nodiscard]] string to_utf16() const
+	{
+		string ans;
+		ans.decode_from_utf8(_str);
+		return ans;
+	}
+
+	[[nodiscard]] bool encode_to_utf16(std::u16string& u16) const
+	{
+		return coder::convert_append(_str, u16);
+	}
+
+private:
+
+	// byte offset of a code point offset, the size past the end
+	size_t position_codepoint_to_index(size_t codepoint_index) const noexcept
+	{
+		return coder::utf8_codepoint_offset(_str, codepoint_index);
+	}
+
+	size_t position_index_to_codepoint(size_t index) const noexcept
+	{
+		return coder::count_utf8_codepoints(_str.substr(0, index));
+	}
+
+private:
+
+	std::string_view _str;
+};
+
+// Owning utf-8 text, the counterpart of string.
+// Half the memory of string for ascii, and handed to utf-8 sinks as is.
+// u8string name("玩家");
+// name.length() == 2 && name.raw().size() == 6
+class OPEN_STRING_EXPORT u8string
+{
+public:
+
+	u8string() = default;
+	u8string(u8string&&) = default;
+	u8string(const u8string&) = default;
+	u8string& operator=(u8string&&) = default;
+	u8string& operator=(const u8string&) = default;
+
+	u8string(const char* src)
+		: _str(src)
+	{
+	}
+
+	u8string(const char* src, size_t length)
+		: _str(src, length)
+	{
+	}
+
+	u8string(std::string str)
+		: _str(std::move(str))
+	{
+	}
+
+	u8string(std::string_view sv)
+		: _str(sv)
+	{
+	}
+
+	u8string(u8string_view sv)
+		: _str(sv.raw())
+	{
+	}
+
+	// encoded from utf-16, a lone surrogate as U+FFFD
+	explicit u8string(const string_view& u16)
+	{
+		(void)u16.encode_to_utf8(_str);
+	}
+
+	explicit u8string(const string& u16)
+		: u8string(u16.to_sv())
+	{
+	}
+
+	inline operator u8string_view() const
+	{
+		return to_sv();
+	}
+
+	[[nodiscard]] inline u8string_view to_sv() const
+	{
+		return u8string_view(std::string_view(_str));
+	}
+
+	[[nodiscard]] u8string_view::const_iterator begin() const { return to_sv().begin(); }
+	[[nodiscard]] u8string_view::const_iterator end() const { return to_sv().end(); }
+
+	// @return: code points of the string.
+	[[nodiscard]] size_t length() const noexcept
+	{
+		return to_sv().length();
+	}
+
+	[[nodiscard]] inline bool is_empty() const noexcept
+	{
+		return _str.empty();
+	}
+
+	[[nodiscard]] inline int compare(const u8string& rhs) const
+	{
+		return _str.compare(rhs._str);
+	}
+
+	[[nodiscard]] inline bool operator==(const u8string& rhs) const
+	{
+		return _str == rhs._str;
+	}
+
+	[[nodiscard]] inline bool operator!=(const u8string& rhs) const
+	{
+		return _str != rhs._str;
+	}
+
+	[[nodiscard]] inline bool operator<(const u8string& rhs) const
+	{
+		return _str < rhs._str;
+	}
+
+	[[nodiscard]] inline bool operator<=(const u8string& rhs) const
+	{
+		return _str <= rhs._str;
+	}
+
+	[[nodiscard]] inline bool operator>(const u8string& rhs) const
+	{
+		return _str > rhs._str;
+	}
+
+	[[nodiscard]] inline bool operator>=(const u8string& rhs) const
+	{
+		return _str >= rhs._str;
+	}
+
+	u8string& operator+=(const u8string_view& rhs)
+	{
+		_str += rhs.raw();
+		return *this;
+	}
+
+	[[nodiscard]] u8string operator+(const u8string_view& rhs) const
+	{
+		u8string str = *this;
+		str += rhs;
+		return str;
+	}
+
+	// u8string("abcdefg").substring(2, 3) == u8string("cde");
+	[[nodiscard]] u8string substring(size_t from, size_t size = SIZE_MAX) const
+	{
+		return to_sv().substring(from, size);
+	}
+
+	// @param from: from where to search, in code points.
+	// @param length: how many code points from there to search in.
+	[[nodiscard]] size_t index_of(const u8string_view& substr, size_t from = 0, size_t length = SIZE_MAX, case_sensitivity cs = case_sensitivity::sensitive) const;
+
+	[[nodiscard]] size_t last_index_of(const u8string_view& substr, size_t from = 0, size_t length = SIZE_MAX, case_sensitivity cs = case_sensitivity::sensitive) const;
+
+	bool split(const u8string_view& splitter, u8string_view* lhs, u8string_view* rhs) const
+	{
+		return to_sv().split(splitter, lhs, rhs);
+	}
+
+	size_t split(const u8string_view& splitter, std::vector<u8string_view>& str) const
+	{
+		return to_sv().split(splitter, str);
+	}
+
+	template<typename F>
+	[[nodiscard]] size_t search(F&& predicate) const
+	{
+		return to_sv().search(std::forward<F>(predicate));
+	}
+
+	// replace every occurrence of src, which should not be empty
+	u8string& replace_origin(const u8string_view& src, const u8string_view& dest);
+
+	[[nodiscard]] u8string replace_copy(const u8string_view& src, const u8string_view& dest) const
+	{
+		u8string new_inst(*this);
+		new_inst.replace_origin(src, dest);
+		return new_inst;
+	}
+
+	template<typename...Args>
+	[[nodiscard]] u8string format(Args&&...args) const
+	{
+		return to_sv().format(std::forward<Args>(args)...);
+	}
+
+	u8string& trim_start();
+
+	u8string& trim_end();
+
+	inline u8string& trim()
+	{
+		return trim_start().trim_end();
+	}
+
+	[[nodiscard]] u8string trim_start_copy() const
+	{
+		return to_sv().trim_start();
+	}
+
+	[[nodiscard]] u8string trim_end_copy() const
+	{
+		return to_sv().trim_end();
+	}
+
+	[[nodiscard]] u8string trim_copy() const
+	{
+		return to_sv().trim();
+	}
+
+	[[nodiscard]] inline std::string_view raw() const noexcept
+	{
+		return _str;
+	}
+
+	[[nodiscard]] string to_utf16() const
+	{
+		return to_sv().to_utf16();
+	}
+
+	[[nodiscard]] uint32_t get_hash() const noexcept
+	{
+		return to_sv().get_hash();
+	}
+
+private:
+
+	std::string _str;
+};
+
+namespace literal
+{
+	[[nodiscard]] inline constexpr u8string_view operator""_u8(const char* str, size_t len) noexcept
+	{
+		return u8string_view(str, len);
+	}
+}
+
+namespace ofmt {
+	// decoded into the utf-16 output
+	template <>
+	inline bool to_string<u8string_view>(const u8string_view& arg, std::u16string_view param, std::u16string& out)
+	{
+		return coder::convert_append(arg.raw(), out);
+	}
+
+	template <>
+	inline bool to_string<u8string>(const u8string& arg, std::u16string_view param, std::u16string& out)
+	{
+		return coder::convert_append(arg.raw(), out);
+	}
+}
+
+_NS_OSTR_END
+
+// the bytes as they are, same specs as std::string_view
+template<>
+struct fmt::formatter<ostr::u8string_view, char> : fmt::formatter<fmt::string_view, char>
+{
+	template<typename FormatContext>
+	auto format(const ostr::u8string_view& sv, FormatContext& ctx)
+	{
+		return fmt::formatter<fmt::string_view, char>::format(fmt::string_view(sv.raw().data(), sv.raw().size()), ctx);
+	}
+};
+
+template<>
+struct fmt::formatter<ostr::u8string, char> : fmt::formatter<ostr::u8string_view, char>
+{
+	template<typename FormatContext>
+	auto format(const ostr::u8string& str, FormatContext& ctx)
+	{
+		return fmt::formatter<ostr::u8string_view, char>::format(str.to_sv(), ctx);
+	}
+};
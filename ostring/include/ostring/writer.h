@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "cached_string.h"
+#include "coder.h"
+#include "definitions.h"
+#include "format.h"
+#include "ostr.h"
+#include "osv.h"
+
+_NS_OSTR_BEGIN
+
+// Buffered utf-8 output to a file descriptor.
+// Strings are encoded straight into a fixed buffer which is written out when full,
+// a surrogate pair split between two writes is joined.
+// u8_writer out(fd);
+// out.write(u"玩家"_o).format(u" got {0} coins\n", 3);
+class OPEN_STRING_EXPORT u8_writer
+{
+public:
+
+	static constexpr size_t default_capacity = 64 * 1024;
+
+	// @param fd: not owned, kept open on destruction.
+	// @param capacity: bytes of the buffer, 64 at least.
+	explicit u8_writer(int fd, size_t capacity = default_capacity);
+
+	// flush, an unpaired lead surrogate left is written as U+FFFD
+	~u8_writer();
+
+	u8_writer(const u8_writer&) = delete;
+	u8_writer& operator=(const u8_writer&) = delete;
+
+	u8_writer& write(std::u16string_view str);
+
+	u8_writer& write(const string_view& str)
+	{
+		return write(str.raw());
+	}
+
+	u8_writer& write(const string& str)
+	{
+		return write(str.raw());
+	}
+
+	// the cached utf-8 is copied, nothing is encoded
+	u8_writer& write(const u8_cached_string& str)
+	{
+		return write_utf8(str.utf8());
+	}
+
+	u8_writer& write(const std::u16string& str)
+	{
+		return write(std::u16string_view(str));
+	}
+
+	u8_writer& write(const char16_t* str)
+	{
+		return write(std::u16string_view(str));
+	}
+
+	// bytes already in utf-8, large ones skip the buffer
+	u8_writer& write_utf8(std::string_view bytes);
+
+	// render with ofmt then encode, same rules as ofmt::format
+	template<typename...Args>
+	u8_writer& format(std::u16string_view fmt, Args&&...args)
+	{
+		_scratch.clear();
+		ofmt::format_to(_scratch, fmt, std::forward<Args>(args)...);
+		return write(std::u16string_view(_scratch));
+	}
+
+	template<typename T>
+	u8_writer& operator<<(const T& str)
+	{
+		return write(str);
+	}
+
+	// write the buffer out, a pending lead surrogate is kept for the next write
+	// @return: false if any write failed so far.
+	bool flush();
+
+	// flush, and write a pending lead surrogate as U+FFFD
+	bool finish();
+
+	[[nodiscard]] int fd() const noexcept
+	{
+		return _fd;
+	}
+
+	// bytes in the buffer now
+	[[nodiscard]] size_t buffered() const noexcept
+	{
+		return _size;
+	}
+
+	[[nodiscard]] size_t capacity() const noexcept
+	{
+		return _capacity;
+	}
+
+	// bytes handed to the file descriptor so far
+	[[nodiscard]] uint64_t bytes_written() const noexcept
+	{
+		return _written;
+	}
+
+	// no write failed so far
+	[[nodiscard]] bool good() const noexcept
+	{
+		return !_failed;
+	}
+
+private:
+
+	// write a pending lead surrogate as U+FFFD
+	void finish_pending();
+
+	bool write_fd(const char* data, size_t size);
+
+	bool write_fd(const char* data0, size_t size0, const char* data1, size_t size1);
+
+	int _fd;
+	std::unique_ptr<char[]> _buffer;
+	size_t _capacity;
+	size_t _size = 0;
+	uint64_t _written = 0;
+	bool _failed = false;
+	// holds a lead surrogate closing the last write, waiting for its trail
+	coder::utf16_encoder _encoder;
+	std::u16string _scratch;
+};
+
+_NS_OSTR_END
@@ -20,14 +20,15 @@ int main()
 	olog::init_log_system();
 
 	olog::verbose("this is a verbose message.");
-	olog::debug(OSTR("this is a debug message."));
-	olog::info(OSTR("this is an {}.").format(OSTR("info")));
+	olog::debug(u"this is a debug message."_o);
+	olog::info(u"this is an {}."_o.format(u"info"_o));
 	olog::warn("this is a warning.");
-	LOG_FFL olog::error(OSTR("this is an error message."));
+	LOG_FFL olog::error(ostr::string(u"this is an error message."));
 	olog::fatal("this is an {} message.", "fatal");
 
-	olog::fatal(u"♂"o);
+	olog::fatal(u"♂"_o);
 
+	olog::shutdown_log_system();
 	return EXIT_SUCCESS;
 }
 
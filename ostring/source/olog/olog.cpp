@@ -0,0 +1,437 @@
+#include "olog/olog.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <spdlog/details/log_msg.h>
+#include <spdlog/details/os.h>
+#include <spdlog/sinks/sink.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace olog {
+
+	namespace {
+
+		constexpr auto idle_wait = std::chrono::milliseconds(1);
+
+		constexpr spdlog::level::level_enum to_spdlog(level lvl)
+		{
+			switch (lvl)
+			{
+			case level::verbose: return spdlog::level::trace;
+			case level::debug: return spdlog::level::debug;
+			case level::info: return spdlog::level::info;
+			case level::warn: return spdlog::level::warn;
+			case level::error: return spdlog::level::err;
+			case level::fatal: return spdlog::level::critical;
+			default: return spdlog::level::off;
+			}
+		}
+
+		size_t round_up_pow2(size_t value)
+		{
+			size_t ans = 4096;
+			while (ans < value)
+				ans <<= 1;
+			return ans;
+		}
+
+		class log_backend
+		{
+		public:
+
+			static log_backend& get()
+			{
+				static log_backend backend;
+				return backend;
+			}
+
+			~log_backend()
+			{
+				stop();
+			}
+
+			std::shared_ptr<detail::thread_queue> create_queue()
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (!_started)
+					start_locked({});
+
+				auto queue = std::make_shared<detail::thread_queue>(_options.queue_capacity, _options.policy, &min_level);
+				queue->thread_id = spdlog::details::os::thread_id();
+				_queues.push_back(queue);
+				++_queues_version;
+				return queue;
+			}
+
+			void start(log_options options)
+			{
+				stop();
+				std::lock_guard<std::mutex> lock(_mutex);
+				start_locked(std::move(options));
+			}
+
+			void stop()
+			{
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					if (!_running)
+						return;
+					min_level.store(level::off);
+					_running = false;
+				}
+				_wake.notify_all();
+				_worker.join();
+			}
+
+			void flush()
+			{
+				uint64_t ticket;
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					if (!_running)
+						return;
+					ticket = ++_flush_requested;
+				}
+				_wake.notify_all();
+
+				std::unique_lock<std::mutex> lock(_mutex);
+				_flushed.wait(lock, [&]() { return _flush_done >= ticket || !_running; });
+			}
+
+			void wake()
+			{
+				_wake.notify_one();
+			}
+
+			uint64_t dropped() const
+			{
+				return _dropped_total.load(std::memory_order_relaxed);
+			}
+
+			void add_dropped()
+			{
+				_dropped_total.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			std::atomic<level> min_level{ level::verbose };
+
+		private:
+
+			log_backend() = default;
+
+			void start_locked(log_options options)
+			{
+				_options = std::move(options);
+				_options.queue_capacity = round_up_pow2(_options.queue_capacity);
+				if (_options.sinks.empty())
+					_options.sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+				if (!_options.pattern.empty())
+				{
+					for (auto& sink : _options.sinks)
+						sink->set_pattern(_options.pattern);
+				}
+
+				min_level.store(_options.min_level);
+				_started = true;
+				_running = true;
+				_worker = std::thread([this]() { run(); });
+			}
+
+			void run()
+			{
+				std::vector<std::shared_ptr<detail::thread_queue>> queues;
+				uint64_t version = UINT64_MAX;
+
+				while (true)
+				{
+					uint64_t flush_request;
+					bool running;
+					{
+						std::lock_guard<std::mutex> lock(_mutex);
+						if (version != _queues_version)
+						{
+							queues = _queues;
+							version = _queues_version;
+						}
+						flush_request = _flush_requested;
+						running = _running;
+					}
+
+					const bool busy = drain(queues);
+					report_dropped(queues);
+
+					if (flush_request != _flush_done)
+					{
+						flush_sinks();
+						{
+							std::lock_guard<std::mutex> lock(_mutex);
+							_flush_done = flush_request;
+						}
+						_flushed.notify_all();
+					}
+
+					if (busy)
+						continue;
+					if (!running)
+						break;
+
+					remove_closed();
+					std::unique_lock<std::mutex> lock(_mutex);
+					_wake.wait_for(lock, idle_wait, [&]() { return _flush_requested != _flush_done || !_running; });
+				}
+
+				flush_sinks();
+				std::lock_guard<std::mutex> lock(_mutex);
+				_flush_done = _flush_requested;
+				_flushed.notify_all();
+			}
+
+			// render records committed before the pass, later ones wait for the next pass
+			bool drain(const std::vector<std::shared_ptr<detail::thread_queue>>& queues)
+			{
+				bool busy = false;
+				for (const auto& queue : queues)
+				{
+					const size_t end = queue->tail_position();
+					while (queue->head_position() != end)
+					{
+						detail::record_header* record = queue->front();
+						if (!record)
+							break;
+						emit(*queue, *record);
+						queue->pop();
+						busy = true;
+					}
+				}
+				return busy;
+			}
+
+			void emit(const detail::thread_queue& queue, detail::record_header& record)
+			{
+				_text.clear();
+				std::byte* payload = reinterpret_cast<std::byte*>(&record) + detail::payload_offset;
+				record.ops->render(payload, _text);
+				record.ops->destroy(payload);
+				_utf8.clear();
+				ostr::coder::convert_append(_text, _utf8);
+
+				const auto time = std::chrono::system_clock::time_point(
+					std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(record.time)));
+				const spdlog::source_loc source(record.source.file, record.source.line, record.source.function);
+				spdlog::details::log_msg msg(time, source, spdlog::string_view_t(), to_spdlog(record.lvl), spdlog::string_view_t(_utf8.data(), _utf8.size()));
+				msg.thread_id = queue.thread_id;
+				log_to_sinks(msg);
+			}
+
+			void log_to_sinks(const spdlog::details::log_msg& msg)
+			{
+				for (auto& sink : _options.sinks)
+				{
+					if (!sink->should_log(msg.level))
+						continue;
+					try
+					{
+						sink->log(msg);
+					}
+					catch (const std::exception& e)
+					{
+						std::fprintf(stderr, "olog: sink failed, %s\n", e.what());
+					}
+				}
+			}
+
+			void flush_sinks()
+			{
+				for (auto& sink : _options.sinks)
+				{
+					try
+					{
+						sink->flush();
+					}
+					catch (const std::exception& e)
+					{
+						std::fprintf(stderr, "olog: sink failed, %s\n", e.what());
+					}
+				}
+			}
+
+			void report_dropped(const std::vector<std::shared_ptr<detail::thread_queue>>& queues)
+			{
+				uint64_t dropped = 0;
+				for (const auto& queue : queues)
+					dropped += queue->dropped.exchange(0, std::memory_order_relaxed);
+				if (dropped == 0)
+					return;
+
+				_utf8 = "olog: " + std::to_string(dropped) + " records dropped";
+				spdlog::details::log_msg msg(spdlog::string_view_t(), spdlog::level::warn, spdlog::string_view_t(_utf8.data(), _utf8.size()));
+				log_to_sinks(msg);
+			}
+
+			// queues of exited threads, once drained
+			void remove_closed()
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				const size_t count = _queues.size();
+				for (size_t i = 0; i < _queues.size();)
+				{
+					auto& queue = _queues[i];
+					if (queue->closed.load(std::memory_order_acquire) && queue->head_position() == queue->tail_position())
+					{
+						queue = std::move(_queues.back());
+						_queues.pop_back();
+						continue;
+					}
+					++i;
+				}
+				if (count != _queues.size())
+					++_queues_version;
+			}
+
+			std::mutex _mutex;
+			std::condition_variable _wake;
+			std::condition_variable _flushed;
+			std::thread _worker;
+			bool _started = false;
+			bool _running = false;
+
+			log_options _options;
+			std::vector<std::shared_ptr<detail::thread_queue>> _queues;
+			uint64_t _queues_version = 0;
+			uint64_t _flush_requested = 0;
+			uint64_t _flush_done = 0;
+			std::atomic<uint64_t> _dropped_total{ 0 };
+
+			// only touched by the worker
+			std::u16string _text;
+			std::string _utf8;
+		};
+
+		// marks the queue closed when its thread exits
+		struct queue_owner
+		{
+			std::shared_ptr<detail::thread_queue> queue;
+
+			~queue_owner()
+			{
+				if (queue)
+					queue->closed.store(true, std::memory_order_release);
+			}
+		};
+	}
+
+	void init_log_system(log_options options)
+	{
+		log_backend::get().start(std::move(options));
+	}
+
+	void shutdown_log_system()
+	{
+		log_backend::get().stop();
+	}
+
+	void flush()
+	{
+		log_backend::get().flush();
+	}
+
+	void set_level(level lvl)
+	{
+		log_backend::get().min_level.store(lvl);
+	}
+
+	level get_level()
+	{
+		return log_backend::get().min_level.load();
+	}
+
+	uint64_t dropped_count()
+	{
+		return log_backend::get().dropped();
+	}
+
+	namespace detail {
+
+		thread_queue::thread_queue(size_t capacity, overflow_policy policy, const std::atomic<level>* min_level)
+			: policy(policy)
+			, _buffer(static_cast<std::byte*>(::operator new(capacity, std::align_val_t(64))))
+			, _capacity(capacity)
+			, _min_level(min_level)
+		{
+			// fault the pages in now rather than on the first laps of the callers
+			std::memset(_buffer, 0, _capacity);
+		}
+
+		thread_queue::~thread_queue()
+		{
+			// records never rendered still own their arguments
+			while (record_header* record = front())
+			{
+				record->ops->destroy(reinterpret_cast<std::byte*>(record) + payload_offset);
+				pop();
+			}
+			::operator delete(_buffer, std::align_val_t(64));
+		}
+
+		std::byte* thread_queue::reserve_slow(size_t size)
+		{
+			log_backend& backend = log_backend::get();
+			if (size > _capacity / 2)
+			{
+				// would stall the ring, never fits
+				dropped.fetch_add(1, std::memory_order_relaxed);
+				backend.add_dropped();
+				return nullptr;
+			}
+
+			if (policy == overflow_policy::block)
+			{
+				while (min_level() != level::off)
+				{
+					backend.wake();
+					std::this_thread::yield();
+					if (std::byte* p = try_reserve(size))
+						return p;
+				}
+			}
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			backend.add_dropped();
+			return nullptr;
+		}
+
+		record_header* thread_queue::front() noexcept
+		{
+			while (true)
+			{
+				const size_t head = _head.load(std::memory_order_relaxed);
+				if (head == _tail.load(std::memory_order_acquire))
+					return nullptr;
+
+				auto record = reinterpret_cast<record_header*>(_buffer + (head & (_capacity - 1)));
+				if (record->ops)
+					return record;
+				// filler before the ring wraps
+				_head.store(head + record->size, std::memory_order_release);
+			}
+		}
+
+		void thread_queue::pop() noexcept
+		{
+			const size_t head = _head.load(std::memory_order_relaxed);
+			auto record = reinterpret_cast<record_header*>(_buffer + (head & (_capacity - 1)));
+			_head.store(head + record->size, std::memory_order_release);
+		}
+
+		thread_queue* local_queue()
+		{
+			static thread_local queue_owner owner;
+			if (!owner.queue)
+				owner.queue = log_backend::get().create_queue();
+			return owner.queue.get();
+		}
+	}
+}
@@ -0,0 +1,21 @@
+#include "ostring/cached_string.h"
+
+#include <memory>
+
+_NS_OSTR_BEGIN
+
+std::string_view u8_cached_string::utf8() const
+{
+	if (const std::string* u8 = _u8.load(std::memory_order_acquire))
+		return *u8;
+
+	// threads racing here all encode, the first to publish wins and the others drop theirs
+	auto encoded = std::make_unique<std::string>();
+	(void)_str.to_sv().encode_to_utf8(*encoded);
+	std::string* published = nullptr;
+	if (_u8.compare_exchange_strong(published, encoded.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+		return *encoded.release();
+	return *published;
+}
+
+_NS_OSTR_END
@@ -1,5 +1,7 @@
 #include "ostring/coder.h"
 #include "ostring/helpers.h"
+#include "stream_coder.h"
+#include <cstring>
 #include <string>
 #include <string_view>
 
@@ -7,36 +9,1118 @@ _NS_OSTR_BEGIN
 
 bool coder::convert_append(std::string_view sv8, std::u16string& out_u16)
 {
-	out_u16.reserve(out_u16.size() + sv8.size());
-	small_size_t utf8_length;
-	small_size_t utf16_length;
-	surrogate_pair pair;
-	for (auto it = sv8.cbegin(); it != sv8.cend();)
+	const size_t start = out_u16.size();
+	out_u16.resize(start + utf16_capacity(sv8.size()));
+	const transcode_result result = decode_utf8(sv8, out_u16.data() + start);
+	out_u16.resize(start + result.written);
+	return true;
+}
+
+void coder::widen_latin1(std::string_view bytes, char16_t* out_u16) noexcept
+{
+	const uint8_t* const src = reinterpret_cast<const uint8_t*>(bytes.data());
+	const size_t n = bytes.size();
+	size_t i = 0;
+#if OSTR_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; n - i >= 16; i += 16)
 	{
-		helper::codepoint::utf8_to_utf16((const char8_t*)(it.operator->()), utf8_length, pair, utf16_length);
-		out_u16.append(&pair[0], &pair[utf16_length]);
-		it += utf8_length;
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out_u16 + i), _mm_unpacklo_epi8(v, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out_u16 + i + 8), _mm_unpackhi_epi8(v, zero));
 	}
-	out_u16.shrink_to_fit();
-	return true;
+#endif
+	for (; i < n; ++i)
+		out_u16[i] = src[i];
+}
+
+size_t coder::latin1_prefix(std::u16string_view sv16) noexcept
+{
+	const char16_t* const src = sv16.data();
+	const size_t n = sv16.size();
+	size_t i = 0;
+#if OSTR_SSE2
+	// any high byte set ends the prefix, found in the block it is in
+	const __m128i high = _mm_set1_epi16(short(0xFF00));
+	const __m128i zero = _mm_setzero_si128();
+	for (; n - i >= 8; i += 8)
+	{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, high), zero)) != 0xFFFF)
+			break;
+	}
+#endif
+	while (i < n && src[i] < 0x100)
+		++i;
+	return i;
+}
+
+void coder::narrow_latin1(std::u16string_view sv16, char* out_bytes) noexcept
+{
+	const char16_t* const src = sv16.data();
+	const size_t n = sv16.size();
+	size_t i = 0;
+#if OSTR_SSE2
+	for (; n - i >= 16; i += 16)
+	{
+		const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out_bytes + i), _mm_packus_epi16(lo, hi));
+	}
+#endif
+	for (; i < n; ++i)
+		out_bytes[i] = char(src[i]);
 }
 
 bool coder::convert_append(std::u16string_view sv16, std::string& out_u8)
 {
-	constexpr size_t CHAR_IN_SURROGATE_PAIR = 2;
-	out_u8.reserve(out_u8.size() + sv16.size() * CHAR_IN_SURROGATE_PAIR);
-	small_size_t utf16_length;
-	small_size_t utf8_length;
-	utf8_sequence seq;
-	for (auto it = sv16.cbegin(); it != sv16.cend();)
+	// measured first, the bound of 3 bytes per unit is far off for most text
+	const size_t start = out_u8.size();
+	out_u8.resize(start + utf8_length_from_utf16(sv16));
+	encode_utf8(sv16, out_u8.data() + start);
+	return true;
+}
+
+namespace
+{
+	// one utf-8 sequence from src, which is not end
+	struct utf8_read
+	{
+		// bytes the lead byte asks for, 0 when it is not a lead byte
+		size_t length;
+		// bytes of them well-formed, length when the sequence is complete
+		size_t valid;
+		char32_t value;
+	};
+
+	// @param surrogates: take encoded surrogates as well-formed, for WTF-8.
+	inline utf8_read read_utf8(const uint8_t* src, const uint8_t* end, bool surrogates = false) noexcept
+	{
+		using namespace helper::codepoint;
+
+		// length and the range of the second byte, which rules out overlongs and surrogates
+		const uint8_t c0 = *src;
+		utf8_read ans{ 0, 1, 0 };
+		uint8_t low = 0x80, high = 0xBF;
+		if (c0 >= 0xC2 && c0 <= 0xDF) { ans.length = 2; ans.value = c0 & 0x1F; }
+		else if (c0 >= 0xE0 && c0 <= 0xEF) { ans.length = 3; ans.value = c0 & 0x0F; low = c0 == 0xE0 ? 0xA0 : 0x80; high = c0 == 0xED && !surrogates ? 0x9F : 0xBF; }
+		else if (c0 >= 0xF0 && c0 <= 0xF4) { ans.length = 4; ans.value = c0 & 0x07; low = c0 == 0xF0 ? 0x90 : 0x80; high = c0 == 0xF4 ? 0x8F : 0xBF; }
+		else return ans;
+
+		for (; ans.valid < ans.length && src + ans.valid != end; ++ans.valid)
+		{
+			const uint8_t ci = src[ans.valid];
+			if (ans.valid == 1 ? (ci < low || ci > high) : (ci < 0x80 || ci > 0xBF))
+				break;
+			ans.value = (ans.value << UTF8_BIT_SEQUENCE_FOLLOWING) | (ci & 0x3F);
+		}
+		return ans;
+	}
+
+	// Encode until the input ends or the next code point does not fit in capacity bytes.
+	coder::transcode_result encode_utf8_impl(std::u16string_view sv16, char* out_u8, size_t capacity, bool final, coder::error_policy policy) noexcept
+	{
+		using namespace helper::codepoint;
+
+		const char16_t* src = sv16.data();
+		const char16_t* const end = src + sv16.size();
+		size_t written = 0;
+		bool ill_formed = false;
+
+		while (src != end)
+		{
+#if OSTR_SSE2
+			// 8 ascii code units at once
+			if (end - src >= 8 && capacity - written >= 8)
+			{
+				const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				const __m128i high = _mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xFF80)));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) == 0xFFFF)
+				{
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(out_u8 + written), _mm_packus_epi16(units, units));
+					src += 8;
+					written += 8;
+					continue;
+				}
+			}
+#endif
+			const char16_t c = *src;
+			if (c < 0x80)
+			{
+				if (written == capacity)
+					break;
+				out_u8[written++] = static_cast<char>(c);
+				++src;
+				continue;
+			}
+			if (c < 0x800)
+			{
+				if (capacity - written < 2)
+					break;
+				out_u8[written++] = static_cast<char>((c >> 6) | 0xc0);
+				out_u8[written++] = static_cast<char>((c & 0x3f) | 0x80);
+				++src;
+				continue;
+			}
+
+			char32_t value = c;
+			small_size_t length = 1;
+			bool lone = is_trail_surrogate(c);
+			if (is_lead_surrogate(c))
+			{
+				if (src + 1 == end && !final)
+					break;
+				if (src + 1 != end && is_trail_surrogate(src[1]))
+				{
+					value = (char32_t(c - LEAD_SURROGATE_MIN) << SURROGATE_LEAD_OFFSET) + (src[1] - TRAIL_SURROGATE_MIN) + SUPPLEMENTARY_DELTA;
+					length = 2;
+				}
+				else
+				{
+					lone = true;
+				}
+			}
+			if (lone)
+			{
+				ill_formed = true;
+				if (policy == coder::error_policy::strict)
+					break;
+				if (policy == coder::error_policy::replace)
+					value = 0xFFFD;
+			}
+
+			utf8_sequence seq;
+			small_size_t seq_length;
+			utf32_to_utf8(value, seq, seq_length);
+			if (capacity - written < seq_length)
+				break;
+			for (small_size_t i = 0; i < seq_length; ++i)
+				out_u8[written++] = static_cast<char>(seq[i]);
+			src += length;
+		}
+
+		return { size_t(src - sv16.data()), written, ill_formed };
+	}
+
+	// Decode to utf-16 or utf-32 until the input ends or the next code point does not fit in capacity units.
+	// Without Write only the units are counted, out is never touched.
+	template<typename Char, bool Write>
+	coder::transcode_result decode_utf8_impl(std::string_view sv8, Char* out, size_t capacity, bool final, coder::error_policy policy) noexcept
+	{
+		using namespace helper::codepoint;
+
+		const auto begin = reinterpret_cast<const uint8_t*>(sv8.data());
+		const uint8_t* src = begin;
+		const uint8_t* const end = src + sv8.size();
+		const bool surrogates = policy == coder::error_policy::pass_through;
+		size_t written = 0;
+		bool ill_formed = false;
+
+		while (src != end)
+		{
+#if OSTR_SSE2
+			// 16 ascii bytes at once
+			if (end - src >= 16 && capacity - written >= 16)
+			{
+				const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				if (_mm_movemask_epi8(bytes) == 0)
+				{
+					if constexpr (Write)
+					{
+						const __m128i zero = _mm_setzero_si128();
+						const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+						const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+						if constexpr (sizeof(Char) == 2)
+						{
+							_mm_storeu_si128(reinterpret_cast<__m128i*>(out + written), low);
+							_mm_storeu_si128(reinterpret_cast<__m128i*>(out + written + 8), high);
+						}
+						else
+						{
+							_mm_storeu_si128(reinterpret_cast<__m128i*>(out + written), _mm_unpacklo_epi16(low, zero));
+							_mm_storeu_si128(reinterpret_cast<__m128i*>(out + written + 4), _mm_unpackhi_epi16(low, zero));
+							_mm_storeu_si128(reinterpret_cast<__m128i*>(out + written + 8), _mm_unpacklo_epi16(high, zero));
+							_mm_storeu_si128(reinterpret_cast<__m128i*>(out + written + 12), _mm_unpackhi_epi16(high, zero));
+						}
+					}
+					src += 16;
+					written += 16;
+					continue;
+				}
+			}
+#endif
+			const uint8_t c0 = *src;
+			if (c0 < 0x80)
+			{
+				if (written == capacity)
+					break;
+				if constexpr (Write)
+					out[written] = c0;
+				++written;
+				++src;
+				continue;
+			}
+
+			const utf8_read seq = read_utf8(src, end, surrogates);
+			if (seq.valid < seq.length && src + seq.valid == end && !final)
+			{
+				// cut by the end of input, wait for the rest
+				break;
+			}
+
+			if (seq.valid != seq.length || seq.length == 0)
+			{
+				ill_formed = true;
+				if (policy == coder::error_policy::strict || written == capacity)
+					break;
+				if constexpr (Write)
+					out[written] = 0xFFFD;
+				++written;
+				src += seq.valid;
+				continue;
+			}
+
+			if (sizeof(Char) == 2 && seq.value > FIRST_PLANE_MAX)
+			{
+				if (capacity - written < 2)
+					break;
+				if constexpr (Write)
+				{
+					out[written] = static_cast<Char>(((seq.value - SUPPLEMENTARY_DELTA) >> SURROGATE_LEAD_OFFSET) + LEAD_SURROGATE_MIN);
+					out[written + 1] = static_cast<Char>(((seq.value - SUPPLEMENTARY_DELTA) & SURROGATE_MASK) + TRAIL_SURROGATE_MIN);
+				}
+				written += 2;
+			}
+			else
+			{
+				if (written == capacity)
+					break;
+				// only under pass_through
+				if (seq.value >= LEAD_SURROGATE_MIN && seq.value <= TRAIL_SURROGATE_MAX)
+					ill_formed = true;
+				if constexpr (Write)
+					out[written] = static_cast<Char>(seq.value);
+				++written;
+			}
+			src += seq.length;
+		}
+
+		return { size_t(src - begin), written, ill_formed };
+	}
+
+	size_t find_invalid_utf8_scalar(const uint8_t* begin, const uint8_t* src, const uint8_t* end) noexcept
+	{
+		while (src != end)
+		{
+#if OSTR_SSE2
+			if (end - src >= 16 && _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))) == 0)
+			{
+				src += 16;
+				continue;
+			}
+#endif
+			if (*src < 0x80)
+			{
+				++src;
+				continue;
+			}
+			const utf8_read seq = read_utf8(src, end);
+			if (seq.length == 0 || seq.valid != seq.length)
+				return size_t(src - begin);
+			src += seq.length;
+		}
+		return SIZE_MAX;
+	}
+
+#if OSTR_SSSE3
+	// Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte".
+	// The error classes of each byte pair are looked up by nibble and and-ed together,
+	// the third and fourth bytes of long sequences are checked by the byte 2 and 3 places back.
+	namespace lookup
+	{
+		constexpr uint8_t too_short = 1 << 0;
+		constexpr uint8_t too_long = 1 << 1;
+		constexpr uint8_t overlong_3 = 1 << 2;
+		constexpr uint8_t too_large = 1 << 3;
+		constexpr uint8_t surrogate = 1 << 4;
+		constexpr uint8_t overlong_2 = 1 << 5;
+		constexpr uint8_t too_large_1000 = 1 << 6;
+		constexpr uint8_t overlong_4 = 1 << 6;
+		constexpr uint8_t two_conts = 1 << 7;
+		constexpr uint8_t carry = too_short | too_long | two_conts;
+
+		inline __m128i table(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4, uint8_t b5, uint8_t b6, uint8_t b7,
+			uint8_t b8, uint8_t b9, uint8_t b10, uint8_t b11, uint8_t b12, uint8_t b13, uint8_t b14, uint8_t b15)
+		{
+			return _mm_setr_epi8(char(b0), char(b1), char(b2), char(b3), char(b4), char(b5), char(b6), char(b7),
+				char(b8), char(b9), char(b10), char(b11), char(b12), char(b13), char(b14), char(b15));
+		}
+
+		inline __m128i high_nibble(__m128i v)
+		{
+			return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F));
+		}
+
+		inline __m128i errors(__m128i input, __m128i prev_input)
+		{
+			const __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+			const __m128i byte_1_high = _mm_shuffle_epi8(table(
+				too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+				two_conts, two_conts, two_conts, two_conts,
+				too_short | overlong_2,
+				too_short,
+				too_short | overlong_3 | surrogate,
+				too_short | too_large | too_large_1000 | overlong_4), high_nibble(prev1));
+			const __m128i byte_1_low = _mm_shuffle_epi8(table(
+				carry | overlong_3 | overlong_2 | overlong_4,
+				carry | overlong_2,
+				carry,
+				carry,
+				carry | too_large,
+				carry | too_large | too_large_1000,
+				carry | too_large | too_large_1000,
+				carry | too_large | too_large_1000,
+				carry | too_large | too_large_1000,
+				carry | too_large | too_large_1000,
+				carry | too_large | too_large_1000,
+				carry | too_large | too_large_1000,
+				carry | too_large | too_large_1000,
+				carry | too_large | too_large_1000 | surrogate,
+				carry | too_large | too_large_1000,
+				carry | too_large | too_large_1000), _mm_and_si128(prev1, _mm_set1_epi8(0x0F)));
+			const __m128i byte_2_high = _mm_shuffle_epi8(table(
+				too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+				too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+				too_long | overlong_2 | two_conts | overlong_3 | too_large,
+				too_long | overlong_2 | two_conts | surrogate | too_large,
+				too_long | overlong_2 | two_conts | surrogate | too_large,
+				too_short, too_short, too_short, too_short), high_nibble(input));
+			const __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+			// continuations 2 and 3 bytes after a lead of 3 and 4 bytes, where two_conts is expected
+			const __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+			const __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+			const __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(char(0xE0 - 0x80)));
+			const __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xF0 - 0x80)));
+			const __m128i must_be_continuation = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(char(0x80)));
+			return _mm_xor_si128(must_be_continuation, special);
+		}
+
+		// non zero where a sequence started in the last 3 bytes is cut by the block end
+		inline __m128i incomplete(__m128i input)
+		{
+			const __m128i max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, char(0xF0 - 1), char(0xE0 - 1), char(0xC0 - 1));
+			return _mm_subs_epu8(input, max);
+		}
+
+		inline bool any(__m128i v)
+		{
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF;
+		}
+	}
+#endif
+}
+
+size_t coder::find_invalid_utf8(std::string_view sv8) noexcept
+{
+	const auto begin = reinterpret_cast<const uint8_t*>(sv8.data());
+	const uint8_t* const end = begin + sv8.size();
+	const uint8_t* src = begin;
+
+#if OSTR_SSSE3
+	__m128i prev = _mm_setzero_si128();
+	__m128i prev_incomplete = _mm_setzero_si128();
+	for (; end - src >= 16; src += 16)
+	{
+		const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		if (_mm_movemask_epi8(input) == 0)
+		{
+			if (lookup::any(prev_incomplete))
+				break;
+		}
+		else if (lookup::any(lookup::errors(input, prev)))
+		{
+			break;
+		}
+		prev = input;
+		prev_incomplete = lookup::incomplete(input);
+	}
+	// all sequences ending before src are well-formed, go on from the one src is in
+	const uint8_t* const limit = src;
+	src = src - begin >= 3 ? src - 3 : begin;
+	while (src != limit && (*src & 0xC0) == 0x80)
+		++src;
+#endif
+	return find_invalid_utf8_scalar(begin, src, end);
+}
+
+size_t coder::find_invalid_utf16(std::u16string_view sv16) noexcept
+{
+	using namespace helper::codepoint;
+
+	const char16_t* const begin = sv16.data();
+	const char16_t* const end = begin + sv16.size();
+	const char16_t* src = begin;
+	while (src != end)
+	{
+#if OSTR_SSE2
+		// 8 code units without surrogates at once
+		if (end - src >= 8)
+		{
+			const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			const __m128i surrogates = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800))), _mm_set1_epi16(static_cast<short>(0xD800)));
+			if (_mm_movemask_epi8(surrogates) == 0)
+			{
+				src += 8;
+				continue;
+			}
+		}
+#endif
+		const char16_t c = *src;
+		if (c < LEAD_SURROGATE_MIN || c > TRAIL_SURROGATE_MAX)
+		{
+			++src;
+			continue;
+		}
+		if (is_lead_surrogate(c) && src + 1 != end && is_trail_surrogate(src[1]))
+		{
+			src += 2;
+			continue;
+		}
+		return size_t(src - begin);
+	}
+	return SIZE_MAX;
+}
+
+coder::transcode_result coder::encode_utf8(std::u16string_view sv16, char* out_u8, bool final, error_policy policy) noexcept
+{
+	return encode_utf8_impl(sv16, out_u8, SIZE_MAX, final, policy);
+}
+
+coder::transcode_result coder::decode_utf8(std::string_view sv8, char16_t* out_u16, bool final, error_policy policy) noexcept
+{
+	return decode_utf8_impl<char16_t, true>(sv8, out_u16, SIZE_MAX, final, policy);
+}
+
+size_t coder::utf16_length_from_utf8(std::string_view sv8, error_policy policy) noexcept
+{
+	return decode_utf8_impl<char16_t, false>(sv8, nullptr, SIZE_MAX, true, policy).written;
+}
+
+size_t coder::utf8_length_from_utf16(std::u16string_view sv16, error_policy policy) noexcept
+{
+	using namespace helper::codepoint;
+
+	// a lone surrogate takes 3 bytes both as U+FFFD and passed through
+	if (policy == error_policy::strict)
+		sv16 = sv16.substr(0, find_invalid_utf16(sv16));
+
+	const char16_t* src = sv16.data();
+	const char16_t* const end = src + sv16.size();
+	size_t length = 0;
+
+	while (src != end)
+	{
+#if OSTR_SSE2
+		// 8 code units without surrogates at once
+		if (end - src >= 8)
+		{
+			const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			const __m128i surrogates = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800))), _mm_set1_epi16(static_cast<short>(0xD800)));
+			if (_mm_movemask_epi8(surrogates) == 0)
+			{
+				const __m128i two = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xFF80))), _mm_setzero_si128());
+				const __m128i three = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800))), _mm_setzero_si128());
+				// 3 bytes per unit, less one below each bound, the lanes of two and three are -1 there
+				__m128i sum = _mm_madd_epi16(_mm_add_epi16(two, three), _mm_set1_epi16(1));
+				sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+				sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+				length += size_t(24 + _mm_cvtsi128_si32(sum));
+				src += 8;
+				continue;
+			}
+		}
+#endif
+		const char16_t c = *src++;
+		if (c < 0x80)
+			length += 1;
+		else if (c < 0x800)
+			length += 2;
+		else if (is_lead_surrogate(c) && src != end && is_trail_surrogate(*src))
+		{
+			length += 4;
+			++src;
+		}
+		else
+			length += 3;
+	}
+	return length;
+}
+
+coder::transcode_result coder::convert_into(std::string_view sv8, char16_t* out_u16, size_t capacity, error_policy policy) noexcept
+{
+	return decode_utf8_impl<char16_t, true>(sv8, out_u16, capacity, true, policy);
+}
+
+coder::transcode_result coder::convert_into(std::u16string_view sv16, char* out_u8, size_t capacity, error_policy policy) noexcept
+{
+	return encode_utf8_impl(sv16, out_u8, capacity, true, policy);
+}
+
+namespace
+{
+	// utf-32 as utf-16 code units, U+FFFD for surrogates and values past U+10FFFF
+	size_t utf16_length_from_utf32(std::u32string_view sv32) noexcept
+	{
+		using namespace helper::codepoint;
+
+		const char32_t* src = sv32.data();
+		const char32_t* const end = src + sv32.size();
+		size_t pairs = 0;
+#if OSTR_SSE2
+		// count lanes in (0xFFFF, 0x110000), signed compares see values past 0x7FFFFFFF as negative and so invalid
+		__m128i counts = _mm_setzero_si128();
+		for (; end - src >= 4; src += 4)
+		{
+			const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			const __m128i supplementary = _mm_and_si128(_mm_cmpgt_epi32(values, _mm_set1_epi32(0xFFFF)), _mm_cmplt_epi32(values, _mm_set1_epi32(0x110000)));
+			counts = _mm_sub_epi32(counts, supplementary);
+		}
+		counts = _mm_add_epi32(counts, _mm_shuffle_epi32(counts, 0x4E));
+		counts = _mm_add_epi32(counts, _mm_shuffle_epi32(counts, 0xB1));
+		pairs = size_t(_mm_cvtsi128_si32(counts));
+#endif
+		for (; src != end; ++src)
+			pairs += *src > FIRST_PLANE_MAX && *src <= 0x10FFFF;
+		return sv32.size() + pairs;
+	}
+
+	size_t encode_utf32_to_utf16(std::u32string_view sv32, char16_t* out_u16) noexcept
+	{
+		using namespace helper::codepoint;
+
+		const char32_t* src = sv32.data();
+		const char32_t* const end = src + sv32.size();
+		char16_t* dst = out_u16;
+		while (src != end)
+		{
+#if OSTR_SSE2
+			// 4 code points of the first plane without surrogates at once
+			if (end - src >= 4)
+			{
+				const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				const __m128i wide = _mm_cmpeq_epi32(_mm_and_si128(values, _mm_set1_epi32(int(0xFFFF0000))), _mm_setzero_si128());
+				const __m128i surrogate = _mm_cmpeq_epi32(_mm_and_si128(values, _mm_set1_epi32(0xF800)), _mm_set1_epi32(0xD800));
+				if (_mm_movemask_epi8(_mm_andnot_si128(surrogate, wide)) == 0xFFFF)
+				{
+					// no unsigned 32 to 16 pack in sse2, shift into the signed range and back
+					const __m128i shifted = _mm_sub_epi32(values, _mm_set1_epi32(0x8000));
+					const __m128i packed = _mm_add_epi16(_mm_packs_epi32(shifted, shifted), _mm_set1_epi16(static_cast<short>(0x8000)));
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), packed);
+					src += 4;
+					dst += 4;
+					continue;
+				}
+			}
+#endif
+			const char32_t c = *src++;
+			if (c <= FIRST_PLANE_MAX)
+			{
+				*dst++ = c >= LEAD_SURROGATE_MIN && c <= TRAIL_SURROGATE_MAX ? char16_t(0xFFFD) : static_cast<char16_t>(c);
+			}
+			else if (c <= 0x10FFFF)
+			{
+				*dst++ = static_cast<char16_t>(((c - SUPPLEMENTARY_DELTA) >> SURROGATE_LEAD_OFFSET) + LEAD_SURROGATE_MIN);
+				*dst++ = static_cast<char16_t>(((c - SUPPLEMENTARY_DELTA) & SURROGATE_MASK) + TRAIL_SURROGATE_MIN);
+			}
+			else
+			{
+				*dst++ = 0xFFFD;
+			}
+		}
+		return size_t(dst - out_u16);
+	}
+
+	// utf-16 as code points, a lone surrogate is one U+FFFD
+	size_t utf32_length_from_utf16(std::u16string_view sv16) noexcept
+	{
+		using namespace helper::codepoint;
+
+		const char16_t* src = sv16.data();
+		const char16_t* const end = src + sv16.size();
+		size_t length = 0;
+		while (src != end)
+		{
+#if OSTR_SSE2
+			if (end - src >= 8)
+			{
+				const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				const __m128i surrogates = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800))), _mm_set1_epi16(static_cast<short>(0xD800)));
+				if (_mm_movemask_epi8(surrogates) == 0)
+				{
+					src += 8;
+					length += 8;
+					continue;
+				}
+			}
+#endif
+			src += is_lead_surrogate(*src) && src + 1 != end && is_trail_surrogate(src[1]) ? 2 : 1;
+			++length;
+		}
+		return length;
+	}
+
+	size_t decode_utf16_to_utf32(std::u16string_view sv16, char32_t* out_u32) noexcept
+	{
+		using namespace helper::codepoint;
+
+		const char16_t* src = sv16.data();
+		const char16_t* const end = src + sv16.size();
+		char32_t* dst = out_u32;
+		while (src != end)
+		{
+#if OSTR_SSE2
+			// 8 code units without surrogates widened at once
+			if (end - src >= 8)
+			{
+				const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				const __m128i surrogates = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800))), _mm_set1_epi16(static_cast<short>(0xD800)));
+				if (_mm_movemask_epi8(surrogates) == 0)
+				{
+					const __m128i zero = _mm_setzero_si128();
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(units, zero));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), _mm_unpackhi_epi16(units, zero));
+					src += 8;
+					dst += 8;
+					continue;
+				}
+			}
+#endif
+			const char16_t c = *src++;
+			if (c < LEAD_SURROGATE_MIN || c > TRAIL_SURROGATE_MAX)
+			{
+				*dst++ = c;
+			}
+			else if (is_lead_surrogate(c) && src != end && is_trail_surrogate(*src))
+			{
+				*dst++ = (char32_t(c - LEAD_SURROGATE_MIN) << SURROGATE_LEAD_OFFSET) + (*src - TRAIL_SURROGATE_MIN) + SUPPLEMENTARY_DELTA;
+				++src;
+			}
+			else
+			{
+				*dst++ = 0xFFFD;
+			}
+		}
+		return size_t(dst - out_u32);
+	}
+
+	// bytes of one code point in utf-8, 3 for the U+FFFD standing for an invalid one
+	inline size_t utf8_length_of(char32_t c) noexcept
+	{
+		if (c < 0x80) return 1;
+		if (c < 0x800) return 2;
+		if (c < 0x10000 || c > 0x10FFFF) return 3;
+		return 4;
+	}
+
+	size_t utf8_length_from_utf32(std::u32string_view sv32) noexcept
 	{
-		helper::codepoint::utf16_to_utf8(&*it, utf16_length, seq, utf8_length);
-		out_u8.append(&seq[0], &seq[utf8_length]);
-		it += utf16_length;
+		const char32_t* src = sv32.data();
+		const char32_t* const end = src + sv32.size();
+		size_t length = 0;
+		while (src != end)
+		{
+#if OSTR_SSE2
+			if (end - src >= 4)
+			{
+				const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(values, _mm_set1_epi32(int(0xFFFFFF80))), _mm_setzero_si128())) == 0xFFFF)
+				{
+					src += 4;
+					length += 4;
+					continue;
+				}
+			}
+#endif
+			length += utf8_length_of(*src++);
+		}
+		return length;
 	}
-	out_u8.shrink_to_fit();
+
+	size_t encode_utf32_to_utf8(std::u32string_view sv32, char* out_u8) noexcept
+	{
+		using namespace helper::codepoint;
+
+		const char32_t* src = sv32.data();
+		const char32_t* const end = src + sv32.size();
+		char* dst = out_u8;
+		while (src != end)
+		{
+#if OSTR_SSE2
+			// 4 ascii code points narrowed at once
+			if (end - src >= 4)
+			{
+				const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(values, _mm_set1_epi32(int(0xFFFFFF80))), _mm_setzero_si128())) == 0xFFFF)
+				{
+					const __m128i units = _mm_packs_epi32(values, values);
+					const int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(units, units));
+					std::memcpy(dst, &bytes, 4);
+					src += 4;
+					dst += 4;
+					continue;
+				}
+			}
+#endif
+			char32_t c = *src++;
+			if (c > 0x10FFFF || (c >= LEAD_SURROGATE_MIN && c <= TRAIL_SURROGATE_MAX))
+				c = 0xFFFD;
+			utf8_sequence seq;
+			small_size_t seq_length;
+			utf32_to_utf8(c, seq, seq_length);
+			for (small_size_t i = 0; i < seq_length; ++i)
+				*dst++ = static_cast<char>(seq[i]);
+		}
+		return size_t(dst - out_u8);
+	}
+}
+
+bool coder::convert_append(std::string_view sv8, std::u32string& out_u32)
+{
+	// one pass into a buffer of the byte count, never less than the code points
+	const size_t start = out_u32.size();
+	out_u32.resize(start + sv8.size());
+	const transcode_result result = decode_utf8_impl<char32_t, true>(sv8, out_u32.data() + start, SIZE_MAX, true, error_policy::replace);
+	out_u32.resize(start + result.written);
+	return true;
+}
+
+bool coder::convert_append(std::u32string_view sv32, std::string& out_u8)
+{
+	const size_t start = out_u8.size();
+	out_u8.resize(start + utf8_length_from_utf32(sv32));
+	encode_utf32_to_utf8(sv32, out_u8.data() + start);
+	return true;
+}
+
+bool coder::convert_append(std::u16string_view sv16, std::u32string& out_u32)
+{
+	const size_t start = out_u32.size();
+	out_u32.resize(start + utf32_length_from_utf16(sv16));
+	decode_utf16_to_utf32(sv16, out_u32.data() + start);
 	return true;
 }
 
+bool coder::convert_append(std::u32string_view sv32, std::u16string& out_u16)
+{
+	const size_t start = out_u16.size();
+	out_u16.resize(start + utf16_length_from_utf32(sv32));
+	encode_utf32_to_utf16(sv32, out_u16.data() + start);
+	return true;
+}
+
+namespace
+{
+	// bits of a 16 bit mask
+	inline size_t popcount16(uint32_t x) noexcept
+	{
+		x = x - ((x >> 1) & 0x5555);
+		x = (x & 0x3333) + ((x >> 2) & 0x3333);
+		x = (x + (x >> 4)) & 0x0F0F;
+		return (x + (x >> 8)) & 0x1F;
+	}
+
+#if OSTR_SSE2
+	inline __m128i swap_bytes(__m128i units) noexcept
+	{
+		return _mm_or_si128(_mm_slli_epi16(units, 8), _mm_srli_epi16(units, 8));
+	}
+#endif
+}
+
+endian coder::take_utf16_bom(std::string_view& bytes, endian fallback) noexcept
+{
+	if (bytes.size() >= 2)
+	{
+		const uint8_t b0 = static_cast<uint8_t>(bytes[0]);
+		const uint8_t b1 = static_cast<uint8_t>(bytes[1]);
+		if (b0 == 0xFE && b1 == 0xFF)
+		{
+			bytes.remove_prefix(2);
+			return endian::big;
+		}
+		if (b0 == 0xFF && b1 == 0xFE)
+		{
+			bytes.remove_prefix(2);
+			return endian::little;
+		}
+	}
+	return fallback;
+}
+
+size_t coder::append_utf16_bytes(std::string_view bytes, endian e, std::u16string& out_u16)
+{
+	using namespace helper::codepoint;
+
+	const size_t count = bytes.size() / 2;
+	const size_t start = out_u16.size();
+	out_u16.resize(start + count);
+	const char* const src = bytes.data();
+	char16_t* const dst = out_u16.data() + start;
+	const bool swap = e != endian::native;
+
+	size_t pairs = 0;
+	// the last unit written is a lead surrogate
+	bool lead = false;
+	size_t i = 0;
+#if OSTR_SSE2
+	const __m128i surrogate_bits = _mm_set1_epi16(static_cast<short>(0xFC00));
+	const __m128i lead_bits = _mm_set1_epi16(static_cast<short>(0xD800));
+	const __m128i trail_bits = _mm_set1_epi16(static_cast<short>(0xDC00));
+	for (; count - i >= 8; i += 8)
+	{
+		__m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+		if (swap)
+			units = swap_bytes(units);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), units);
+
+		// two mask bits per unit, a pair is a lead with a trail one unit after
+		const __m128i high = _mm_and_si128(units, surrogate_bits);
+		const uint32_t leads = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi16(high, lead_bits)));
+		const uint32_t trails = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi16(high, trail_bits)));
+		if (leads | trails)
+			pairs += popcount16(((leads << 2) | uint32_t(lead)) & trails & 0x5555);
+		lead = (leads >> 14) & 1;
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		char16_t c;
+		std::memcpy(&c, src + i * 2, 2);
+		c = swap_endian(c, e);
+		dst[i] = c;
+		pairs += lead && is_trail_surrogate(c);
+		lead = is_lead_surrogate(c);
+	}
+	return pairs;
+}
+
+void coder::append_utf16_bytes(std::u16string_view sv16, endian e, std::string& out_bytes, bool bom)
+{
+	const size_t start = out_bytes.size();
+	out_bytes.resize(start + (sv16.size() + (bom ? 1 : 0)) * 2);
+	char* dst = out_bytes.data() + start;
+	if (bom)
+	{
+		const char16_t mark = helper::codepoint::swap_endian(u'\uFEFF', e);
+		std::memcpy(dst, &mark, 2);
+		dst += 2;
+	}
+	if (e == endian::native)
+	{
+		std::memcpy(dst, sv16.data(), sv16.size() * 2);
+		return;
+	}
+
+	size_t i = 0;
+#if OSTR_SSE2
+	for (; sv16.size() - i >= 8; i += 8)
+	{
+		const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sv16.data() + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2), swap_bytes(units));
+	}
+#endif
+	for (; i < sv16.size(); ++i)
+	{
+		const char16_t c = helper::codepoint::swap_endian(sv16[i], e);
+		std::memcpy(dst + i * 2, &c, 2);
+	}
+}
+
+namespace
+{
+	inline bool is_utf8_continuation(uint8_t c) noexcept
+	{
+		return (c & 0xC0) == 0x80;
+	}
+
+#if OSTR_SSE2
+	// one lane per byte that starts a code point, continuation bytes are below -64 as signed
+	inline __m128i utf8_starts(__m128i bytes) noexcept
+	{
+		return _mm_cmpgt_epi8(bytes, _mm_set1_epi8(-65));
+	}
+#endif
+}
+
+size_t coder::count_utf8_codepoints(std::string_view sv8) noexcept
+{
+	const uint8_t* src = reinterpret_cast<const uint8_t*>(sv8.data());
+	const uint8_t* const end = src + sv8.size();
+	size_t count = 0;
+#if OSTR_SSE2
+	// byte counters in lanes, summed before any can wrap
+	const __m128i zero = _mm_setzero_si128();
+	while (end - src >= 16)
+	{
+		__m128i counts = zero;
+		for (int block = 0; block < 255 && end - src >= 16; ++block, src += 16)
+			counts = _mm_sub_epi8(counts, utf8_starts(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))));
+		const __m128i sums = _mm_sad_epu8(counts, zero);
+		count += size_t(_mm_cvtsi128_si32(sums)) + size_t(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+	}
+#endif
+	for (; src != end; ++src)
+		count += !is_utf8_continuation(*src);
+	return count;
+}
+
+size_t coder::utf8_codepoint_offset(std::string_view sv8, size_t index) noexcept
+{
+	const uint8_t* const begin = reinterpret_cast<const uint8_t*>(sv8.data());
+	const uint8_t* const end = begin + sv8.size();
+	const uint8_t* src = begin;
+#if OSTR_SSE2
+	for (; end - src >= 16; src += 16)
+	{
+		const uint32_t starts = uint32_t(_mm_movemask_epi8(utf8_starts(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)))));
+		const size_t count = popcount16(starts);
+		if (count > index)
+			break;
+		index -= count;
+	}
+#endif
+	for (; src != end; ++src)
+	{
+		if (is_utf8_continuation(*src))
+			continue;
+		if (index == 0)
+			return size_t(src - begin);
+		--index;
+	}
+	return sv8.size();
+}
+
+int coder::compare(std::string_view u8, std::u16string_view u16) noexcept
+{
+	using namespace helper::codepoint;
+
+	const uint8_t* s8 = reinterpret_cast<const uint8_t*>(u8.data());
+	const uint8_t* const end8 = s8 + u8.size();
+	const char16_t* s16 = u16.data();
+	const char16_t* const end16 = s16 + u16.size();
+
+	while (true)
+	{
+#if OSTR_SSE2
+		// 16 ascii bytes against 16 code units, both advance alike up to the first difference
+		if (end8 - s8 >= 16 && end16 - s16 >= 16)
+		{
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s8));
+			if (_mm_movemask_epi8(bytes) == 0)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i low = _mm_cmpeq_epi16(_mm_unpacklo_epi8(bytes, zero), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s16)));
+				const __m128i high = _mm_cmpeq_epi16(_mm_unpackhi_epi8(bytes, zero), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s16 + 8)));
+				uint32_t equal = uint32_t(_mm_movemask_epi8(low)) | (uint32_t(_mm_movemask_epi8(high)) << 16);
+				size_t same = equal == UINT32_MAX ? 16 : 0;
+				for (; same != 16 && (equal & 1); equal >>= 2)
+					++same;
+				s8 += same;
+				s16 += same;
+				if (same == 16)
+					continue;
+			}
+		}
+#endif
+		if (s8 == end8 || s16 == end16)
+			break;
+
+		// one code point of each, ill-formed as U+FFFD
+		char32_t c8 = *s8;
+		if (c8 < 0x80)
+		{
+			++s8;
+		}
+		else
+		{
+			const utf8_read read = read_utf8(s8, end8);
+			const bool well_formed = read.length != 0 && read.valid == read.length;
+			c8 = well_formed ? read.value : 0xFFFD;
+			s8 += read.valid;
+		}
+
+		char32_t c16 = *s16++;
+		if (is_lead_surrogate(char16_t(c16)) && s16 != end16 && is_trail_surrogate(*s16))
+			c16 = (char32_t(c16 - LEAD_SURROGATE_MIN) << SURROGATE_LEAD_OFFSET) + (*s16++ - TRAIL_SURROGATE_MIN) + SUPPLEMENTARY_DELTA;
+		else if (c16 >= LEAD_SURROGATE_MIN && c16 <= TRAIL_SURROGATE_MAX)
+			c16 = 0xFFFD;
+
+		if (c8 != c16)
+			return c8 < c16 ? -1 : 1;
+	}
+	return int(s8 != end8) - int(s16 != end16);
+}
+
+bool coder::equals(std::string_view u8, std::u16string_view u16) noexcept
+{
+	// a code unit takes 1 to 3 bytes, a pair of them 4
+	if (u8.size() < u16.size() || u8.size() > u16.size() * 3)
+		return false;
+	return compare(u8, u16) == 0;
+}
+
+size_t coder::utf8_decoder::feed(std::string_view chunk, char16_t* out_u16) noexcept
+{
+	return stream::feed_bytes(chunk, out_u16, _pending, _size,
+		[](std::string_view bytes, char16_t* out, bool final) { return decode_utf8(bytes, out, final); });
+}
+
+void coder::utf8_decoder::feed(std::string_view chunk, std::u16string& out_u16)
+{
+	const size_t start = out_u16.size();
+	out_u16.resize(start + utf16_capacity(_size + chunk.size()));
+	out_u16.resize(start + feed(chunk, out_u16.data() + start));
+}
+
+size_t coder::utf8_decoder::finish(char16_t* out_u16) noexcept
+{
+	return stream::finish_bytes(out_u16, _pending, _size,
+		[](std::string_view bytes, char16_t* out, bool final) { return decode_utf8(bytes, out, final); });
+}
+
+void coder::utf8_decoder::finish(std::u16string& out_u16)
+{
+	const size_t start = out_u16.size();
+	out_u16.resize(start + utf16_capacity(_size));
+	out_u16.resize(start + finish(out_u16.data() + start));
+}
+
+size_t coder::utf16_encoder::feed(std::u16string_view chunk, char* out_u8) noexcept
+{
+	return stream::feed_units(chunk, out_u8, _lead,
+		[](std::u16string_view units, char* out, bool final) { return encode_utf8(units, out, final); });
+}
+
+void coder::utf16_encoder::feed(std::u16string_view chunk, std::string& out_u8)
+{
+	const size_t start = out_u8.size();
+	out_u8.resize(start + utf8_capacity(pending() + chunk.size()));
+	out_u8.resize(start + feed(chunk, out_u8.data() + start));
+}
+
+size_t coder::utf16_encoder::finish(char* out_u8) noexcept
+{
+	return stream::finish_units(out_u8, _lead,
+		[](std::u16string_view units, char* out, bool final) { return encode_utf8(units, out, final); });
+}
+
+void coder::utf16_encoder::finish(std::string& out_u8)
+{
+	const size_t start = out_u8.size();
+	out_u8.resize(start + utf8_capacity(pending()));
+	out_u8.resize(start + finish(out_u8.data() + start));
+}
+
 _NS_OSTR_END
 
@@ -0,0 +1,274 @@
+#include "ostring/compact_string.h"
+
+#include <algorithm>
+#include <cstring>
+
+_NS_OSTR_BEGIN
+
+namespace
+{
+	inline char16_t unit_value(char c) noexcept
+	{
+		return char16_t(uint8_t(c));
+	}
+
+	inline char16_t unit_value(char16_t c) noexcept
+	{
+		return c;
+	}
+
+	template<typename A, typename B>
+	int compare_units(std::basic_string_view<A> lhs, std::basic_string_view<B> rhs) noexcept
+	{
+		const size_t n = std::min(lhs.size(), rhs.size());
+		for (size_t i = 0; i < n; ++i)
+		{
+			const char16_t l = unit_value(lhs[i]);
+			const char16_t r = unit_value(rhs[i]);
+			if (l != r) return l < r ? -1 : 1;
+		}
+		if (lhs.size() == rhs.size()) return 0;
+		return lhs.size() < rhs.size() ? -1 : 1;
+	}
+
+	inline int compare_units(std::string_view lhs, std::string_view rhs) noexcept
+	{
+		// char_traits<char> compares as unsigned char
+		const int ans = lhs.compare(rhs);
+		return ans < 0 ? -1 : (ans > 0 ? 1 : 0);
+	}
+
+	inline int compare_units(std::u16string_view lhs, std::u16string_view rhs) noexcept
+	{
+		const int ans = lhs.compare(rhs);
+		return ans < 0 ? -1 : (ans > 0 ? 1 : 0);
+	}
+
+	struct unit_predicate
+	{
+		case_sensitivity cs;
+
+		template<typename A, typename B>
+		bool operator()(A lhs, B rhs) const noexcept
+		{
+			if (cs == case_sensitivity::sensitive)
+				return unit_value(lhs) == unit_value(rhs);
+			return helper::character::char_lowercase(unit_value(lhs)) == helper::character::char_lowercase(unit_value(rhs));
+		}
+	};
+
+	// @return: code unit offset, SIZE_MAX if not found.
+	template<typename A, typename B>
+	size_t search_units(std::basic_string_view<A> str, std::basic_string_view<B> pattern, case_sensitivity cs) noexcept
+	{
+		if constexpr (std::is_same_v<A, B>)
+		{
+			if (cs == case_sensitivity::sensitive)
+			{
+				const size_t pos = str.find(pattern);
+				return pos == std::basic_string_view<A>::npos ? SIZE_MAX : pos;
+			}
+		}
+		auto it = std::search(str.cbegin(), str.cend(), pattern.cbegin(), pattern.cend(), unit_predicate{ cs });
+		if (it == str.cend()) return SIZE_MAX;
+		return it - str.cbegin();
+	}
+
+	template<typename A, typename B>
+	size_t search_units_backward(std::basic_string_view<A> str, std::basic_string_view<B> pattern, case_sensitivity cs) noexcept
+	{
+		if constexpr (std::is_same_v<A, B>)
+		{
+			if (cs == case_sensitivity::sensitive)
+			{
+				const size_t pos = str.rfind(pattern);
+				return pos == std::basic_string_view<A>::npos ? SIZE_MAX : pos;
+			}
+		}
+		auto it = std::search(str.crbegin(), str.crend(), pattern.crbegin(), pattern.crend(), unit_predicate{ cs });
+		if (it == str.crend()) return SIZE_MAX;
+		return str.crend() - it - pattern.size();
+	}
+
+	// a wide pattern with a unit above 0xFF is never in latin-1 text, the case folding is ascii only
+	bool can_match(const compact_string_view& str, const compact_string_view& pattern) noexcept
+	{
+		return !str.is_compact() || pattern.is_compact() || coder::latin1_prefix(pattern.utf16()) == pattern.origin_length();
+	}
+
+	// code unit offset to code points
+	size_t unit_to_codepoint(const compact_string_view& str, size_t index) noexcept
+	{
+		if (index == SIZE_MAX || str.is_compact()) return index;
+		const std::u16string_view units = str.utf16();
+		return index - helper::string::count_surrogate_pair(units.cbegin(), units.cbegin() + index);
+	}
+}
+
+int compact_string_view::compare(const compact_string_view& rhs) const noexcept
+{
+	return visit([&rhs](auto lhs_units) {
+		return rhs.visit([lhs_units](auto rhs_units) {
+			return compare_units(lhs_units, rhs_units);
+		});
+	});
+}
+
+bool compact_string_view::operator==(const compact_string_view& rhs) const noexcept
+{
+	if (_size != rhs._size) return false;
+	if (_wide == rhs._wide)
+		return std::memcmp(_data, rhs._data, _wide ? _size * sizeof(char16_t) : _size) == 0;
+	return compare(rhs) == 0;
+}
+
+compact_string_view compact_string_view::substring(size_t offset, size_t count) const noexcept
+{
+	if (_wide)
+		return string_view(utf16()).substring(offset, count).raw();
+	const std::string_view units = latin1();
+	return units.substr(std::min(offset, units.size()), count);
+}
+
+size_t compact_string_view::index_of(const compact_string_view& pattern, case_sensitivity cs) const noexcept
+{
+	if (!can_match(*this, pattern)) return SIZE_MAX;
+	const size_t index_found = visit([&pattern, cs](auto units) {
+		return pattern.visit([units, cs](auto pattern_units) {
+			return search_units(units, pattern_units, cs);
+		});
+	});
+	return unit_to_codepoint(*this, index_found);
+}
+
+size_t compact_string_view::last_index_of(const compact_string_view& pattern, case_sensitivity cs) const noexcept
+{
+	if (!can_match(*this, pattern)) return SIZE_MAX;
+	const size_t index_found = visit([&pattern, cs](auto units) {
+		return pattern.visit([units, cs](auto pattern_units) {
+			return search_units_backward(units, pattern_units, cs);
+		});
+	});
+	return unit_to_codepoint(*this, index_found);
+}
+
+string compact_string_view::to_string() const
+{
+	if (_wide)
+		return string(utf16());
+	return string(latin1());
+}
+
+bool compact_string_view::encode_to_utf8(std::string& u8) const
+{
+	if (_wide)
+		return coder::convert_append(utf16(), u8);
+
+	// ascii as is, the rest of latin-1 as two bytes
+	const std::string_view units = latin1();
+	const size_t high = size_t(std::count_if(units.cbegin(), units.cend(), [](char c) { return uint8_t(c) >= 0x80; }));
+	if (high == 0)
+	{
+		u8.append(units);
+		return true;
+	}
+	u8.reserve(u8.size() + units.size() + high);
+	for (const char c : units)
+	{
+		const uint8_t b = uint8_t(c);
+		if (b < 0x80)
+		{
+			u8.push_back(c);
+			continue;
+		}
+		u8.push_back(char(0xC0 | (b >> 6)));
+		u8.push_back(char(0x80 | (b & 0x3F)));
+	}
+	return true;
+}
+
+compact_string& compact_string::assign(const compact_string_view& sv)
+{
+	// built aside first, sv may view this string
+	std::string latin1;
+	std::u16string utf16;
+	const bool wide = !sv.is_compact() && coder::latin1_prefix(sv.utf16()) != sv.origin_length();
+	if (sv.is_compact())
+	{
+		latin1.assign(sv.latin1());
+	}
+	else if (!wide)
+	{
+		latin1.resize(sv.origin_length());
+		coder::narrow_latin1(sv.utf16(), latin1.data());
+	}
+	else
+	{
+		utf16.assign(sv.utf16());
+	}
+	_latin1 = std::move(latin1);
+	_utf16 = std::move(utf16);
+	_wide = wide;
+	return *this;
+}
+
+compact_string& compact_string::append(const compact_string_view& rhs)
+{
+	if (rhs.is_compact())
+	{
+		const std::string_view units = rhs.latin1();
+		if (!_wide)
+		{
+			_latin1.append(units);
+			return *this;
+		}
+		const size_t start = _utf16.size();
+		_utf16.resize(start + units.size());
+		coder::widen_latin1(units, _utf16.data() + start);
+		return *this;
+	}
+
+	const std::u16string_view units = rhs.utf16();
+	if (!_wide)
+	{
+		if (coder::latin1_prefix(units) == units.size())
+		{
+			const size_t start = _latin1.size();
+			_latin1.resize(start + units.size());
+			coder::narrow_latin1(units, _latin1.data() + start);
+			return *this;
+		}
+		widen();
+	}
+	_utf16.append(units);
+	return *this;
+}
+
+size_t compact_string::index_of(const compact_string_view& substr, size_t from, size_t length, case_sensitivity cs) const
+{
+	size_t ind = to_sv()
+		.substring(from, length)
+		.index_of(substr, cs);
+	if (ind == SIZE_MAX) return SIZE_MAX;
+	return ind + from;
+}
+
+size_t compact_string::last_index_of(const compact_string_view& substr, size_t from, size_t length, case_sensitivity cs) const
+{
+	size_t ind = to_sv()
+		.substring(from, length)
+		.last_index_of(substr, cs);
+	if (ind == SIZE_MAX) return SIZE_MAX;
+	return ind + from;
+}
+
+void compact_string::widen()
+{
+	_utf16.resize(_latin1.size());
+	coder::widen_latin1(_latin1, _utf16.data());
+	_latin1.clear();
+	_latin1.shrink_to_fit();
+	_wide = true;
+}
+
+_NS_OSTR_END
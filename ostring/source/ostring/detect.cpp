@@ -0,0 +1,174 @@
+#include "ostring/detect.h"
+#include "ostring/coder.h"
+#include "ostring/helpers.h"
+#include <algorithm>
+
+_NS_OSTR_BEGIN
+
+namespace
+{
+	struct byte_stats
+	{
+		size_t zero_even = 0;
+		size_t zero_odd = 0;
+		size_t high = 0;
+	};
+
+	byte_stats count_bytes(std::string_view bytes) noexcept
+	{
+		const uint8_t* src = reinterpret_cast<const uint8_t*>(bytes.data());
+		const uint8_t* const end = src + bytes.size();
+		byte_stats stats;
+#if OSTR_SSE2
+		// byte counters in lanes, summed before any can wrap
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i even = _mm_set1_epi16(0x00FF);
+		while (end - src >= 16)
+		{
+			__m128i zero_even = zero;
+			__m128i zero_odd = zero;
+			__m128i high = zero;
+			for (int block = 0; block < 255 && end - src >= 16; ++block, src += 16)
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				const __m128i zeros = _mm_cmpeq_epi8(v, zero);
+				zero_even = _mm_sub_epi8(zero_even, _mm_and_si128(zeros, even));
+				zero_odd = _mm_sub_epi8(zero_odd, _mm_andnot_si128(even, zeros));
+				high = _mm_sub_epi8(high, _mm_cmplt_epi8(v, zero));
+			}
+			auto sum = [&](__m128i counts) {
+				const __m128i sums = _mm_sad_epu8(counts, zero);
+				return size_t(_mm_cvtsi128_si32(sums)) + size_t(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)));
+			};
+			stats.zero_even += sum(zero_even);
+			stats.zero_odd += sum(zero_odd);
+			stats.high += sum(high);
+		}
+#endif
+		// blocks are 16 bytes, the parity of the offset is kept
+		const uint8_t* const first = reinterpret_cast<const uint8_t*>(bytes.data());
+		for (; src != end; ++src)
+		{
+			if (*src == 0)
+				((src - first) % 2 == 0 ? stats.zero_even : stats.zero_odd) += 1;
+			stats.high += *src >= 0x80;
+		}
+		return stats;
+	}
+
+	// the sample without a utf-8 sequence cut by its end
+	std::string_view trim_utf8_tail(std::string_view sample) noexcept
+	{
+		for (size_t back = 1; back <= 4 && back <= sample.size(); ++back)
+		{
+			const uint8_t c = static_cast<uint8_t>(sample[sample.size() - back]);
+			if ((c & 0xC0) == 0x80)
+				continue;
+			uint8_t mask;
+			const size_t length = helper::codepoint::utf8_sequence_length(c, mask);
+			return length > back ? sample.substr(0, sample.size() - back) : sample;
+		}
+		return sample;
+	}
+
+	struct gb18030_score
+	{
+		size_t valid = 0;
+		size_t invalid = 0;
+		// two byte codes in the hanzi area of gb2312
+		size_t common = 0;
+	};
+
+	// a sequence cut by the end of the sample counts neither way
+	gb18030_score score_gb18030(std::string_view sample) noexcept
+	{
+		const uint8_t* const p = reinterpret_cast<const uint8_t*>(sample.data());
+		const size_t n = sample.size();
+		gb18030_score score;
+		size_t i = 0;
+		while (i < n)
+		{
+			const uint8_t b0 = p[i];
+			if (b0 < 0x80)
+			{
+				++i;
+				continue;
+			}
+			if (b0 == 0x80 || b0 == 0xFF)
+			{
+				++score.invalid;
+				++i;
+				continue;
+			}
+			if (i + 1 == n)
+				break;
+			const uint8_t b1 = p[i + 1];
+			if (b1 >= 0x40 && b1 <= 0xFE && b1 != 0x7F)
+			{
+				++score.valid;
+				score.common += b0 >= 0xB0 && b0 <= 0xF7 && b1 >= 0xA1;
+				i += 2;
+			}
+			else if (b1 >= 0x30 && b1 <= 0x39)
+			{
+				if (i + 3 >= n)
+					break;
+				const bool four = p[i + 2] >= 0x81 && p[i + 2] <= 0xFE && p[i + 3] >= 0x30 && p[i + 3] <= 0x39;
+				++(four ? score.valid : score.invalid);
+				i += four ? 4 : 1;
+			}
+			else
+			{
+				++score.invalid;
+				++i;
+			}
+		}
+		return score;
+	}
+}
+
+coder::detection coder::detect(std::string_view bytes, size_t sample) noexcept
+{
+	const uint8_t* const head = reinterpret_cast<const uint8_t*>(bytes.data());
+	if (bytes.size() >= 3 && head[0] == 0xEF && head[1] == 0xBB && head[2] == 0xBF)
+		return { encoding::utf8, 3, 100 };
+	if (bytes.size() >= 2 && head[0] == 0xFF && head[1] == 0xFE)
+		return { encoding::utf16le, 2, 100 };
+	if (bytes.size() >= 2 && head[0] == 0xFE && head[1] == 0xFF)
+		return { encoding::utf16be, 2, 100 };
+
+	const bool cut = bytes.size() > sample;
+	const std::string_view part = cut ? bytes.substr(0, sample) : bytes;
+	if (part.empty())
+		return {};
+	const byte_stats stats = count_bytes(part);
+
+	// ascii in utf-16 has a zero in every high byte, cjk in few of them
+	const size_t units = part.size() / 2;
+	const size_t zero_max = std::max(stats.zero_even, stats.zero_odd);
+	const size_t zero_min = std::min(stats.zero_even, stats.zero_odd);
+	if (units != 0 && zero_max * 8 >= units && zero_max > zero_min * 4)
+	{
+		const uint8_t confidence = static_cast<uint8_t>(100 * (zero_max - zero_min) / zero_max);
+		return { stats.zero_odd > stats.zero_even ? encoding::utf16le : encoding::utf16be, 0, confidence };
+	}
+	// zeros without the pattern of utf-16 are binary
+	if (zero_max != 0)
+		return {};
+
+	if (stats.high == 0)
+		return { encoding::utf8, 0, 100 };
+	if (is_valid_utf8(cut ? trim_utf8_tail(part) : part))
+		return { encoding::utf8, 0, 100 };
+
+	const gb18030_score score = score_gb18030(part);
+	if (score.valid != 0 && score.invalid * 20 <= score.valid)
+	{
+		// well formed text is likely gb18030, common hanzi make it more so
+		const size_t well_formed = score.valid * 50 / (score.valid + score.invalid);
+		return { encoding::gb18030, 0, static_cast<uint8_t>(well_formed + 50 * score.common / score.valid) };
+	}
+	return {};
+}
+
+_NS_OSTR_END
@@ -1,13 +1,388 @@
-
-// UNUSED!
-
 #include "ostring/definitions.h"
 #include "ostring/format.h"
+#include "ostring/chrono.h"
+
+#include <ctime>
 
 _NS_OSTR_BEGIN
 
+namespace
+{
+	constexpr std::u16string_view default_time_spec = u"%Y-%m-%d %H:%M:%S";
+
+	constexpr std::u16string_view weekday_names[] =
+	{
+		u"Sunday", u"Monday", u"Tuesday", u"Wednesday", u"Thursday", u"Friday", u"Saturday"
+	};
+
+	constexpr std::u16string_view month_names[] =
+	{
+		u"January", u"February", u"March", u"April", u"May", u"June",
+		u"July", u"August", u"September", u"October", u"November", u"December"
+	};
+
+	struct civil_time
+	{
+		int64_t year;
+		int month;		// 1 - 12
+		int day;		// 1 - 31
+		int hour;
+		int minute;
+		int second;
+		int weekday;	// 0 - 6, since Sunday
+		int yearday;	// 0 - 365
+		int64_t offset;	// seconds east of utc
+	};
+
+	int64_t floor_div(int64_t a, int64_t b)
+	{
+		return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+	}
+
+	// days since 1970-01-01 @ http://howardhinnant.github.io/date_algorithms.html
+	int64_t days_from_civil(int64_t y, int m, int d)
+	{
+		y -= m <= 2;
+		const int64_t era = floor_div(y, 400);
+		const int64_t yoe = y - era * 400;
+		const int64_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+		const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+		return era * 146097 + doe - 719468;
+	}
+
+	void civil_from_days(int64_t z, civil_time& t)
+	{
+		z += 719468;
+		const int64_t era = floor_div(z, 146097);
+		const int64_t doe = z - era * 146097;
+		const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+		const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+		const int64_t mp = (5 * doy + 2) / 153;
+		t.day = int(doy - (153 * mp + 2) / 5 + 1);
+		t.month = int(mp < 10 ? mp + 3 : mp - 9);
+		t.year = yoe + era * 400 + (t.month <= 2);
+	}
+
+	void to_civil(int64_t seconds, bool utc, civil_time& t)
+	{
+		t.offset = 0;
+		if (!utc)
+		{
+			const std::time_t time = std::time_t(seconds);
+			std::tm local{};
+#if defined(_WIN32)
+			const bool ok = localtime_s(&local, &time) == 0;
+#else
+			const bool ok = localtime_r(&time, &local) != nullptr;
+#endif
+			if (ok)
+			{
+				t.year = int64_t(local.tm_year) + 1900;
+				t.month = local.tm_mon + 1;
+				t.day = local.tm_mday;
+				t.hour = local.tm_hour;
+				t.minute = local.tm_min;
+				t.second = local.tm_sec;
+				t.weekday = local.tm_wday;
+				t.yearday = local.tm_yday;
+				t.offset = (days_from_civil(t.year, t.month, t.day) * 86400 + t.hour * 3600 + t.minute * 60 + t.second) - seconds;
+				return;
+			}
+		}
+
+		const int64_t days = floor_div(seconds, 86400);
+		const int64_t rest = seconds - days * 86400;
+		civil_from_days(days, t);
+		t.hour = int(rest / 3600);
+		t.minute = int(rest / 60 % 60);
+		t.second = int(rest % 60);
+		t.weekday = int(floor_div(days + 4, 7) * -7 + days + 4);
+		t.yearday = int(days - days_from_civil(t.year, 1, 1));
+	}
+
+	void append_digits(uint64_t value, int width, std::u16string& out)
+	{
+		const size_t start = out.size();
+		helper::string::append_int(value, out);
+		const size_t written = out.size() - start;
+		if (written < size_t(width))
+			out.insert(start, width - written, u'0');
+	}
+
+	// overwrite exactly width digits at p, dropping the higher ones
+	void write_digits(char16_t* p, uint64_t value, int width)
+	{
+		for (int i = width - 1; i >= 0; --i)
+		{
+			p[i] = char16_t(u'0' + value % 10);
+			value /= 10;
+		}
+	}
+
+	uint64_t truncate_fraction(uint32_t nanoseconds, int width)
+	{
+		for (int i = width; i < 9; ++i)
+			nanoseconds /= 10;
+		return nanoseconds;
+	}
+
+	// %3f, %f
+	// @return: width of the fraction, -1 when spec[i] does not start a fraction
+	int parse_fraction(std::u16string_view spec, size_t& i, int fraction_digits)
+	{
+		if (spec[i] == u'f')
+			return fraction_digits;
+		if (spec[i] >= u'1' && spec[i] <= u'9' && i + 1 < spec.size() && spec[i + 1] == u'f')
+		{
+			++i;
+			return spec[i - 1] - u'0';
+		}
+		return -1;
+	}
+
+	enum class patch_kind : uint8_t
+	{
+		second,
+		fraction
+	};
+
+	struct patch
+	{
+		uint32_t offset;
+		uint8_t width;
+		patch_kind kind;
+	};
+
+	struct render_state
+	{
+		const civil_time& time;
+		uint32_t nanoseconds;
+		int fraction_digits;
+		size_t base;
+		std::vector<patch>* patches;
+	};
+
+	void add_patch(render_state& s, size_t offset, int width, patch_kind kind)
+	{
+		if (s.patches && width > 0)
+			s.patches->push_back({ uint32_t(offset - s.base), uint8_t(width), kind });
+	}
+
+	void render_time(std::u16string_view spec, render_state& s, std::u16string& out)
+	{
+		const civil_time& t = s.time;
+		for (size_t i = 0; i < spec.size(); ++i)
+		{
+			const char16_t c = spec[i];
+			if (c != u'%' || i + 1 == spec.size())
+			{
+				out.push_back(c);
+				continue;
+			}
+
+			++i;
+			const int fraction = parse_fraction(spec, i, s.fraction_digits);
+			if (fraction >= 0)
+			{
+				add_patch(s, out.size(), fraction, patch_kind::fraction);
+				if (fraction > 0)
+					append_digits(truncate_fraction(s.nanoseconds, fraction), fraction, out);
+				continue;
+			}
+
+			switch (spec[i])
+			{
+			case u'Y': append_digits(t.year < 0 ? 0 : uint64_t(t.year), 4, out); break;
+			case u'y': append_digits(uint64_t((t.year % 100 + 100) % 100), 2, out); break;
+			case u'C': append_digits(uint64_t(floor_div(t.year, 100) < 0 ? 0 : floor_div(t.year, 100)), 2, out); break;
+			case u'm': append_digits(t.month, 2, out); break;
+			case u'd': append_digits(t.day, 2, out); break;
+			case u'e':
+				if (t.day < 10)
+					out.push_back(u' ');
+				append_digits(t.day, 1, out);
+				break;
+			case u'j': append_digits(t.yearday + 1, 3, out); break;
+			case u'H': append_digits(t.hour, 2, out); break;
+			case u'I': append_digits(t.hour % 12 == 0 ? 12 : t.hour % 12, 2, out); break;
+			case u'M': append_digits(t.minute, 2, out); break;
+			case u'S':
+				add_patch(s, out.size(), 2, patch_kind::second);
+				append_digits(t.second, 2, out);
+				break;
+			case u'p': out.append(t.hour < 12 ? u"AM" : u"PM"); break;
+			case u'a': out.append(weekday_names[t.weekday].substr(0, 3)); break;
+			case u'A': out.append(weekday_names[t.weekday]); break;
+			case u'b':
+			case u'h': out.append(month_names[t.month - 1].substr(0, 3)); break;
+			case u'B': out.append(month_names[t.month - 1]); break;
+			case u'u': append_digits(t.weekday == 0 ? 7 : t.weekday, 1, out); break;
+			case u'w': append_digits(t.weekday, 1, out); break;
+			case u'z':
+			{
+				const int64_t minutes = (t.offset < 0 ? -t.offset : t.offset) / 60;
+				out.push_back(t.offset < 0 ? u'-' : u'+');
+				append_digits(uint64_t(minutes / 60), 2, out);
+				append_digits(uint64_t(minutes % 60), 2, out);
+				break;
+			}
+			case u'F': render_time(u"%Y-%m-%d", s, out); break;
+			case u'T': render_time(u"%H:%M:%S", s, out); break;
+			case u'R': render_time(u"%H:%M", s, out); break;
+			case u'D': render_time(u"%m/%d/%y", s, out); break;
+			case u'r': render_time(u"%I:%M:%S %p", s, out); break;
+			case u'c': render_time(u"%a %b %e %H:%M:%S %Y", s, out); break;
+			case u'n': out.push_back(u'\n'); break;
+			case u't': out.push_back(u'\t'); break;
+			case u'%': out.push_back(u'%'); break;
+			default:
+				out.push_back(u'%');
+				out.push_back(spec[i]);
+				break;
+			}
+		}
+	}
+
+	// the rendering of a spec in one minute, seconds and fractions are patched in place on hit
+	struct time_cache_entry
+	{
+		std::u16string spec;
+		int64_t minute = 0;
+		int fraction_digits = 0;
+		bool utc = false;
+		bool valid = false;
+		std::u16string rendered;
+		std::vector<patch> patches;
+	};
+
+	constexpr size_t time_cache_size = 4;
+
+	struct time_cache
+	{
+		time_cache_entry entries[time_cache_size];
+		size_t next = 0;
+	};
+}
+
 namespace ofmt {
 
+	void format_time_point(int64_t nanoseconds, int fraction_digits, bool utc, std::u16string_view spec, std::u16string& out)
+	{
+		if (!spec.empty() && spec[0] == u':')
+			spec.remove_prefix(1);
+		if (spec.empty())
+			spec = default_time_spec;
+
+		const int64_t seconds = floor_div(nanoseconds, 1000000000);
+		const uint32_t sub_seconds = uint32_t(nanoseconds - seconds * 1000000000);
+		const int64_t minute = floor_div(seconds, 60);
+		const int second = int(seconds - minute * 60);
+
+		static thread_local time_cache cache;
+		for (time_cache_entry& entry : cache.entries)
+		{
+			if (!entry.valid || entry.minute != minute || entry.utc != utc || entry.fraction_digits != fraction_digits || entry.spec != spec)
+				continue;
+
+			const size_t base = out.size();
+			out.append(entry.rendered);
+			char16_t* p = out.data() + base;
+			for (const patch& pt : entry.patches)
+			{
+				if (pt.kind == patch_kind::second)
+					write_digits(p + pt.offset, second, pt.width);
+				else
+					write_digits(p + pt.offset, truncate_fraction(sub_seconds, pt.width), pt.width);
+			}
+			return;
+		}
+
+		civil_time t;
+		to_civil(seconds, utc, t);
+
+		// zones with an offset of seconds or a leap second do not map minutes to minutes
+		const bool cacheable = t.second == second;
+		time_cache_entry& entry = cache.entries[cache.next];
+		std::vector<patch> patches;
+
+		render_state s{ t, sub_seconds, fraction_digits, out.size(), cacheable ? &patches : nullptr };
+		render_time(spec, s, out);
+
+		if (cacheable)
+		{
+			cache.next = (cache.next + 1) % time_cache_size;
+			entry.spec.assign(spec);
+			entry.minute = minute;
+			entry.fraction_digits = fraction_digits;
+			entry.utc = utc;
+			entry.rendered.assign(out, s.base, std::u16string::npos);
+			entry.patches = std::move(patches);
+			entry.valid = true;
+		}
+	}
+
+	void format_duration(int64_t nanoseconds, int fraction_digits, std::u16string_view count, std::u16string_view unit, std::u16string_view spec, std::u16string& out)
+	{
+		if (!spec.empty() && spec[0] == u':')
+			spec.remove_prefix(1);
+		if (spec.empty())
+		{
+			out.append(count);
+			out.append(unit);
+			return;
+		}
+
+		const bool negative = nanoseconds < 0;
+		const uint64_t total = negative ? 0 - uint64_t(nanoseconds) : uint64_t(nanoseconds);
+		const uint64_t seconds = total / 1000000000;
+		const uint32_t sub_seconds = uint32_t(total % 1000000000);
+		bool signed_out = !negative;
+
+		auto sign = [&]()
+		{
+			if (!signed_out)
+			{
+				out.push_back(u'-');
+				signed_out = true;
+			}
+		};
+
+		for (size_t i = 0; i < spec.size(); ++i)
+		{
+			const char16_t c = spec[i];
+			if (c != u'%' || i + 1 == spec.size())
+			{
+				out.push_back(c);
+				continue;
+			}
+
+			++i;
+			const int fraction = parse_fraction(spec, i, fraction_digits);
+			if (fraction >= 0)
+			{
+				sign();
+				if (fraction > 0)
+					append_digits(truncate_fraction(sub_seconds, fraction), fraction, out);
+				continue;
+			}
+
+			switch (spec[i])
+			{
+			case u'H': sign(); append_digits(seconds / 3600, 2, out); break;
+			case u'M': sign(); append_digits(seconds / 60 % 60, 2, out); break;
+			case u'S': sign(); append_digits(seconds % 60, 2, out); break;
+			case u'Q': out.append(count); break;
+			case u'q': out.append(unit); break;
+			case u'n': out.push_back(u'\n'); break;
+			case u't': out.push_back(u'\t'); break;
+			case u'%': out.push_back(u'%'); break;
+			default:
+				out.push_back(u'%');
+				out.push_back(spec[i]);
+				break;
+			}
+		}
+	}
 }
 
 _NS_OSTR_END
@@ -0,0 +1,334 @@
+#include "ostring/gb18030.h"
+#include "ostring/helpers.h"
+#include "gb18030_table.h"
+#include "stream_coder.h"
+#include <algorithm>
+#include <cstring>
+
+_NS_OSTR_BEGIN
+
+namespace
+{
+	// linear index of a four byte code, b0 b1 b2 b3 as 0x81-0xfe 0x30-0x39 0x81-0xfe 0x30-0x39
+	constexpr uint32_t four_byte_bmp_count = 39420;
+	constexpr uint32_t four_byte_supplementary_min = 189000;
+	constexpr uint32_t four_byte_supplementary_max = four_byte_supplementary_min + 0xFFFFF;
+
+	inline bool is_lead(uint8_t b) noexcept
+	{
+		return b >= gb18030_table::lead_min && b <= gb18030_table::lead_max;
+	}
+
+	inline bool is_digit(uint8_t b) noexcept
+	{
+		return b >= 0x30 && b <= 0x39;
+	}
+
+	// code point of a four byte code, U+FFFD when unassigned
+	char32_t decode_four_byte(uint32_t linear) noexcept
+	{
+		using namespace gb18030_table;
+
+		if (linear < four_byte_bmp_count)
+		{
+			const uint16_t* const run = std::upper_bound(std::begin(four_byte_linear), std::end(four_byte_linear), linear) - 1;
+			const size_t index = size_t(run - four_byte_linear);
+			return four_byte_codepoint[index] + (linear - four_byte_linear[index]);
+		}
+		if (linear >= four_byte_supplementary_min && linear <= four_byte_supplementary_max)
+			return helper::codepoint::SUPPLEMENTARY_DELTA + (linear - four_byte_supplementary_min);
+		return 0xFFFD;
+	}
+
+	// linear index of a code point without a two byte code
+	uint32_t encode_four_byte(char32_t cp) noexcept
+	{
+		using namespace gb18030_table;
+
+		if (cp > helper::codepoint::FIRST_PLANE_MAX)
+			return four_byte_supplementary_min + (cp - helper::codepoint::SUPPLEMENTARY_DELTA);
+		const char16_t* const run = std::upper_bound(std::begin(four_byte_codepoint), std::end(four_byte_codepoint), char16_t(cp)) - 1;
+		const size_t index = size_t(run - four_byte_codepoint);
+		return four_byte_linear[index] + (cp - four_byte_codepoint[index]);
+	}
+
+	// the two byte table inverted, built on first use
+	struct encode_table
+	{
+		// lead << 8 | trail for each code point of the first plane, 0 for one encoded in four bytes
+		uint16_t codes[0x10000] = {};
+
+		encode_table() noexcept
+		{
+			using namespace gb18030_table;
+
+			for (size_t i = 0; i < std::size(two_byte); ++i)
+			{
+				const size_t trail_index = i % trail_count;
+				const uint32_t lead = lead_min + uint32_t(i / trail_count);
+				const uint32_t trail = uint32_t(trail_index + (trail_index < 0x3F ? 0x40 : 0x41));
+				codes[two_byte[i]] = static_cast<uint16_t>((lead << 8) | trail);
+			}
+		}
+
+		static const encode_table& get() noexcept
+		{
+			static const encode_table table;
+			return table;
+		}
+	};
+}
+
+coder::transcode_result coder::decode_gb18030(std::string_view gb, char16_t* out_u16, bool final, error_policy policy) noexcept
+{
+	using namespace helper::codepoint;
+
+	const uint8_t* const begin = reinterpret_cast<const uint8_t*>(gb.data());
+	const uint8_t* const end = begin + gb.size();
+	const uint8_t* src = begin;
+	char16_t* dst = out_u16;
+	bool ill_formed = false;
+
+	while (src != end)
+	{
+#if OSTR_SSE2
+		// 16 ascii bytes widened at once
+		if (end - src >= 16)
+		{
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			if (_mm_movemask_epi8(bytes) == 0)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi8(bytes, zero));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), _mm_unpackhi_epi8(bytes, zero));
+				src += 16;
+				dst += 16;
+				continue;
+			}
+		}
+#endif
+		const uint8_t b0 = *src;
+		if (b0 < 0x80)
+		{
+			*dst++ = b0;
+			++src;
+			continue;
+		}
+
+		// an invalid byte is replaced alone, the next one starts over
+		const size_t left = size_t(end - src);
+		size_t length = 1;
+		char32_t value = 0xFFFD;
+		bool valid = false;
+		bool incomplete = false;
+		if (is_lead(b0))
+		{
+			if (left < 2)
+			{
+				incomplete = true;
+			}
+			else if (src[1] >= 0x40 && src[1] <= 0xFE && src[1] != 0x7F)
+			{
+				const size_t trail_index = src[1] - (src[1] < 0x7F ? 0x40 : 0x41);
+				value = gb18030_table::two_byte[(b0 - gb18030_table::lead_min) * gb18030_table::trail_count + trail_index];
+				valid = true;
+				length = 2;
+			}
+			else if (is_digit(src[1]))
+			{
+				if (left < 3 || (is_lead(src[2]) && left < 4))
+				{
+					incomplete = true;
+				}
+				else if (is_lead(src[2]) && is_digit(src[3]))
+				{
+					const uint32_t linear = (uint32_t(b0 - 0x81) * 10 + (src[1] - 0x30)) * 1260 + uint32_t(src[2] - 0x81) * 10 + (src[3] - 0x30);
+					value = decode_four_byte(linear);
+					valid = value != 0xFFFD || linear < four_byte_bmp_count;
+					length = 4;
+				}
+			}
+		}
+
+		if (incomplete && !final)
+			break;
+		if (!valid)
+		{
+			ill_formed = true;
+			if (policy == error_policy::strict)
+				break;
+		}
+
+		if (value > FIRST_PLANE_MAX)
+		{
+			*dst++ = static_cast<char16_t>(((value - SUPPLEMENTARY_DELTA) >> SURROGATE_LEAD_OFFSET) + LEAD_SURROGATE_MIN);
+			*dst++ = static_cast<char16_t>(((value - SUPPLEMENTARY_DELTA) & SURROGATE_MASK) + TRAIL_SURROGATE_MIN);
+		}
+		else
+		{
+			*dst++ = static_cast<char16_t>(value);
+		}
+		src += length;
+	}
+	return { size_t(src - begin), size_t(dst - out_u16), ill_formed };
+}
+
+coder::transcode_result coder::encode_gb18030(std::u16string_view sv16, char* out_gb, bool final, error_policy policy) noexcept
+{
+	using namespace helper::codepoint;
+
+	const encode_table& table = encode_table::get();
+	const char16_t* const begin = sv16.data();
+	const char16_t* const end = begin + sv16.size();
+	const char16_t* src = begin;
+	char* dst = out_gb;
+	bool ill_formed = false;
+
+	while (src != end)
+	{
+#if OSTR_SSE2
+		// 8 ascii code units narrowed at once
+		if (end - src >= 8)
+		{
+			const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			const __m128i high = _mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xFF80)));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) == 0xFFFF)
+			{
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(units, units));
+				src += 8;
+				dst += 8;
+				continue;
+			}
+		}
+#endif
+		const char16_t c = *src;
+		if (c < 0x80)
+		{
+			*dst++ = static_cast<char>(c);
+			++src;
+			continue;
+		}
+
+		size_t length = 1;
+		char32_t value = c;
+		bool valid = true;
+		if (is_lead_surrogate(c))
+		{
+			if (src + 1 != end && is_trail_surrogate(src[1]))
+			{
+				value = (char32_t(c - LEAD_SURROGATE_MIN) << SURROGATE_LEAD_OFFSET) + (src[1] - TRAIL_SURROGATE_MIN) + SUPPLEMENTARY_DELTA;
+				length = 2;
+			}
+			else if (src + 1 == end && !final)
+			{
+				break;
+			}
+			else
+			{
+				valid = false;
+			}
+		}
+		else if (is_trail_surrogate(c))
+		{
+			valid = false;
+		}
+
+		if (!valid)
+		{
+			ill_formed = true;
+			if (policy == error_policy::strict)
+				break;
+			value = 0xFFFD;
+		}
+
+		const uint16_t code = value <= FIRST_PLANE_MAX ? table.codes[value] : 0;
+		if (code)
+		{
+			*dst++ = static_cast<char>(code >> 8);
+			*dst++ = static_cast<char>(code & 0xFF);
+		}
+		else
+		{
+			uint32_t linear = encode_four_byte(value);
+			dst[3] = static_cast<char>(0x30 + linear % 10);
+			linear /= 10;
+			dst[2] = static_cast<char>(0x81 + linear % 126);
+			linear /= 126;
+			dst[1] = static_cast<char>(0x30 + linear % 10);
+			dst[0] = static_cast<char>(0x81 + linear / 10);
+			dst += 4;
+		}
+		src += length;
+	}
+	return { size_t(src - begin), size_t(dst - out_gb), ill_formed };
+}
+
+bool coder::convert_append_gb18030(std::string_view gb, std::u16string& out_u16)
+{
+	const size_t start = out_u16.size();
+	out_u16.resize(start + utf16_capacity(gb.size()));
+	out_u16.resize(start + decode_gb18030(gb, out_u16.data() + start).written);
+	return true;
+}
+
+bool coder::convert_append_gb18030(std::u16string_view sv16, std::string& out_gb)
+{
+	const size_t start = out_gb.size();
+	out_gb.resize(start + gb18030_capacity(sv16.size()));
+	out_gb.resize(start + encode_gb18030(sv16, out_gb.data() + start).written);
+	return true;
+}
+
+size_t coder::gb18030_decoder::feed(std::string_view chunk, char16_t* out_u16) noexcept
+{
+	return stream::feed_bytes(chunk, out_u16, _pending, _size,
+		[](std::string_view bytes, char16_t* out, bool final) { return decode_gb18030(bytes, out, final); });
+}
+
+void coder::gb18030_decoder::feed(std::string_view chunk, std::u16string& out_u16)
+{
+	const size_t start = out_u16.size();
+	out_u16.resize(start + utf16_capacity(_size + chunk.size()));
+	out_u16.resize(start + feed(chunk, out_u16.data() + start));
+}
+
+size_t coder::gb18030_decoder::finish(char16_t* out_u16) noexcept
+{
+	return stream::finish_bytes(out_u16, _pending, _size,
+		[](std::string_view bytes, char16_t* out, bool final) { return decode_gb18030(bytes, out, final); });
+}
+
+void coder::gb18030_decoder::finish(std::u16string& out_u16)
+{
+	const size_t start = out_u16.size();
+	out_u16.resize(start + utf16_capacity(_size));
+	out_u16.resize(start + finish(out_u16.data() + start));
+}
+
+size_t coder::gb18030_encoder::feed(std::u16string_view chunk, char* out_gb) noexcept
+{
+	return stream::feed_units(chunk, out_gb, _lead,
+		[](std::u16string_view units, char* out, bool final) { return encode_gb18030(units, out, final); });
+}
+
+void coder::gb18030_encoder::feed(std::u16string_view chunk, std::string& out_gb)
+{
+	const size_t start = out_gb.size();
+	out_gb.resize(start + gb18030_capacity(pending() + chunk.size()));
+	out_gb.resize(start + feed(chunk, out_gb.data() + start));
+}
+
+size_t coder::gb18030_encoder::finish(char* out_gb) noexcept
+{
+	return stream::finish_units(out_gb, _lead,
+		[](std::u16string_view units, char* out, bool final) { return encode_gb18030(units, out, final); });
+}
+
+void coder::gb18030_encoder::finish(std::string& out_gb)
+{
+	const size_t start = out_gb.size();
+	out_gb.resize(start + gb18030_capacity(pending()));
+	out_gb.resize(start + finish(out_gb.data() + start));
+}
+
+_NS_OSTR_END
@@ -0,0 +1,95 @@
+# Generates gb18030_table.h from the gb18030 codec of python 3.
+# python3 gb18030_table.py > gb18030_table.h
+
+LEAD_MIN = 0x81
+LEAD_MAX = 0xfe
+# four byte codes of the first plane, 0x81308130 to 0x8431a439
+FOUR_BYTE_BMP_COUNT = 39420
+
+
+def two_byte_table():
+    table = []
+    for lead in range(LEAD_MIN, LEAD_MAX + 1):
+        for trail in range(0x40, 0xff):
+            if trail == 0x7f:
+                continue
+            table.append(ord(bytes([lead, trail]).decode("gb18030")))
+    return table
+
+
+def four_byte_code(linear):
+    b3 = 0x30 + linear % 10
+    linear //= 10
+    b2 = 0x81 + linear % 126
+    linear //= 126
+    b1 = 0x30 + linear % 10
+    b0 = 0x81 + linear // 10
+    return bytes([b0, b1, b2, b3])
+
+
+def four_byte_runs():
+    # linear index and code point where each run of consecutive code points starts
+    linear = []
+    codepoint = []
+    previous = None
+    for i in range(FOUR_BYTE_BMP_COUNT):
+        cp = ord(four_byte_code(i).decode("gb18030"))
+        if previous is None or cp != previous + 1:
+            linear.append(i)
+            codepoint.append(cp)
+        previous = cp
+    assert previous == 0xffff
+    return linear, codepoint
+
+
+def rows(values, per_row, form):
+    lines = []
+    for i in range(0, len(values), per_row):
+        lines.append("\t\t" + " ".join(form(v) + "," for v in values[i:i + per_row]))
+    return "\n".join(lines)
+
+
+def main():
+    two_byte = two_byte_table()
+    linear, codepoint = four_byte_runs()
+    print(f"""#pragma once
+// Generated by gb18030_table.py from the gb18030 codec of python 3, do not edit.
+// for lead in 0x81..0xfe, trail in 0x40..0xfe but 0x7f:
+//     two_byte.append(ord(bytes([lead, trail]).decode("gb18030")))
+// four byte ranges: the linear index of the first code of each run decoding to consecutive code points.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ostring/definitions.h"
+
+_NS_OSTR_BEGIN
+
+namespace gb18030_table {{
+
+	constexpr uint8_t lead_min = 0x{LEAD_MIN:02x};
+	constexpr uint8_t lead_max = 0x{LEAD_MAX:02x};
+	constexpr size_t trail_count = 190;
+
+	// code point of a two byte code, at (lead - 0x81) * 190 + trail index
+	// trail index is trail - 0x40 below 0x7f, trail - 0x41 above it
+	constexpr char16_t two_byte[{len(two_byte)}] = {{
+{rows(two_byte, 16, lambda v: f"0x{v:04x}")}
+	}};
+
+	// four byte codes of the first plane, linear index from 0x81308130
+	// a run goes on to the start of the next one, the last ends at U+FFFF
+	constexpr uint16_t four_byte_linear[{len(linear)}] = {{
+{rows(linear, 12, str)}
+	}};
+
+	constexpr char16_t four_byte_codepoint[{len(codepoint)}] = {{
+{rows(codepoint, 12, lambda v: f"0x{v:04x}")}
+	}};
+}}
+
+_NS_OSTR_END""")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,281 @@
+#include "ostring/mapped_text.h"
+#include "ostring/coder.h"
+#include "ostring/helpers.h"
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+_NS_OSTR_BEGIN
+
+namespace
+{
+	constexpr size_t min_cache_pages = 2;
+
+	// the decoder pairs every surrogate, so each trail closes one code point of two units
+	size_t count_codepoints(std::u16string_view text) noexcept
+	{
+		size_t trails = 0;
+		for (const char16_t c : text)
+			trails += helper::codepoint::is_trail_surrogate(c);
+		return text.size() - trails;
+	}
+
+	// unit index count code points after start
+	size_t advance(std::u16string_view text, size_t start, size_t count) noexcept
+	{
+		size_t i = start;
+		for (; count != 0 && i < text.size(); --count)
+			i += helper::codepoint::is_lead_surrogate(text[i]) && i + 1 < text.size() ? 2 : 1;
+		return i;
+	}
+}
+
+mapped_text::mapped_text(const char* path, size_t cache_pages)
+	: _cache_pages(cache_pages < min_cache_pages ? min_cache_pages : cache_pages)
+	, _offsets{ 0 }
+{
+#if defined(_WIN32)
+	const HANDLE file = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	LARGE_INTEGER size;
+	if (!::GetFileSizeEx(file, &size))
+		size.QuadPart = -1;
+	if (size.QuadPart == 0)
+	{
+		_open = true;
+	}
+	else if (size.QuadPart > 0 && uint64_t(size.QuadPart) <= SIZE_MAX)
+	{
+		// the view keeps the mapping alive once both handles are closed
+		if (const HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr))
+		{
+			_data = static_cast<const char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			::CloseHandle(mapping);
+			_size = _data ? size_t(size.QuadPart) : 0;
+			_open = _data != nullptr;
+		}
+	}
+	::CloseHandle(file);
+#else
+	const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+	struct stat st;
+	if (::fstat(fd, &st) != 0)
+		st.st_size = -1;
+	if (st.st_size == 0)
+	{
+		_open = true;
+	}
+	else if (st.st_size > 0 && uint64_t(st.st_size) <= SIZE_MAX)
+	{
+		void* data = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED)
+		{
+			_data = static_cast<const char*>(data);
+			_size = size_t(st.st_size);
+			_open = true;
+		}
+	}
+	::close(fd);
+#endif
+
+	_slots.assign(page_count(), SIZE_MAX);
+	_cache.reserve(_cache_pages);
+}
+
+mapped_text::~mapped_text()
+{
+	if (!_data)
+		return;
+#if defined(_WIN32)
+	::UnmapViewOfFile(_data);
+#else
+	::munmap(const_cast<char*>(_data), _size);
+#endif
+}
+
+string_view mapped_text::page(size_t index)
+{
+	if (index >= page_count())
+		return {};
+
+	size_t slot = _slots[index];
+	if (slot == SIZE_MAX)
+	{
+		if (_cache.size() < _cache_pages)
+		{
+			slot = _cache.size();
+			_cache.emplace_back();
+		}
+		else
+		{
+			const auto oldest = std::min_element(_cache.begin(), _cache.end(),
+				[](const cached_page& lhs, const cached_page& rhs) { return lhs.used < rhs.used; });
+			slot = size_t(oldest - _cache.begin());
+			_slots[oldest->page] = SIZE_MAX;
+		}
+		decode(index, _cache[slot].text);
+		_cache[slot].page = index;
+		_slots[index] = slot;
+		++_decoded;
+	}
+
+	_cache[slot].used = ++_tick;
+	return string_view(std::u16string_view(_cache[slot].text));
+}
+
+size_t mapped_text::length()
+{
+	return page_offset(page_count());
+}
+
+string_view mapped_text::substring(size_t offset, size_t count)
+{
+	size_t index = locate(offset);
+	if (index >= page_count() || count == 0)
+		return {};
+
+	std::u16string_view text = page(index).raw();
+	const size_t first = unit_index(index, text, offset - _offsets[index]);
+	const size_t last = advance(text, first, count);
+	count -= count_codepoints(text.substr(first, last - first));
+	if (count == 0 || index + 1 == page_count())
+		return string_view(text.substr(first, last - first));
+
+	// the range goes on into the next pages, copy each before decoding the next
+	_joined.assign(text.substr(first));
+	while (count != 0 && ++index < page_count())
+	{
+		text = page(index).raw();
+		const size_t end = advance(text, 0, count);
+		count -= count_codepoints(text.substr(0, end));
+		_joined.append(text.substr(0, end));
+	}
+	return string_view(std::u16string_view(_joined));
+}
+
+size_t mapped_text::index_of(const string_view& pattern, size_t from)
+{
+	const std::u16string_view needle = pattern.raw();
+	size_t index = locate(from);
+	if (index >= page_count())
+		return needle.empty() && from == length() ? from : SIZE_MAX;
+
+	size_t start = unit_index(index, page(index).raw(), from - _offsets[index]);
+	for (; index < page_count(); ++index, start = 0)
+	{
+		const std::u16string_view text = page(index).raw();
+		const size_t base = page_offset(index);
+		const size_t pos = text.find(needle, start);
+		if (pos != std::u16string_view::npos)
+			return base + codepoint_index(index, text, pos);
+		if (needle.size() < 2 || index + 1 == page_count())
+			continue;
+
+		// a match across the boundary, from the tail of this page into the head of the next
+		const size_t tail = std::max(start, text.size() - std::min(text.size(), needle.size() - 1));
+		const size_t tail_offset = base + codepoint_index(index, text, tail);
+		_joined.assign(text.substr(tail));
+		_joined.append(page(index + 1).raw().substr(0, needle.size() - 1));
+		const size_t joined_pos = std::u16string_view(_joined).find(needle);
+		if (joined_pos != std::u16string_view::npos)
+			return tail_offset + count_codepoints(std::u16string_view(_joined).substr(0, joined_pos));
+	}
+	return SIZE_MAX;
+}
+
+size_t mapped_text::page_begin(size_t index) const noexcept
+{
+	size_t begin = index * page_size;
+	if (begin >= _size)
+		return _size;
+	// a sequence has 3 continuation bytes at most, more belong to no sequence
+	const size_t limit = std::min(begin + 3, _size);
+	while (begin < limit && (static_cast<uint8_t>(_data[begin]) & 0xC0) == 0x80)
+		++begin;
+	return begin;
+}
+
+void mapped_text::decode(size_t index, std::u16string& out) const
+{
+	const size_t begin = page_begin(index);
+	const std::string_view bytes(_data + begin, page_begin(index + 1) - begin);
+	out.resize(coder::utf16_capacity(bytes.size()));
+	out.resize(coder::decode_utf8(bytes, out.data()).written);
+}
+
+size_t mapped_text::page_offset(size_t index)
+{
+	while (_offsets.size() <= index)
+	{
+		// counted from the cache when there, else decoded aside so the cache is not flushed
+		const size_t counted = _offsets.size() - 1;
+		std::u16string_view text;
+		if (_slots[counted] != SIZE_MAX)
+		{
+			text = _cache[_slots[counted]].text;
+		}
+		else
+		{
+			decode(counted, _scratch);
+			text = _scratch;
+		}
+		const size_t codepoints = count_codepoints(text);
+		_offsets.push_back(_offsets.back() + codepoints);
+		_pairs.push_back(text.size() - codepoints);
+	}
+	return _offsets[index];
+}
+
+size_t mapped_text::locate(size_t offset)
+{
+	while (_offsets.size() <= page_count() && _offsets.back() <= offset)
+		page_offset(_offsets.size());
+	const auto it = std::upper_bound(_offsets.begin(), _offsets.end(), offset);
+	return size_t(it - _offsets.begin()) - 1;
+}
+
+size_t mapped_text::unit_index(size_t index, std::u16string_view text, size_t count)
+{
+	page_offset(index + 1);
+	if (_pairs[index] == 0)
+		return std::min(count, text.size());
+
+	const bool resume = _last.page == index && _last.codepoint <= count;
+	const size_t unit = resume
+		? advance(text, _last.unit, count - _last.codepoint)
+		: advance(text, 0, count);
+	if (unit < text.size())
+		_last = { index, unit, count };
+	return unit;
+}
+
+size_t mapped_text::codepoint_index(size_t index, std::u16string_view text, size_t unit)
+{
+	page_offset(index + 1);
+	if (_pairs[index] == 0)
+		return unit;
+
+	const bool resume = _last.page == index && _last.unit <= unit;
+	const size_t from = resume ? _last.unit : 0;
+	const size_t codepoint = (resume ? _last.codepoint : 0) + count_codepoints(text.substr(from, unit - from));
+	// a unit inside a pair is no place to resume an advance from
+	if (unit < text.size() && !helper::codepoint::is_trail_surrogate(text[unit]))
+		_last = { index, unit, codepoint };
+	return codepoint;
+}
+
+_NS_OSTR_END
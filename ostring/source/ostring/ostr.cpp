@@ -4,31 +4,52 @@
 
 _NS_OSTR_BEGIN
 
-size_t string::length() const
+template<typename Alloc>
+size_t basic_string<Alloc>::length() const
 {
 	return _str.size() - _surrogate_pair_count;
 }
 
-string& string::operator+=(const string& rhs)
+template<typename Alloc>
+basic_string<Alloc>& basic_string<Alloc>::operator+=(const basic_string& rhs)
 {
 	_str += rhs._str;
 	_surrogate_pair_count += rhs._surrogate_pair_count;
 	return *this;
 }
 
-string string::operator+(const string& rhs)
+template<typename Alloc>
+basic_string<Alloc> basic_string<Alloc>::operator+(const basic_string& rhs) const&
 {
-	string str = *this;
+	basic_string str(get_allocator());
+	str._str.reserve(_str.size() + rhs._str.size());
+	str += *this;
 	str += rhs;
 	return str;
 }
 
-string string::substring(size_t from, size_t size) const
+template<typename Alloc>
+basic_string<Alloc> basic_string<Alloc>::operator+(const basic_string& rhs)&&
+{
+	*this += rhs;
+	return std::move(*this);
+}
+
+template<typename Alloc>
+basic_string<Alloc> basic_string<Alloc>::substring(size_t from, size_t size) const
+{
+	return substring(from, size, get_allocator());
+}
+
+template<typename Alloc>
+basic_string<Alloc> basic_string<Alloc>::substring(size_t from, size_t size, const allocator_type& alloc) const
 {
 	const size_t uint16_size = std::min(size, length() - from);
+	basic_string ret(alloc);
 	if (_surrogate_pair_count == 0)
 	{
-		return _str.substr(from, size);
+		ret._str.assign(_str, from, size);
+		return ret;
 	}
 	else
 	{
@@ -37,13 +58,14 @@ string string::substring(size_t from, size_t size) const
 		const size_t substr_surrogate_pair_count = _surrogate_pair_count - ((from_it - _str.cbegin()) - from);
 		const size_t real_size = uint16_size + substr_surrogate_pair_count;
 
-		string ret = _str.substr(from_it - _str.cbegin(), real_size);
+		ret._str.assign(_str, from_it - _str.cbegin(), real_size);
 		ret._surrogate_pair_count = substr_surrogate_pair_count;
 		return ret;
 	}
 }
 
-size_t string::index_of(const string_view& substr, size_t from, size_t length, case_sensitivity cs) const
+template<typename Alloc>
+size_t basic_string<Alloc>::index_of(const string_view& substr, size_t from, size_t length, case_sensitivity cs) const
 {
 	size_t ind = static_cast<string_view>(*this)
 		.substring(from, length)
@@ -52,7 +74,8 @@ size_t string::index_of(const string_view& substr, size_t from, size_t length, c
 	return ind + from;
 }
 
-size_t string::last_index_of(const string_view& substr, size_t from, size_t length, case_sensitivity cs) const
+template<typename Alloc>
+size_t basic_string<Alloc>::last_index_of(const string_view& substr, size_t from, size_t length, case_sensitivity cs) const
 {
 	size_t ind = static_cast<string_view>(*this)
 		.substring(from, length)
@@ -61,17 +84,20 @@ size_t string::last_index_of(const string_view& substr, size_t from, size_t leng
 	return ind + from;
 }
 
-bool string::split(const string_view& splitter, string_view* lhs, string_view* rhs) const
+template<typename Alloc>
+bool basic_string<Alloc>::split(const string_view& splitter, string_view* lhs, string_view* rhs) const
 {
 	return to_sv().split(splitter, lhs, rhs);
 }
 
-size_t string::split(const string_view& splitter, std::vector<string_view>& str) const
+template<typename Alloc>
+size_t basic_string<Alloc>::split(const string_view& splitter, std::vector<string_view>& str) const
 {
 	return to_sv().split(splitter, str);
 }
 
-string& string::replace_origin(size_t from, size_t count, const string_view& dest, case_sensitivity cs)
+template<typename Alloc>
+basic_string<Alloc>& basic_string<Alloc>::replace_origin(size_t from, size_t count, const string_view& dest, case_sensitivity cs)
 {
 	count = position_codepoint_to_index(from + count);
 	from = position_codepoint_to_index(from);
@@ -83,7 +109,8 @@ string& string::replace_origin(size_t from, size_t count, const string_view& des
 	return *this;
 }
 
-string& string::replace_origin(const string_view& src, const string_view& dest, case_sensitivity cs)
+template<typename Alloc>
+basic_string<Alloc>& basic_string<Alloc>::replace_origin(const string_view& src, const string_view& dest, case_sensitivity cs)
 {
 	// src should NOT be empty!
 	if (src.is_empty()) return *this; // ASSERT!
@@ -102,14 +129,22 @@ string& string::replace_origin(const string_view& src, const string_view& dest,
 	return *this;
 }
 
-string string::replace_copy(const string_view& src, const string_view& dest, case_sensitivity cs) const
+template<typename Alloc>
+basic_string<Alloc> basic_string<Alloc>::replace_copy(const string_view& src, const string_view& dest, case_sensitivity cs) const
+{
+	return replace_copy(src, dest, cs, get_allocator());
+}
+
+template<typename Alloc>
+basic_string<Alloc> basic_string<Alloc>::replace_copy(const string_view& src, const string_view& dest, case_sensitivity cs, const allocator_type& alloc) const
 {
-	string new_inst(*this);
+	basic_string new_inst(*this, alloc);
 	new_inst.replace_origin(src, dest, cs);
 	return new_inst;
 }
 
-string& string::trim_start()
+template<typename Alloc>
+basic_string<Alloc>& basic_string<Alloc>::trim_start()
 {
 	auto begin = _str.cbegin();
 
@@ -120,7 +155,8 @@ string& string::trim_start()
 	return *this;
 }
 
-string& string::trim_end() 
+template<typename Alloc>
+basic_string<Alloc>& basic_string<Alloc>::trim_end() 
 {
 	auto rbegin = _str.crbegin();
 
@@ -131,41 +167,68 @@ string& string::trim_end()
 	return *this;
 }
 
-string string::trim_start_copy() const
+template<typename Alloc>
+basic_string<Alloc> basic_string<Alloc>::trim_start_copy() const
 {
-	string ret(*this);
+	return trim_start_copy(get_allocator());
+}
+
+template<typename Alloc>
+basic_string<Alloc> basic_string<Alloc>::trim_start_copy(const allocator_type& alloc) const
+{
+	basic_string ret(*this, alloc);
 	ret.trim_start();
 	return ret;
 }
 
-string string::trim_end_copy() const
+template<typename Alloc>
+basic_string<Alloc> basic_string<Alloc>::trim_end_copy() const
+{
+	return trim_end_copy(get_allocator());
+}
+
+template<typename Alloc>
+basic_string<Alloc> basic_string<Alloc>::trim_end_copy(const allocator_type& alloc) const
 {
-	string ret(*this);
+	basic_string ret(*this, alloc);
 	ret.trim_end();
 	return ret;
 }
 
-string string::trim_copy() const
+template<typename Alloc>
+basic_string<Alloc> basic_string<Alloc>::trim_copy() const
 {
-	string ret(*this);
+	return trim_copy(get_allocator());
+}
+
+template<typename Alloc>
+basic_string<Alloc> basic_string<Alloc>::trim_copy(const allocator_type& alloc) const
+{
+	basic_string ret(*this, alloc);
 	ret.trim();
 	return ret;
 }
 
-void string::calculate_surrogate()
+template<typename Alloc>
+void basic_string<Alloc>::calculate_surrogate()
 {
 	_surrogate_pair_count = helper::string::count_surrogate_pair(_str.cbegin(), _str.cend());
 }
 
-size_t string::position_codepoint_to_index(size_t codepoint_count_to_iterator) const
+template<typename Alloc>
+size_t basic_string<Alloc>::position_codepoint_to_index(size_t codepoint_count_to_iterator) const
 {
 	auto from_it = helper::string::codepoint_count_to_iterator(_str.cbegin(), codepoint_count_to_iterator, _str.cend());
 	return from_it - _str.cbegin();
 }
 
-size_t string::position_index_to_codepoint(size_t index) const
+template<typename Alloc>
+size_t basic_string<Alloc>::position_index_to_codepoint(size_t index) const
 {
 	return index - helper::string::count_surrogate_pair(_str.cbegin(), _str.cbegin() + index);
 }
 
+template class OPEN_STRING_EXPORT basic_string<std::allocator<char16_t>>;
+template class OPEN_STRING_EXPORT basic_string<std::pmr::polymorphic_allocator<char16_t>>;
+
 _NS_OSTR_END
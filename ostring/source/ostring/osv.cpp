@@ -114,7 +114,7 @@ size_t string_view::split(const string_view& splitter, std::vector<string_view>&
 string_view string_view::trim_start() const noexcept
 {
 	size_t begin = 0;
-	while (_str.data()[begin] == ' ') 
+	while (begin < _str.size() && _str.data()[begin] == ' ') 
 	{
 		++begin;
 	}
@@ -123,23 +123,61 @@ string_view string_view::trim_start() const noexcept
 
 string_view string_view::trim_end() const noexcept
 {
-	size_t end = _str.size() - 1;
-	while (_str.data()[end] == ' ') 
+	size_t end = _str.size();
+	while (end > 0 && _str.data()[end - 1] == ' ') 
 	{
 		--end;
 	}
-	return this->_str.substr(0, end + 1);
+	return this->_str.substr(0, end);
 }
 
-int string_view::to_int() const noexcept
+template<typename I>
+static I parse_whole(string_view sv, int base) noexcept
 {
-	int value = 0;
-	string_view sv = this->trim();
-	for (const auto& c : sv._str)
-		value = value * 10 + c - u'0';
+	I value = 0;
+	sv = sv.trim();
+	const parse_result result = sv.parse_int(value, base);
+	if (result.ec != std::errc() || result.length != sv.origin_length())
+		return 0;
 	return value;
 }
 
+template<typename F>
+static F parse_whole_float(string_view sv) noexcept
+{
+	F value = 0;
+	sv = sv.trim();
+	const parse_result result = sv.parse_float(value);
+	if (result.ec != std::errc() || result.length != sv.origin_length())
+		return 0;
+	return value;
+}
+
+double string_view::to_double() const noexcept
+{
+	return parse_whole_float<double>(*this);
+}
+
+float string_view::to_float() const noexcept
+{
+	return parse_whole_float<float>(*this);
+}
+
+int string_view::to_int(int base) const noexcept
+{
+	return parse_whole<int>(*this, base);
+}
+
+int64_t string_view::to_int64(int base) const noexcept
+{
+	return parse_whole<int64_t>(*this, base);
+}
+
+uint64_t string_view::to_uint64(int base) const noexcept
+{
+	return parse_whole<uint64_t>(*this, base);
+}
+
 size_t string_view::position_codepoint_to_index(size_t codepoint_count_to_iterator) const noexcept
 {
 	auto from_it = helper::string::codepoint_count_to_iterator(_str.cbegin(), codepoint_count_to_iterator, _str.cend());
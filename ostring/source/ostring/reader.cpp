@@ -0,0 +1,181 @@
+#include "ostring/reader.h"
+
+#include <cerrno>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+_NS_OSTR_BEGIN
+
+namespace
+{
+	constexpr size_t min_chunk_size = 64;
+
+	long long read_some(int fd, char* data, size_t size)
+	{
+#if defined(_WIN32)
+		return _read(fd, data, static_cast<unsigned>(size));
+#else
+		return ::read(fd, data, size);
+#endif
+	}
+}
+
+u8_reader::u8_reader(int fd, size_t chunk_size, bool prefetch)
+	: _fd(fd)
+	, _chunk_size(chunk_size < min_chunk_size ? min_chunk_size : chunk_size)
+{
+	for (chunk& c : _chunks)
+		c.buffer.reset(new char[_chunk_size]);
+	_text.reserve(coder::utf16_capacity(_chunk_size));
+
+	if (prefetch)
+		_prefetcher = std::thread([this]() { prefetch_loop(); });
+}
+
+u8_reader::~u8_reader()
+{
+	if (_prefetcher.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_cv.notify_all();
+		_prefetcher.join();
+	}
+}
+
+bool u8_reader::next_line(string_view& line)
+{
+	if (!next_record(u'\n', line))
+		return false;
+	if (!line.is_empty() && line.raw().back() == u'\r')
+		line = string_view(line.raw().substr(0, line.raw().size() - 1));
+	return true;
+}
+
+bool u8_reader::next_record(char16_t delimiter, string_view& record)
+{
+	while (true)
+	{
+		const size_t pos = std::u16string_view(_text).find(delimiter, _scan);
+		if (pos != std::u16string_view::npos)
+		{
+			record = string_view(std::u16string_view(_text.data() + _begin, pos - _begin));
+			_begin = _scan = pos + 1;
+			return true;
+		}
+
+		// keep only the unfinished record, then decode after it
+		_text.erase(0, _begin);
+		_begin = 0;
+		_scan = _text.size();
+		if (fill())
+			continue;
+
+		if (_text.empty())
+			return false;
+		record = string_view(std::u16string_view(_text));
+		_begin = _scan = _text.size();
+		return true;
+	}
+}
+
+bool u8_reader::fill()
+{
+	if (_eof)
+		return false;
+
+	chunk& c = _chunks[_current];
+	if (_prefetcher.joinable())
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_cv.wait(lock, [&]() { return c.filled; });
+	}
+	else
+	{
+		read_chunk(c);
+	}
+
+	// the chunk goes back to the prefetcher below, keep what is needed after
+	const size_t size = c.size;
+	_read += size;
+	_failed |= c.failed;
+	const bool last = size == 0;
+
+	const size_t start = _text.size();
+	const size_t pending = _decoder.pending();
+	_text.resize(start + coder::utf16_capacity(pending + size));
+	size_t written = _decoder.feed(std::string_view(c.buffer.get(), size), _text.data() + start);
+	if (last)
+		written += _decoder.finish(_text.data() + start + written);
+	_text.resize(start + written);
+
+	if (_prefetcher.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			c.filled = false;
+		}
+		_cv.notify_all();
+	}
+	_current ^= 1;
+
+	if (last)
+		_eof = true;
+	return pending + size != 0;
+}
+
+void u8_reader::read_chunk(chunk& c)
+{
+	c.size = 0;
+	c.failed = false;
+	// take what one call hands out, a pipe or terminal should not wait for a whole chunk
+	while (true)
+	{
+		const long long n = read_some(_fd, c.buffer.get(), _chunk_size);
+		if (n >= 0)
+		{
+			c.size = size_t(n);
+			return;
+		}
+		if (errno != EINTR)
+		{
+			// ends the input
+			c.failed = true;
+			return;
+		}
+	}
+}
+
+void u8_reader::prefetch_loop()
+{
+	size_t index = 0;
+	while (true)
+	{
+		chunk& c = _chunks[index];
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cv.wait(lock, [&]() { return !c.filled || _stop; });
+			if (_stop)
+				return;
+		}
+
+		read_chunk(c);
+		const bool last = c.size == 0;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			c.filled = true;
+		}
+		_cv.notify_all();
+		if (last)
+			return;
+		index ^= 1;
+	}
+}
+
+_NS_OSTR_END
@@ -0,0 +1,97 @@
+#pragma once
+// Shared by the resumable decoders and encoders, utf8_decoder, gb18030_decoder and the like.
+
+#include <cstring>
+#include <string_view>
+
+#include "ostring/coder.h"
+#include "ostring/helpers.h"
+
+_NS_OSTR_BEGIN
+
+namespace coder::stream {
+
+	// decode a chunk after the bytes held from the last one, hold the bytes of a sequence cut at its end
+	// @param decode: transcode_result(std::string_view, char16_t*, bool final).
+	// @param pending: bytes held, one less than the longest sequence at most.
+	// @param size: count of bytes held.
+	// @return: code units written.
+	template<size_t N, typename Decode>
+	size_t feed_bytes(std::string_view chunk, char16_t* out_u16, char (&pending)[N], size_t& size, Decode&& decode) noexcept
+	{
+		size_t written = 0;
+		if (size != 0)
+		{
+			// the held bytes and the head of the chunk, enough to complete any sequence
+			char joined[N + N];
+			const size_t head = chunk.size() < N ? chunk.size() : N;
+			std::memcpy(joined, pending, size);
+			std::memcpy(joined + size, chunk.data(), head);
+			const transcode_result result = decode(std::string_view(joined, size + head), out_u16, false);
+			written = result.written;
+			if (result.read < size)
+			{
+				// the whole chunk went in and the sequence is still cut
+				size = size + head - result.read;
+				std::memmove(pending, joined + result.read, size);
+				return written;
+			}
+			chunk.remove_prefix(result.read - size);
+			size = 0;
+		}
+
+		const transcode_result result = decode(chunk, out_u16 + written, false);
+		size = chunk.size() - result.read;
+		std::memcpy(pending, chunk.data() + result.read, size);
+		return written + result.written;
+	}
+
+	// the bytes held are written as they decode at the end, U+FFFD for a cut sequence
+	template<size_t N, typename Decode>
+	size_t finish_bytes(char16_t* out_u16, char (&pending)[N], size_t& size, Decode&& decode) noexcept
+	{
+		const size_t written = decode(std::string_view(pending, size), out_u16, true).written;
+		size = 0;
+		return written;
+	}
+
+	// encode a chunk after the lead surrogate held from the last one, hold a lead surrogate at its end
+	// @param encode: transcode_result(std::u16string_view, C*, bool final).
+	// @param lead: the lead surrogate held, 0 if none.
+	// @return: code units written.
+	template<typename C, typename Encode>
+	size_t feed_units(std::u16string_view chunk, C* out, char16_t& lead, Encode&& encode) noexcept
+	{
+		if (chunk.empty())
+			return 0;
+
+		size_t written = 0;
+		if (lead)
+		{
+			const char16_t pair[2] = { lead, chunk[0] };
+			const bool joined = helper::codepoint::is_trail_surrogate(chunk[0]);
+			written = encode(std::u16string_view(pair, joined ? 2 : 1), out, true).written;
+			lead = 0;
+			if (joined)
+				chunk.remove_prefix(1);
+		}
+
+		const transcode_result result = encode(chunk, out + written, false);
+		if (result.read != chunk.size())
+			lead = chunk.back();
+		return written + result.written;
+	}
+
+	// a lead surrogate held is written alone, U+FFFD
+	template<typename C, typename Encode>
+	size_t finish_units(C* out, char16_t& lead, Encode&& encode) noexcept
+	{
+		if (!lead)
+			return 0;
+		const size_t written = encode(std::u16string_view(&lead, 1), out, true).written;
+		lead = 0;
+		return written;
+	}
+}
+
+_NS_OSTR_END
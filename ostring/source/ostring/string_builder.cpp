@@ -0,0 +1,144 @@
+#include "ostring/string_builder.h"
+
+#include <algorithm>
+#include <cstring>
+
+_NS_OSTR_BEGIN
+
+namespace
+{
+	constexpr size_t min_chunk_size = 16;
+}
+
+string_builder::string_builder(size_t chunk_size)
+	: _chunk_size(chunk_size < min_chunk_size ? min_chunk_size : chunk_size)
+{
+}
+
+string_builder& string_builder::append(std::u16string_view units)
+{
+	return append_counted(units, helper::string::count_surrogate_pair(units.cbegin(), units.cend()));
+}
+
+string_builder& string_builder::append(codepoint cp)
+{
+	char16_t units[2];
+	size_t count = 1;
+	if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)
+	{
+		units[0] = 0xFFFD;
+	}
+	else if (cp < 0x10000)
+	{
+		units[0] = char16_t(cp);
+	}
+	else
+	{
+		cp -= 0x10000;
+		units[0] = char16_t(0xD800 | (cp >> 10));
+		units[1] = char16_t(0xDC00 | (cp & 0x3FF));
+		count = 2;
+	}
+	return append_counted(std::u16string_view(units, count), count - 1);
+}
+
+string_builder& string_builder::append_utf8(std::string_view u8)
+{
+	if (u8.empty()) return *this;
+
+	chunk& c = reserve_contiguous(coder::utf16_capacity(u8.size()));
+	char16_t* const start = c.data.get() + c.size;
+	const size_t written = coder::decode_utf8(u8, start).written;
+	if (written == 0) return *this;
+
+	_pairs += helper::string::count_surrogate_pair(start, start + written);
+	if (helper::codepoint::is_lead_surrogate(_last) && helper::codepoint::is_trail_surrogate(start[0]))
+		++_pairs;
+	c.size += written;
+	_units += written;
+	_last = start[written - 1];
+	return *this;
+}
+
+size_t string_builder::capacity() const noexcept
+{
+	size_t ans = 0;
+	for (const chunk& c : _chunks)
+		ans += c.capacity;
+	return ans;
+}
+
+void string_builder::clear() noexcept
+{
+	for (chunk& c : _chunks)
+		c.size = 0;
+	_current = 0;
+	_units = 0;
+	_pairs = 0;
+	_last = 0;
+}
+
+string_builder& string_builder::append_counted(std::u16string_view units, size_t pairs)
+{
+	if (units.empty()) return *this;
+
+	if (helper::codepoint::is_lead_surrogate(_last) && helper::codepoint::is_trail_surrogate(units[0]))
+		++pairs;
+	_pairs += pairs;
+	_units += units.size();
+	_last = units.back();
+
+	// fill what is left of the current chunk, then go on in the next
+	while (!units.empty())
+	{
+		chunk* c = _chunks.empty() ? nullptr : &_chunks[_current];
+		// every chunk holds _chunk_size at least, a kept one is always taken
+		if (c == nullptr || c->size == c->capacity)
+			c = &next_chunk(std::min(units.size(), _chunk_size));
+		const size_t n = std::min(units.size(), c->capacity - c->size);
+		std::memcpy(c->data.get() + c->size, units.data(), n * sizeof(char16_t));
+		c->size += n;
+		units.remove_prefix(n);
+	}
+	return *this;
+}
+
+string_builder::chunk& string_builder::reserve_contiguous(size_t count)
+{
+	if (!_chunks.empty())
+	{
+		chunk& c = _chunks[_current];
+		if (c.capacity - c.size >= count)
+			return c;
+	}
+	return next_chunk(count);
+}
+
+string_builder::chunk& string_builder::next_chunk(size_t at_least)
+{
+	// kept chunks from before a clear() are reused, the current one too while it is empty
+	const size_t next = _chunks.empty() ? 0 : (_chunks[_current].size == 0 ? _current : _current + 1);
+	if (next < _chunks.size() && _chunks[next].capacity >= at_least)
+	{
+		_current = next;
+		return _chunks[_current];
+	}
+
+	const size_t last = _chunks.empty() ? 0 : _chunks.back().capacity;
+	chunk c;
+	c.capacity = std::max({ at_least, _chunk_size, last * 2 });
+	c.data.reset(new char16_t[c.capacity]);
+	if (next < _chunks.size())
+	{
+		// too small for this piece, replaced where it is so the order holds
+		_chunks[next] = std::move(c);
+	}
+	else
+	{
+		_chunks.push_back(std::move(c));
+	}
+	_current = next;
+	return _chunks[_current];
+}
+
+_NS_OSTR_END
@@ -0,0 +1,184 @@
+#include "ostring/u8string.h"
+#include <string_view>
+
+_NS_OSTR_BEGIN
+
+namespace
+{
+	// byte offset of the pattern, SIZE_MAX if not found
+	size_t find_bytes(std::string_view str, std::string_view pattern, case_sensitivity cs) noexcept
+	{
+		if (cs == case_sensitivity::sensitive)
+		{
+			const size_t pos = str.find(pattern);
+			return pos == std::string_view::npos ? SIZE_MAX : pos;
+		}
+
+		auto& predicate = helper::character::case_predicate<char>(cs);
+		auto it = std::search(str.cbegin(), str.cend(), pattern.cbegin(), pattern.cend(), predicate);
+		if (it == str.cend()) return SIZE_MAX;
+		return it - str.cbegin();
+	}
+
+	size_t rfind_bytes(std::string_view str, std::string_view pattern, case_sensitivity cs) noexcept
+	{
+		if (cs == case_sensitivity::sensitive)
+		{
+			const size_t pos = str.rfind(pattern);
+			return pos == std::string_view::npos ? SIZE_MAX : pos;
+		}
+
+		auto& predicate = helper::character::case_predicate<char>(cs);
+		auto it = std::search(str.crbegin(), str.crend(), pattern.crbegin(), pattern.crend(), predicate);
+		if (it == str.crend()) return SIZE_MAX;
+		return str.crend() - it - pattern.size();
+	}
+}
+
+u8string_view u8string_view::remove_prefix(size_t count) const noexcept
+{
+	return _str.substr(position_codepoint_to_index(count));
+}
+
+u8string_view u8string_view::remove_suffix(size_t count) const noexcept
+{
+	const size_t total = length();
+	if (count >= total) return _str.substr(0, 0);
+	return _str.substr(0, position_codepoint_to_index(total - count));
+}
+
+u8string_view u8string_view::left(size_t count) const noexcept
+{
+	return _str.substr(0, position_codepoint_to_index(count));
+}
+
+u8string_view u8string_view::right(size_t count) const noexcept
+{
+	const size_t total = length();
+	if (count >= total) return *this;
+	return _str.substr(position_codepoint_to_index(total - count));
+}
+
+u8string_view u8string_view::substring(size_t offset, size_t count) const noexcept
+{
+	const u8string_view tail = remove_prefix(offset);
+	return tail.left(count);
+}
+
+size_t u8string_view::index_of(const u8string_view& pattern, case_sensitivity cs) const noexcept
+{
+	const size_t index_found = find_bytes(_str, pattern._str, cs);
+	if (index_found == SIZE_MAX) return SIZE_MAX;
+	return this->position_index_to_codepoint(index_found);
+}
+
+size_t u8string_view::last_index_of(const u8string_view& pattern, case_sensitivity cs) const noexcept
+{
+	const size_t index_found = rfind_bytes(_str, pattern._str, cs);
+	if (index_found == SIZE_MAX) return SIZE_MAX;
+	return this->position_index_to_codepoint(index_found);
+}
+
+bool u8string_view::split(const u8string_view& splitter, u8string_view* lhs, u8string_view* rhs) const noexcept
+{
+	// cut on bytes, the splitter is skipped whole
+	const size_t splitter_index = find_bytes(_str, splitter._str, case_sensitivity::sensitive);
+	if (lhs) *lhs = _str.substr(0, splitter_index);
+	if (splitter_index == SIZE_MAX) return false;
+	if (rhs) *rhs = _str.substr(splitter_index + splitter._str.size());
+	return true;
+}
+
+size_t u8string_view::split(const u8string_view& splitter, std::vector<u8string_view>& str, bool cull_empty) const noexcept
+{
+	u8string_view lhs;
+	u8string_view rhs = *this;
+	size_t split_times = 0;
+	while (rhs.split(splitter, &lhs, &rhs))
+	{
+		if (!cull_empty || !lhs.is_empty())
+			str.push_back(lhs);
+		++split_times;
+	}
+	if (!cull_empty || !rhs.is_empty())
+		str.push_back(rhs);
+	return split_times;
+}
+
+u8string_view u8string_view::trim_start() const noexcept
+{
+	size_t begin = 0;
+	while (begin < _str.size() && _str.data()[begin] == ' ')
+	{
+		++begin;
+	}
+	return this->_str.substr(begin);
+}
+
+u8string_view u8string_view::trim_end() const noexcept
+{
+	size_t end = _str.size();
+	while (end > 0 && _str.data()[end - 1] == ' ')
+	{
+		--end;
+	}
+	return this->_str.substr(0, end);
+}
+
+size_t u8string::index_of(const u8string_view& substr, size_t from, size_t length, case_sensitivity cs) const
+{
+	size_t ind = to_sv()
+		.substring(from, length)
+		.index_of(substr, cs);
+	if (ind == SIZE_MAX) return SIZE_MAX;
+	return ind + from;
+}
+
+size_t u8string::last_index_of(const u8string_view& substr, size_t from, size_t length, case_sensitivity cs) const
+{
+	size_t ind = to_sv()
+		.substring(from, length)
+		.last_index_of(substr, cs);
+	if (ind == SIZE_MAX) return SIZE_MAX;
+	return ind + from;
+}
+
+u8string& u8string::replace_origin(const u8string_view& src, const u8string_view& dest)
+{
+	// src should NOT be empty!
+	if (src.is_empty()) return *this; // ASSERT!
+
+	const std::string_view from = src.raw();
+	const std::string_view to = dest.raw();
+	size_t index = _str.find(from);
+	while (index != std::string::npos)
+	{
+		_str.replace(index, from.size(), to);
+		index = _str.find(from, index + to.size());
+	}
+	return *this;
+}
+
+u8string& u8string::trim_start()
+{
+	auto begin = _str.cbegin();
+
+	while (begin != _str.cend() && *begin == ' ')
+		++begin;
+
+	_str.erase(_str.cbegin(), begin);
+	return *this;
+}
+
+u8string& u8string::trim_end()
+{
+	auto rbegin = _str.crbegin();
+
+	while (rbegin != _str.crend() && *rbegin == ' ')
+		++rbegin;
+
+	_str.erase(rbegin.base(), _str.cend());
+	return *this;
+}
+
+_NS_OSTR_END
@@ -0,0 +1,163 @@
+#include "ostring/writer.h"
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+_NS_OSTR_BEGIN
+
+namespace
+{
+	constexpr size_t min_capacity = 64;
+
+	// at most this many bytes per system call
+	constexpr size_t max_io = 1u << 30;
+
+	// to this buffer, larger writes go to the descriptor directly
+	constexpr size_t direct_write_threshold(size_t capacity)
+	{
+		return capacity / 2;
+	}
+
+	long long write_some(int fd, const char* data, size_t size)
+	{
+#if defined(_WIN32)
+		return _write(fd, data, static_cast<unsigned>(size < max_io ? size : max_io));
+#else
+		return ::write(fd, data, size < max_io ? size : max_io);
+#endif
+	}
+}
+
+u8_writer::u8_writer(int fd, size_t capacity)
+	: _fd(fd)
+	, _capacity(capacity < min_capacity ? min_capacity : capacity)
+{
+	_buffer.reset(new char[_capacity]);
+}
+
+u8_writer::~u8_writer()
+{
+	finish();
+}
+
+u8_writer& u8_writer::write(std::u16string_view str)
+{
+	while (!str.empty())
+	{
+		// a pending lead and one more unit at least, so that a pair always fits
+		if (_capacity - _size < coder::utf8_capacity(2))
+			flush();
+
+		const size_t units = (_capacity - _size) / coder::utf8_capacity(1) - _encoder.pending();
+		const std::u16string_view part = str.substr(0, units);
+		_size += _encoder.feed(part, _buffer.get() + _size);
+		str.remove_prefix(part.size());
+	}
+	return *this;
+}
+
+u8_writer& u8_writer::write_utf8(std::string_view bytes)
+{
+	finish_pending();
+
+	if (bytes.size() >= direct_write_threshold(_capacity))
+	{
+		// buffered bytes and the block in one system call
+		if (!write_fd(_buffer.get(), _size, bytes.data(), bytes.size()))
+			_failed = true;
+		_size = 0;
+		return *this;
+	}
+
+	if (_capacity - _size < bytes.size())
+		flush();
+	std::memcpy(_buffer.get() + _size, bytes.data(), bytes.size());
+	_size += bytes.size();
+	return *this;
+}
+
+bool u8_writer::flush()
+{
+	if (_size != 0)
+	{
+		if (!write_fd(_buffer.get(), _size))
+			_failed = true;
+		_size = 0;
+	}
+	return !_failed;
+}
+
+bool u8_writer::finish()
+{
+	finish_pending();
+	return flush();
+}
+
+void u8_writer::finish_pending()
+{
+	if (_capacity - _size < coder::utf8_capacity(_encoder.pending()))
+		flush();
+	_size += _encoder.finish(_buffer.get() + _size);
+}
+
+bool u8_writer::write_fd(const char* data, size_t size)
+{
+	while (size != 0)
+	{
+		const long long n = write_some(_fd, data, size);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		data += n;
+		size -= size_t(n);
+		_written += uint64_t(n);
+	}
+	return true;
+}
+
+bool u8_writer::write_fd(const char* data0, size_t size0, const char* data1, size_t size1)
+{
+#if defined(_WIN32)
+	return write_fd(data0, size0) && write_fd(data1, size1);
+#else
+	while (size0 != 0)
+	{
+		iovec iov[2];
+		iov[0].iov_base = const_cast<char*>(data0);
+		iov[0].iov_len = size0;
+		iov[1].iov_base = const_cast<char*>(data1);
+		iov[1].iov_len = size1;
+		const ssize_t n = ::writev(_fd, iov, 2);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		_written += uint64_t(n);
+		if (size_t(n) < size0)
+		{
+			data0 += n;
+			size0 -= size_t(n);
+			continue;
+		}
+		const size_t rest = size_t(n) - size0;
+		size0 = 0;
+		data1 += rest;
+		size1 -= rest;
+	}
+	return write_fd(data1, size1);
+#endif
+}
+
+_NS_OSTR_END
@@ -3,10 +3,20 @@
 
 #include "ostring/types.h"
 #include "ostring/format.h"
+#include "ostring/chrono.h"
+#include "ostring/deferred.h"
 
 #include <chrono>
 #include <iostream>
 #include <array>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <thread>
 #include "fmt/format.h"
 #include "ostring/format.h"
 
@@ -34,6 +44,15 @@ TEST(format, exec)
 		std::chrono::duration<float> delta = t1 - t0;
 		std::cout << delta.count() << std::endl;
 	}
+	{
+		auto t0 = std::chrono::system_clock::now();
+		for (int i = 0; i < 100000; ++i) {
+			std::u16string str = ostr::ofmt::format(u"{0}"sv, 3.14);
+		}
+		auto t1 = std::chrono::system_clock::now();
+		std::chrono::duration<float> delta = t1 - t0;
+		std::cout << delta.count() << std::endl;
+	}
 }
 
 TEST(format, no_param)
@@ -184,3 +203,347 @@ TEST(format, alignment)
 	EXPECT_TRUE(ofmt::format(u"{0,5}{1,5}{2,5}"sv, u"al"sv, u"align"sv, u"alignment"sv) == u"   alalignalignment"sv);
 	EXPECT_TRUE(ofmt::format(u"{0,-5}{1,-5}{2,-5}"sv, u"al"sv, u"align"sv, "alignment"sv) == u"al   alignalignment"sv);
 }
+
+TEST(format, floating_point)
+{
+	using namespace ostr;
+	using namespace std::literals;
+
+	// shortest round-trip
+	EXPECT_TRUE(ofmt::format(u"{0}", 3.14) == u"3.14"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", 3.14f) == u"3.14"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", 0.1) == u"0.1"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", 1.0 / 3) == u"0.3333333333333333"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", -2.5f) == u"-2.5"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", 100.0) == u"100"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", 0.0) == u"0"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", -0.0) == u"-0"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", 1e20) == u"1e+20"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", 1e-5) == u"1e-05"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", 0.0001) == u"0.0001"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", 5e-324) == u"5e-324"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", 1.7976931348623157e308) == u"1.7976931348623157e+308"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", 3e9f) == u"3000000000"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", 1e20f) == u"1e+20"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", std::numeric_limits<double>::infinity()) == u"inf"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", -std::numeric_limits<float>::infinity()) == u"-inf"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", std::numeric_limits<double>::quiet_NaN()) == u"nan"sv);
+
+	// fixed
+	EXPECT_TRUE(ofmt::format(u"{0:f}", 1e20) == u"100000000000000000000"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:.2f}", 3.14159) == u"3.14"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:.3f}", 2.0) == u"2.000"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:.2f}", 0.0004) == u"0.00"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:.0f}", 7.6) == u"8"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:.3f}", 0.0625) == u"0.062"sv);
+
+	// scientific
+	EXPECT_TRUE(ofmt::format(u"{0:e}", 12345.0) == u"1.2345e+04"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:.3e}", 12346.0) == u"1.235e+04"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:.2E}", 0.5f) == u"5.00E-01"sv);
+
+	// general
+	EXPECT_TRUE(ofmt::format(u"{0:.3g}", 1234.5678) == u"1.23e+03"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:.6g}", 1234.5678) == u"1234.57"sv);
+	// precision 0 is 1 significant digit, as printf
+	EXPECT_TRUE(ofmt::format(u"{0:.0g}", 12.0) == u"1e+01"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:.0g}", 3.7) == u"4"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:g}", 0.0001) == u"0.0001"sv);
+
+	// alignment
+	EXPECT_TRUE(ofmt::format(u"[{0,6:.1f}]", 2.25) == u"[   2.2]"sv);
+	EXPECT_TRUE(ofmt::format(u"[{0,-6}]", 0.5) == u"[0.5   ]"sv);
+
+	// integers of every width
+	EXPECT_TRUE(ofmt::format(u"{0}", INT64_MIN) == u"-9223372036854775808"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", UINT64_MAX) == u"18446744073709551615"sv);
+	EXPECT_TRUE(ofmt::format(u"{0} {1}", INT32_MIN, 4000000000u) == u"-2147483648 4000000000"sv);
+}
+
+TEST(format, floating_point_round_trip)
+{
+	using namespace ostr;
+
+	uint64_t state = 0x9E3779B97F4A7C15ull;
+	for (int i = 0; i < 100000; ++i)
+	{
+		state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+		double d;
+		std::memcpy(&d, &state, sizeof(d));
+		if (!std::isfinite(d)) continue;
+
+		std::string u8;
+		helper::string::append_float(d, u8);
+		EXPECT_EQ(std::strtod(u8.c_str(), nullptr), d) << u8;
+
+		float f = static_cast<float>(state >> 40) / static_cast<float>(1 << 10);
+		std::string u8f;
+		helper::string::append_float(f, u8f);
+		EXPECT_EQ(std::strtof(u8f.c_str(), nullptr), f) << u8f;
+	}
+}
+
+TEST(format, named_arg)
+{
+	using namespace ostr;
+	using namespace std::literals;
+
+	EXPECT_TRUE(ofmt::format(u"{player} got {count} coins", ofmt::arg(u"player", u"你好"sv), ofmt::arg(u"count", 3)) == u"你好 got 3 coins"sv);
+	EXPECT_TRUE(ofmt::format(u"{count}/{count}", ofmt::arg(u"count", 3)) == u"3/3"sv);
+	EXPECT_TRUE(ofmt::format(u"[{name,-6}][{value,6:.2f}]", ofmt::arg(u"value", 3.14159), ofmt::arg(u"name", "pi"sv)) == u"[pi    ][  3.14]"sv);
+
+	// named arguments take a positional slot as well
+	EXPECT_TRUE(ofmt::format(u"{0} {1} {玩家}", 1, ofmt::arg(u"玩家", u"😁"sv)) == u"1 😁 😁"sv);
+
+	// names only differ in the high byte of a code unit
+	EXPECT_TRUE(ofmt::format(u"{a}{š}", ofmt::arg(u"š", 1), ofmt::arg(u"a", 2)) == u"21"sv);
+	EXPECT_NE(ofmt::name_hash(u"a"), ofmt::name_hash(u"š"));
+
+	// escapes are kept
+	EXPECT_TRUE(ofmt::format(u"{{{name}}}", ofmt::arg(u"name", 1)) == u"{1}"sv);
+
+	// same hash, told apart by the name
+	EXPECT_EQ(ofmt::name_hash(u"gibpxcld"), ofmt::name_hash(u"wvfjhoar"));
+	EXPECT_TRUE(ofmt::format(u"{wvfjhoar}{gibpxcld}", ofmt::arg(u"gibpxcld", 1), ofmt::arg(u"wvfjhoar", 2)) == u"21"sv);
+}
+
+TEST(format, format_error)
+{
+	using namespace ostr;
+	using namespace std::literals;
+
+	// automatic and manual indices can not be mixed, the rest is kept as it is
+	std::u16string out;
+	EXPECT_FALSE(ofmt::format_to(out, u"a{}b{0}c", 1));
+	EXPECT_TRUE(out == u"a1b{0}c"sv);
+	EXPECT_TRUE(ofmt::format(u"a{0}b{}c", 1) == u"a1b{}c"sv);
+
+	// not closed
+	EXPECT_TRUE(ofmt::format(u"a{0,3", 1) == u"a{0,3"sv);
+
+	EXPECT_FALSE(ofmt::parsed_format(u"{}{0}").is_valid());
+	EXPECT_TRUE(ofmt::parsed_format(u"{0}{0}").is_valid());
+	EXPECT_TRUE(ofmt::parsed_format(u"{}{}").format(1, 2) == u"12"sv);
+
+	// a name not among the arguments is kept as written
+	out.clear();
+	EXPECT_FALSE(ofmt::format_to(out, u"{player} got {count,3:x}", ofmt::arg(u"player", 1)));
+	EXPECT_TRUE(out == u"1 got {count,3:x}"sv);
+	const ofmt::parsed_format missing(u"{player} got {count}");
+	EXPECT_TRUE(missing.is_valid());
+	out.clear();
+	EXPECT_FALSE(missing.format_to(out, ofmt::arg(u"count", 2)));
+	EXPECT_TRUE(out == u"{player} got 2"sv);
+	out.clear();
+	EXPECT_TRUE(missing.format_to(out, ofmt::arg(u"count", 2), ofmt::arg(u"player", 1)));
+}
+
+TEST(format, parsed_format)
+{
+	using namespace ostr;
+	using namespace std::literals;
+
+	{
+		const ofmt::parsed_format fmt(u"{player} got {count,3} coins{{}}", { u"player", u"count" });
+		EXPECT_TRUE(fmt.format(u"Tom"sv, 5) == u"Tom got   5 coins{}"sv);
+		EXPECT_TRUE(fmt.format(ofmt::arg(u"player", u"Tom"sv), ofmt::arg(u"count", 5)) == u"Tom got   5 coins{}"sv);
+	}
+	{
+		// resolved by hash when rendering
+		const ofmt::parsed_format fmt(u"{count:.1f} by {player}");
+		EXPECT_TRUE(fmt.format(ofmt::arg(u"player", u"Tom"sv), ofmt::arg(u"count", 0.25)) == u"0.2 by Tom"sv);
+		const ofmt::parsed_format collide(u"{wvfjhoar}{gibpxcld}", { u"gibpxcld" });
+		EXPECT_TRUE(collide.format(1, ofmt::arg(u"wvfjhoar", 2)) == u"21"sv);
+	}
+	{
+		const ofmt::parsed_format fmt(u"对{0}齐{0,-3}|");
+		std::u16string out = u">";
+		fmt.format_to(out, u"你好𪚥"sv);
+		EXPECT_TRUE(out == u">对你好𪚥齐你好𪚥|"sv);
+	}
+
+	{
+		const ofmt::parsed_format fmt(u"{0} says {1}");
+		auto t0 = std::chrono::system_clock::now();
+		for (int i = 0; i < 100000; ++i) {
+			std::u16string str = fmt.format(u"player"sv, i);
+		}
+		auto t1 = std::chrono::system_clock::now();
+		std::chrono::duration<float> delta = t1 - t0;
+		std::cout << delta.count() << std::endl;
+	}
+}
+
+TEST(format, chrono)
+{
+	using namespace ostr;
+	using namespace std::literals;
+	using namespace std::chrono;
+
+	const system_clock::time_point epoch{};
+	const auto t = time_point_cast<milliseconds>(epoch + seconds(1700000000) + milliseconds(42));
+
+	EXPECT_TRUE(ofmt::format(u"{0}", ofmt::utc(t)) == u"2023-11-14 22:13:20"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:%FT%T.%fZ}", ofmt::utc(t)) == u"2023-11-14T22:13:20.042Z"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:%a %A %b %B %j %u %w %z}", ofmt::utc(t)) == u"Tue Tuesday Nov November 318 2 2 +0000"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:%r %y/%C %%%6f}", ofmt::utc(t)) == u"10:13:20 PM 23/20 %042000"sv);
+	EXPECT_TRUE(ofmt::format(u"[{0,-12:%c}]", ofmt::utc(time_point_cast<seconds>(epoch))) == u"[Thu Jan  1 00:00:00 1970]"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:%F %T}", ofmt::utc(epoch - seconds(1))) == u"1969-12-31 23:59:59"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:%F}", ofmt::utc(epoch + hours(24 * (365 * 30 + 7 + 59)))) == u"2000-02-29"sv);
+
+	// cached rendering of the same minute only patches seconds and fractions
+	for (int i = 0; i < 120; i += 7)
+	{
+		// since 22:13:00.000
+		const int64_t ms = 20042 + i * 1001;
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "22:%02d:%02d.%03d", int(13 + ms / 60000), int(ms / 1000 % 60), int(ms % 1000));
+		const std::u16string expected(buffer, buffer + std::strlen(buffer));
+		EXPECT_TRUE(ofmt::format(u"{0:%T.%f}", ofmt::utc(t + milliseconds(i * 1001))) == expected);
+	}
+
+	// local time agrees with the c runtime
+	{
+		const std::time_t tt = 1700000000;
+		std::tm local{};
+#if defined(_WIN32)
+		localtime_s(&local, &tt);
+#else
+		localtime_r(&tt, &local);
+#endif
+		char buffer[64];
+		std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+		const std::u16string expected(buffer, buffer + std::strlen(buffer));
+		EXPECT_TRUE(ofmt::format(u"{0}", time_point_cast<seconds>(epoch + seconds(tt))) == expected);
+	}
+
+	EXPECT_TRUE(ofmt::format(u"{0} {1} {2} {3}", 42ms, 3s, 5min, duration<int, std::ratio<1, 3>>(2)) == u"42ms 3s 5min 2[1/3]s"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:%H:%M:%S.%f}", 90061042ms) == u"25:01:01.042"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:%M:%S.%3f}", -1500000us) == u"-00:01.500"sv);
+	EXPECT_TRUE(ofmt::format(u"{0:%Q %q}", 7ns) == u"7 ns"sv);
+	EXPECT_TRUE(ofmt::format(u"{0}", duration<double>(1.25)) == u"1.25s"sv);
+
+	{
+		const auto now = system_clock::now();
+		auto t0 = system_clock::now();
+		for (int i = 0; i < 100000; ++i) {
+			std::u16string str = ofmt::format(u"[{0:%F %T.%6f}] {1}", now + microseconds(i * 10), i);
+		}
+		auto t1 = system_clock::now();
+		std::chrono::duration<float> delta = t1 - t0;
+		std::cout << delta.count() << std::endl;
+	}
+}
+
+namespace {
+	// not trivially copyable, lives in place in the blob
+	struct inventory
+	{
+		std::string owner;
+		std::vector<int> items;
+	};
+}
+
+template<>
+struct ostr::ofmt::formatter<inventory>
+{
+	static bool format(const inventory& arg, std::u16string_view param, std::u16string& out)
+	{
+		out.append(arg.owner.cbegin(), arg.owner.cend());
+		out.push_back(u':');
+		for (int item : arg.items)
+			to_string(item, param, out);
+		return true;
+	}
+};
+
+TEST(format, deferred)
+{
+	using namespace ostr;
+	using namespace ostr::literal;
+	using namespace std::literals;
+
+	ofmt::deferred d;
+	{
+		// every source dies before rendering
+		std::string temp = "temp";
+		string name(u"你好𪚥");
+		std::u16string wide = u"wide";
+		d = ofmt::deferred(u"{0}|{1,-5}|{2,6:.2f}|{3}|{4}|{5}", temp, name, 3.14159, string_view(wide), wide, u"lit");
+	}
+	EXPECT_TRUE(d.render() == u"temp|你好𪚥 |  3.14|wide|wide|lit"_o);
+	EXPECT_EQ(d.render_utf8(), "temp|你好𪚥 |  3.14|wide|wide|lit");
+	EXPECT_TRUE(d.render().raw() == ofmt::format(u"{0}|{1,-5}|{2,6:.2f}|{3}|{4}|{5}", "temp"sv, u"你好𪚥"sv, 3.14159, u"wide"sv, u"wide"sv, u"lit"));
+
+	// utf-8 format, no arguments keeps the braces like format does
+	EXPECT_EQ(ofmt::deferred("{0} 点", 1).render_utf8(), "1 点");
+	EXPECT_EQ(ofmt::deferred(u"{0}").render_utf8(), "{0}");
+
+	{
+		std::u16string player = u"Tom";
+		ofmt::deferred named(u"{player} got {count,3} coins", ofmt::arg(u"count", 5), ofmt::arg(u"player", player));
+		player = u"Jerry";
+		EXPECT_TRUE(named.render() == u"Tom got   5 coins"_o);
+
+		// c strings of every width and strings of any allocator are copied inline
+		wchar_t wide[] = L"abc";
+		char32_t utf32[] = U"xyz";
+		const wchar_t* wide_ptr = wide;
+		const char32_t* utf32_ptr = utf32;
+		ofmt::deferred pointers(u"{0}{1}{2}", wide_ptr, utf32_ptr, u"c"_o);
+		wide[0] = L'?';
+		utf32[0] = U'?';
+		EXPECT_TRUE(pointers.render() == u"abcxyzc"_o);
+		static_assert(ofmt::is_string_v<const wchar_t*> && ofmt::is_string_v<const char32_t*>);
+		static_assert(ofmt::is_string_v<pmr::string>);
+		std::pmr::monotonic_buffer_resource arena;
+		std::optional<ofmt::deferred> from_arena;
+		{
+			const pmr::string str(u"玩家😘"_o, &arena);
+			from_arena.emplace(u"[{0}]", str);
+		}
+		EXPECT_TRUE(from_arena->render() == u"[玩家😘]"_o);
+
+		// names are kept in the blob, same hash is not enough
+		ofmt::deferred collide(u"{wvfjhoar}{gibpxcld}", ofmt::arg(u"gibpxcld", 1), ofmt::arg(u"wvfjhoar", std::u16string(u"long enough to leave sso")));
+		ofmt::deferred copy = collide;
+		EXPECT_TRUE(copy.render() == u"long enough to leave sso1"_o);
+	}
+
+	{
+		ofmt::deferred src(u"{0} {1}", inventory{ "bag", { 1, 2, 3 } }, 7);
+		ofmt::deferred copy = src;
+		ofmt::deferred moved = std::move(src);
+		EXPECT_TRUE(src.empty());
+		EXPECT_TRUE(copy.render() == u"bag:123 7"_o);
+		EXPECT_TRUE(moved.render() == u"bag:123 7"_o);
+	}
+
+	{
+		// captured here, rendered on another thread
+		std::vector<ofmt::deferred> records;
+		for (int i = 0; i < 3; ++i)
+			records.emplace_back(u"record {0}: {1}", i, std::u16string(i + 1, u'x'));
+		std::string out;
+		std::thread([&]()
+			{
+				for (const auto& record : records)
+				{
+					record.render_to(out);
+					out.push_back(';');
+				}
+			}).join();
+		EXPECT_EQ(out, "record 0: x;record 1: xx;record 2: xxx;");
+	}
+
+	{
+		const string name(u"player");
+		auto t0 = std::chrono::system_clock::now();
+		for (int i = 0; i < 100000; ++i) {
+			ofmt::deferred record(u"{0} moved to {1}, {2}", name, i, 0.5 * i);
+		}
+		auto t1 = std::chrono::system_clock::now();
+		std::chrono::duration<float> delta = t1 - t0;
+		std::cout << delta.count() << std::endl;
+	}
+}
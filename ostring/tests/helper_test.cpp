@@ -1,9 +1,16 @@
 
 #include <gtest/gtest.h>
 #include <string_view>
+#include <climits>
+#include <chrono>
+#include <iostream>
 
 #include "ostring/types.h"
 #include "ostring/helpers.h"
+#include "ostring/coder.h"
+#include "ostring/detect.h"
+#include "ostring/gb18030.h"
+#include "ostring/ostr.h"
 
 
 TEST(helper, lowercase)
@@ -168,6 +175,653 @@ TEST(helper, convert_utf8_to_utf32)
 	}
 }
 
+TEST(helper, incremental_transcoder)
+{
+	using namespace ostr;
+
+	// every sequence length, ill-formed bytes, and a sequence cut by the end
+	const std::string bytes = u8"a我™𪚥😘" "\xC0\xAF" "b\xED\xA0\x80" "c\xF0\x9F\x98" "d" u8"中😘" "\xE4\xB8";
+	std::u16string expected;
+	coder::convert_append(bytes, expected);
+	EXPECT_EQ(expected, u"a我™𪚥😘\uFFFD\uFFFDb\uFFFD\uFFFD\uFFFDc\uFFFDd中😘\uFFFD");
+
+	{
+		// split in two at every byte, then in three
+		for (size_t i = 0; i <= bytes.size(); ++i)
+		{
+			for (size_t j = i; j <= bytes.size(); ++j)
+			{
+				coder::utf8_decoder decoder;
+				std::u16string out;
+				decoder.feed(std::string_view(bytes).substr(0, i), out);
+				decoder.feed(std::string_view(bytes).substr(i, j - i), out);
+				decoder.feed(std::string_view(bytes).substr(j), out);
+				EXPECT_EQ(decoder.pending(), 2u);
+				decoder.finish(out);
+				EXPECT_EQ(out, expected) << i << " " << j;
+				EXPECT_EQ(decoder.pending(), 0u);
+			}
+		}
+	}
+
+	{
+		// a byte at a time into a caller buffer
+		coder::utf8_decoder decoder;
+		std::u16string out(coder::utf16_capacity(bytes.size()), u'\0');
+		size_t written = 0;
+		for (const char c : bytes)
+			written += decoder.feed(std::string_view(&c, 1), out.data() + written);
+		written += decoder.finish(out.data() + written);
+		out.resize(written);
+		EXPECT_EQ(out, expected);
+	}
+
+	{
+		const std::u16string text = u"a我😘" + std::u16string(1, u'\xD83D') + u"b" + u"𪚥" + std::u16string(1, u'\xDE18') + u"c😘";
+		std::string whole;
+		coder::convert_append(text, whole);
+		EXPECT_EQ(whole, "a我😘\xEF\xBF\xBD" "b𪚥\xEF\xBF\xBD" "c😘");
+
+		for (size_t i = 0; i <= text.size(); ++i)
+		{
+			coder::utf16_encoder encoder;
+			std::string out;
+			encoder.feed(std::u16string_view(text).substr(0, i), out);
+			encoder.feed(std::u16string_view(text).substr(i), out);
+			encoder.finish(out);
+			EXPECT_EQ(out, whole) << i;
+		}
+
+		coder::utf16_encoder encoder;
+		std::string out;
+		encoder.feed(u"x" + std::u16string(1, u'\xD83D'), out);
+		EXPECT_EQ(encoder.pending(), 1u);
+		encoder.finish(out);
+		EXPECT_EQ(out, "x\xEF\xBF\xBD");
+	}
+}
+
+TEST(helper, exact_length_transcoder)
+{
+	using namespace ostr;
+
+	std::u16string text;
+	for (int i = 0; i < 50; ++i)
+		text += u"ascii run of sixteen+ " + std::u16string(i % 5, u'é') + u"我™𪚥😘";
+	text += std::u16string(1, u'\xD83D') + u"x" + std::u16string(1, u'\xDE18');
+	std::string bytes;
+	coder::convert_append(text, bytes);
+	bytes += "\xC0\xAF" "\xF0\x9F\x98";
+
+	std::u16string decoded;
+	coder::convert_append(bytes, decoded);
+	EXPECT_EQ(coder::utf16_length_from_utf8(bytes), decoded.size());
+	EXPECT_EQ(coder::utf8_length_from_utf16(text), bytes.size() - 5);
+	for (size_t i = 0; i < 40; ++i)
+	{
+		std::string part;
+		coder::convert_append(std::u16string_view(text).substr(i, 29), part);
+		EXPECT_EQ(coder::utf8_length_from_utf16(std::u16string_view(text).substr(i, 29)), part.size());
+	}
+
+	{
+		// an exact buffer takes all, smaller ones take whole code points and resume
+		std::u16string out(coder::utf16_length_from_utf8(bytes), u'\0');
+		const coder::transcode_result all = coder::convert_into(bytes, out.data(), out.size());
+		EXPECT_EQ(all.read, bytes.size());
+		EXPECT_EQ(out, decoded);
+
+		for (size_t capacity : { size_t(1), size_t(2), size_t(3), size_t(17) })
+		{
+			std::u16string joined;
+			std::string_view rest = bytes;
+			char16_t buffer[17];
+			while (!rest.empty())
+			{
+				const coder::transcode_result result = coder::convert_into(rest, buffer, capacity);
+				if (result.read == 0)
+					break;
+				joined.append(buffer, result.written);
+				rest.remove_prefix(result.read);
+			}
+			if (capacity >= 2)
+				EXPECT_EQ(joined, decoded);
+			else
+				EXPECT_EQ(rest.substr(0, 4), u8"𪚥"); // a pair never fits
+		}
+
+		for (size_t capacity : { size_t(3), size_t(4), size_t(5), size_t(64) })
+		{
+			std::string joined;
+			std::u16string_view rest = text;
+			char buffer[64];
+			while (!rest.empty())
+			{
+				const coder::transcode_result result = coder::convert_into(rest, buffer, capacity);
+				if (result.read == 0)
+					break;
+				joined.append(buffer, result.written);
+				rest.remove_prefix(result.read);
+			}
+			if (capacity >= 4)
+				EXPECT_EQ(joined, bytes.substr(0, bytes.size() - 5));
+			else
+				EXPECT_EQ(rest.substr(0, 2), u"𪚥");
+		}
+	}
+}
+
+TEST(helper, validate_utf)
+{
+	using namespace ostr;
+
+	EXPECT_TRUE(coder::is_valid_utf8(u8"ascii 我™𪚥😘"));
+	EXPECT_EQ(coder::find_invalid_utf8("ab\xC0\xAF"), 2u);          // overlong
+	EXPECT_EQ(coder::find_invalid_utf8("ab\xE0\x80\xAF"), 2u);      // overlong
+	EXPECT_EQ(coder::find_invalid_utf8("abc\xED\xA0\x80"), 3u);     // surrogate
+	EXPECT_EQ(coder::find_invalid_utf8("\xF4\x90\x80\x80"), 0u);   // past U+10FFFF
+	EXPECT_EQ(coder::find_invalid_utf8("a\x80"), 1u);              // stray continuation
+	EXPECT_EQ(coder::find_invalid_utf8("\xE4\xB8\xAD\xE4\xB8"), 3u); // cut by the end
+	EXPECT_EQ(coder::find_invalid_utf16(u"a😘b"), SIZE_MAX);
+	EXPECT_EQ(coder::find_invalid_utf16(u"abcdefghi" + std::u16string(1, u'\xDE18')), 9u);
+	EXPECT_EQ(coder::find_invalid_utf16(u"a" + std::u16string(1, u'\xD83D')), 1u);
+
+	{
+		// a stray continuation byte no longer reads as a sequence of 0 bytes
+		small_size_t length;
+		char32_t value;
+		const char stray[] = "\x80" "a";
+		helper::codepoint::utf8_to_utf32(reinterpret_cast<const char8_t*>(stray), length, value);
+		EXPECT_EQ(length, 1);
+		EXPECT_EQ(value, U'\xFFFD');
+		const char cut[] = "\xE4\xB8";
+		helper::codepoint::utf8_to_utf32(reinterpret_cast<const char8_t*>(cut), length, value);
+		EXPECT_EQ(length, 2);
+		EXPECT_EQ(value, U'\xFFFD');
+	}
+
+	{
+		// the validators against the strict decoder, long enough for the simd blocks and their seams
+		const unsigned char alphabet[] = { 'a', 'b', 0x80, 0x9F, 0xA0, 0xBF, 0xC0, 0xC2, 0xDF, 0xE0, 0xE4, 0xED, 0xEF, 0xF0, 0xF4, 0xF5, 0xFF };
+		uint32_t seed = 12345;
+		std::u16string buffer(128, u'\0');
+		for (int n = 0; n < 20000; ++n)
+		{
+			std::string bytes;
+			const size_t size = n % 97;
+			for (size_t i = 0; i < size; ++i)
+			{
+				seed = seed * 1103515245 + 12345;
+				// mostly well-formed text with some noise
+				if ((seed >> 16) % 8 != 0)
+					bytes += (seed >> 8) % 3 == 0 ? u8"😘" : (seed >> 8) % 3 == 1 ? u8"中" : "x";
+				else
+					bytes += char(alphabet[(seed >> 16) % sizeof(alphabet)]);
+			}
+			const coder::transcode_result strict = coder::decode_utf8(bytes, buffer.data(), true, coder::error_policy::strict);
+			ASSERT_EQ(coder::find_invalid_utf8(bytes), strict.ill_formed ? strict.read : SIZE_MAX) << n;
+			ASSERT_EQ(strict.ill_formed, strict.read != bytes.size());
+		}
+	}
+
+	{
+		const std::u16string lone = u"a" + std::u16string(1, u'\xD83D') + u"b" + std::u16string(1, u'\xDE18');
+
+		// strict stops before the error
+		char out[32];
+		coder::transcode_result result = coder::encode_utf8(lone, out, true, coder::error_policy::strict);
+		EXPECT_TRUE(result.ill_formed);
+		EXPECT_EQ(result.read, 1u);
+		EXPECT_EQ(result.written, 1u);
+		EXPECT_EQ(coder::utf8_length_from_utf16(lone, coder::error_policy::strict), 1u);
+
+		// passed through as WTF-8, and back
+		result = coder::encode_utf8(lone, out, true, coder::error_policy::pass_through);
+		EXPECT_TRUE(result.ill_formed);
+		const std::string wtf8(out, result.written);
+		EXPECT_EQ(wtf8, "a\xED\xA0\xBD" "b\xED\xB8\x98");
+		char16_t back[32];
+		result = coder::decode_utf8(wtf8, back, true, coder::error_policy::pass_through);
+		EXPECT_TRUE(result.ill_formed);
+		EXPECT_EQ(std::u16string(back, result.written), lone);
+		EXPECT_EQ(coder::utf16_length_from_utf8(wtf8, coder::error_policy::pass_through), lone.size());
+
+		// replaced by default
+		result = coder::decode_utf8(wtf8, back);
+		EXPECT_TRUE(result.ill_formed);
+		EXPECT_EQ(std::u16string(back, result.written), u"a\uFFFD\uFFFD\uFFFDb\uFFFD\uFFFD\uFFFD");
+		result = coder::decode_utf8(u8"fine", back);
+		EXPECT_FALSE(result.ill_formed);
+	}
+
+	{
+		// validating first, against transcoding alone
+		std::string text;
+		for (int i = 0; i < 20000; ++i)
+			text += u8"mostly ascii text, 一些中文 and 😘 ";
+		std::u16string out(coder::utf16_capacity(text.size()), u'\0');
+		size_t sink = 0;
+
+		auto t0 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20; ++n)
+			sink += coder::decode_utf8(text, out.data()).written;
+		auto t1 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20; ++n)
+		{
+			if (coder::is_valid_utf8(text))
+				sink += coder::decode_utf8(text, out.data()).written;
+		}
+		auto t2 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20; ++n)
+			sink += coder::find_invalid_utf8(text) == SIZE_MAX;
+		auto t3 = std::chrono::system_clock::now();
+
+		std::chrono::duration<float> delta_decode = t1 - t0;
+		std::chrono::duration<float> delta_both = t2 - t1;
+		std::chrono::duration<float> delta_validate = t3 - t2;
+		std::cout << delta_decode.count() << " " << delta_both.count() << " " << delta_validate.count() << std::endl;
+		EXPECT_GT(sink, 0u);
+	}
+}
+
+TEST(helper, utf32_transcoder)
+{
+	using namespace ostr;
+
+	const std::u32string u32 = U"aé中\U0002A6A5\U0001F601 plain ascii text long enough for blocks";
+	const std::u16string u16 = u"aé中\U0002A6A5\U0001F601 plain ascii text long enough for blocks";
+	const std::string u8 = u8"aé中\U0002A6A5\U0001F601 plain ascii text long enough for blocks";
+
+	// every pair of forms, appended after what is there
+	{
+		std::u32string from8 = U">", from16 = U">";
+		coder::convert_append(u8, from8);
+		coder::convert_append(u16, from16);
+		EXPECT_EQ(from8, U">" + u32);
+		EXPECT_EQ(from16, U">" + u32);
+
+		std::u16string to16 = u">";
+		std::string to8 = ">";
+		coder::convert_append(u32, to16);
+		coder::convert_append(u32, to8);
+		EXPECT_EQ(to16, u">" + u16);
+		EXPECT_EQ(to8, ">" + u8);
+	}
+
+	// invalid values as U+FFFD, lone surrogates in utf-16 too
+	{
+		const std::u32string bad = { U'a', 0xD800, U'b', 0x110000, 0xFFFFFFFF, 0xDFFF, U'c', U'd', U'e' };
+		std::u16string to16;
+		std::string to8;
+		coder::convert_append(bad, to16);
+		coder::convert_append(bad, to8);
+		EXPECT_EQ(to16, u"a�b���cde");
+		EXPECT_EQ(to8, u8"a�b���cde");
+
+		const std::u16string lone = { u'a', 0xDC00, 0xD800, u'b', 0xD83D, 0xDE01, u'c', u'd', u'e', u'f', u'g', 0xD800 };
+		std::u32string from16;
+		coder::convert_append(lone, from16);
+		EXPECT_EQ(from16, U"a��b\U0001F601cdefg�");
+	}
+
+	// ostr::string from and to utf-32 and wide chars, non-BMP kept whole
+	{
+		const string str(u32);
+		EXPECT_EQ(str.raw(), u16);
+		EXPECT_EQ(str.length(), u32.size());
+		EXPECT_EQ(string(u32.c_str()).raw(), u16);
+		EXPECT_EQ(string(std::u32string_view(u32)).raw(), u16);
+
+		std::u32string back;
+		EXPECT_TRUE(str.encode_to_utf32(back));
+		EXPECT_EQ(back, u32);
+
+		const std::wstring wide = L"aé中\U0002A6A5\U0001F601 plain ascii text long enough for blocks";
+		const string from_wide(wide);
+		EXPECT_EQ(from_wide.raw(), u16);
+		EXPECT_EQ(from_wide.length(), u32.size());
+		EXPECT_EQ(string(wide.c_str()).raw(), u16);
+		std::wstring wide_back;
+		EXPECT_TRUE(from_wide.encode_to_wide(wide_back));
+		EXPECT_EQ(wide_back, wide);
+
+		string from_utf8;
+		from_utf8.decode_from_utf8(u8);
+		EXPECT_EQ(from_utf8.length(), u32.size());
+	}
+
+	// benchmark: widening and narrowing against a loop over code points
+	{
+		std::u16string text;
+		for (int i = 0; i < 20000; ++i)
+			text += i % 64 == 0 ? u"中文\U0001F601" : u"ascii text ";
+		std::u32string wide;
+		std::u16string narrow;
+		size_t sink = 0;
+
+		auto t0 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20; ++n)
+		{
+			wide.clear();
+			coder::convert_append(text, wide);
+			narrow.clear();
+			coder::convert_append(wide, narrow);
+			sink += narrow.size();
+		}
+		auto t1 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20; ++n)
+		{
+			wide.clear();
+			for (size_t i = 0; i < text.size();)
+			{
+				small_size_t length;
+				char32_t c;
+				helper::codepoint::utf16_to_utf32(text.data() + i, length, c);
+				wide.push_back(c);
+				i += length;
+			}
+			narrow.clear();
+			for (const char32_t c : wide)
+			{
+				if (c > 0xFFFF)
+				{
+					narrow.push_back(char16_t(((c - 0x10000) >> 10) + 0xD800));
+					narrow.push_back(char16_t(((c - 0x10000) & 0x3FF) + 0xDC00));
+				}
+				else
+				{
+					narrow.push_back(char16_t(c));
+				}
+			}
+			sink += narrow.size();
+		}
+		auto t2 = std::chrono::system_clock::now();
+
+		EXPECT_EQ(narrow, text);
+		std::chrono::duration<float> delta_simd = t1 - t0;
+		std::chrono::duration<float> delta_loop = t2 - t1;
+		std::cout << delta_simd.count() << " " << delta_loop.count() << std::endl;
+		EXPECT_GT(sink, 0u);
+	}
+}
+
+TEST(helper, utf16_bytes)
+{
+	using namespace ostr;
+
+	// the endian parameter of the code point helpers
+	{
+		const char16_t be[] = { 0x3DD8, 0x01DE, 0 };
+		small_size_t length;
+		char32_t value;
+		helper::codepoint::utf16_to_utf32(be, length, value, endian::native == endian::little ? endian::big : endian::little);
+		EXPECT_EQ(value, U'\U0001F601');
+		EXPECT_EQ(length, 2);
+		helper::codepoint::utf16_to_utf32(u"我", length, value);
+		EXPECT_EQ(value, U'我');
+	}
+
+	// every block size and tail, odd positions for a pair cut between blocks
+	const std::u16string text = u"ascii 中文 \U0001F601\U0002A6A5 more ascii to fill blocks\U0001F601";
+	for (size_t n = 0; n <= text.size(); ++n)
+	{
+		const std::u16string_view head(text.data(), n);
+		for (const endian e : { endian::big, endian::little })
+		{
+			std::string bytes;
+			coder::append_utf16_bytes(head, e, bytes);
+			ASSERT_EQ(bytes.size(), n * 2);
+
+			std::u16string back = u">";
+			const size_t pairs = coder::append_utf16_bytes(bytes, e, back);
+			EXPECT_EQ(back, u">" + std::u16string(head));
+			EXPECT_EQ(pairs, helper::string::count_surrogate_pair(head.begin(), head.end()));
+		}
+	}
+
+	// big endian bytes are the high byte first
+	{
+		std::string bytes;
+		coder::append_utf16_bytes(u"A中", endian::big, bytes, true);
+		EXPECT_EQ(bytes, std::string("\xFE\xFF\x00\x41\x4E\x2D", 6));
+		bytes.clear();
+		coder::append_utf16_bytes(u"A中", endian::little, bytes, true);
+		EXPECT_EQ(bytes, std::string("\xFF\xFE\x41\x00\x2D\x4E", 6));
+	}
+
+	// the byte order mark, big endian without one
+	{
+		std::string_view bytes("\xFF\xFE\x41\x00", 4);
+		EXPECT_EQ(coder::take_utf16_bom(bytes), endian::little);
+		EXPECT_EQ(bytes.size(), 2u);
+		EXPECT_EQ(coder::take_utf16_bom(bytes), endian::big);
+		EXPECT_EQ(bytes.size(), 2u);
+		EXPECT_EQ(coder::take_utf16_bom(bytes, endian::little), endian::little);
+	}
+
+	// ostr::string from raw bytes, the mark wins, pairs counted without another pass
+	{
+		std::string bytes;
+		string_view(text).encode_to_utf16_bytes(bytes, endian::little, true);
+		const string str(bytes, endian::big);
+		EXPECT_EQ(str.raw(), text);
+		EXPECT_EQ(str.length(), string(text).length());
+
+		// a pair split between two appends
+		std::string lead_bytes, trail_bytes;
+		coder::append_utf16_bytes(u"a\xD83D", endian::big, lead_bytes);
+		coder::append_utf16_bytes(u"\xDE01" "b", endian::big, trail_bytes);
+		string joined;
+		EXPECT_TRUE(joined.decode_from_utf16_bytes(lead_bytes));
+		EXPECT_FALSE(joined.decode_from_utf16_bytes(trail_bytes + "!"));
+		EXPECT_EQ(joined.raw(), u"a\U0001F601b");
+		EXPECT_EQ(joined.length(), 3u);
+	}
+}
+
+TEST(helper, gb18030)
+{
+	using namespace ostr;
+
+	auto encode = [](std::u16string_view text) {
+		std::string gb;
+		coder::convert_append_gb18030(text, gb);
+		return gb;
+	};
+	auto decode = [](std::string_view gb) {
+		std::u16string text;
+		coder::convert_append_gb18030(gb, text);
+		return text;
+	};
+
+	// one, two and four byte codes, as python's gb18030 codec gives them
+	{
+		EXPECT_EQ(encode(u"abc中文€é"), std::string("abc\xD6\xD0\xCE\xC4\xA2\xE3\xA8\xA6"));
+		EXPECT_EQ(encode(u"\u0080"), std::string("\x81\x30\x81\x30"));
+		EXPECT_EQ(encode(u"￿"), std::string("\x84\x31\xA4\x39"));
+		EXPECT_EQ(encode(u"�"), std::string("\x84\x31\xA4\x37"));
+		EXPECT_EQ(encode(u""), std::string("\xA3\xA0"));
+		EXPECT_EQ(encode(u"\U00010000"), std::string("\x90\x30\x81\x30"));
+		EXPECT_EQ(encode(u"\U0010FFFF"), std::string("\xE3\x32\x9A\x35"));
+		EXPECT_EQ(decode("abc\xD6\xD0\xCE\xC4\xA2\xE3\xA8\xA6"), u"abc中文€é");
+		EXPECT_EQ(decode("\x90\x30\x81\x30\xE3\x32\x9A\x35"), u"\U00010000\U0010FFFF");
+	}
+
+	// the whole first plane and a part of the others round trip
+	{
+		std::u16string all;
+		for (char32_t c = 1; c <= 0xFFFF; ++c)
+		{
+			if (c < 0xD800 || c > 0xDFFF)
+				all.push_back(char16_t(c));
+		}
+		all += u"\U00010000\U0002A6A5\U0001F601\U0010FFFF";
+		const std::string gb = encode(all);
+		coder::transcode_result result = { 0, 0 };
+		std::u16string back(all.size(), u'\0');
+		result = coder::decode_gb18030(gb, back.data(), true, coder::error_policy::strict);
+		EXPECT_FALSE(result.ill_formed);
+		EXPECT_EQ(result.read, gb.size());
+		back.resize(result.written);
+		EXPECT_EQ(back, all);
+	}
+
+	// invalid bytes one U+FFFD each, the byte after a bad lead starts over
+	{
+		EXPECT_EQ(decode("a\x80" "b\xFF" "c"), u"a�b�c");
+		EXPECT_EQ(decode("\x81 \x81\x30 \x81\x30\x81 "), u"� �0 �0� ");
+		EXPECT_EQ(decode("\x84\x31\xA5\x30" "a"), u"�a");
+		EXPECT_EQ(decode("\xD6"), u"�");
+		EXPECT_EQ(encode(u"a\xD800" "b\xDC00"), std::string("a\x84\x31\xA4\x37" "b\x84\x31\xA4\x37"));
+
+		const std::string bad("ab\x80" "cd", 5);
+		std::u16string out(bad.size(), u'\0');
+		const coder::transcode_result result = coder::decode_gb18030(bad, out.data(), true, coder::error_policy::strict);
+		EXPECT_TRUE(result.ill_formed);
+		EXPECT_EQ(result.read, 2u);
+		EXPECT_EQ(result.written, 2u);
+	}
+
+	// streaming, every cut of the input
+	{
+		const std::u16string text = u"gbk 中文 \U0001F601 four \u0080 bytes \U0010FFFF end";
+		const std::string gb = encode(text);
+		for (size_t piece = 1; piece <= 7; ++piece)
+		{
+			coder::gb18030_decoder decoder;
+			std::u16string decoded;
+			for (size_t i = 0; i < gb.size(); i += piece)
+				decoder.feed(std::string_view(gb).substr(i, piece), decoded);
+			decoder.finish(decoded);
+			EXPECT_EQ(decoded, text);
+
+			coder::gb18030_encoder encoder;
+			std::string encoded;
+			for (size_t i = 0; i < text.size(); i += piece)
+				encoder.feed(std::u16string_view(text).substr(i, piece), encoded);
+			encoder.finish(encoded);
+			EXPECT_EQ(encoded, gb);
+		}
+
+		coder::gb18030_decoder decoder;
+		std::u16string decoded;
+		decoder.feed("a\x81\x30", decoded);
+		EXPECT_EQ(decoder.pending(), 2u);
+		decoder.finish(decoded);
+		EXPECT_EQ(decoded, u"a�0");
+	}
+
+	// ostr::string in and out
+	{
+		string str;
+		str.decode_from_gb18030("\xD6\xD0\xCE\xC4\x95\x32\x82\x36");
+		EXPECT_EQ(str.raw(), u"中文\U00020000");
+		EXPECT_EQ(str.length(), 3u);
+		std::string gb;
+		EXPECT_TRUE(str.encode_to_gb18030(gb));
+		EXPECT_EQ(gb, std::string("\xD6\xD0\xCE\xC4\x95\x32\x82\x36"));
+	}
+
+	// benchmark: ascii heavy text, both ways
+	{
+		std::u16string text;
+		for (int i = 0; i < 40000; ++i)
+			text += i % 32 == 0 ? u"中文日志 " : u"plain log line ";
+		const std::string gb = encode(text);
+		std::u16string decoded(text.size(), u'\0');
+		std::string encoded(coder::gb18030_capacity(text.size()), '\0');
+		size_t sink = 0;
+
+		auto t0 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20; ++n)
+			sink += coder::decode_gb18030(gb, decoded.data()).written;
+		auto t1 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20; ++n)
+			sink += coder::encode_gb18030(text, encoded.data()).written;
+		auto t2 = std::chrono::system_clock::now();
+
+		std::chrono::duration<float> delta_decode = t1 - t0;
+		std::chrono::duration<float> delta_encode = t2 - t1;
+		const float gigabytes = float(gb.size()) * 20 / 1e9f;
+		std::cout << gigabytes / delta_decode.count() << " " << gigabytes / delta_encode.count() << " GB/s" << std::endl;
+		EXPECT_GT(sink, 0u);
+	}
+}
+
+TEST(helper, detect)
+{
+	using namespace ostr;
+	using coder::encoding;
+
+	std::u16string text;
+	for (int i = 0; i < 200; ++i)
+		text += i % 3 == 0 ? u"中文的日志，没有声明编码。" : u"plain line of a log file\n";
+
+	std::string u8, gb, le, be;
+	coder::convert_append(text, u8);
+	coder::convert_append_gb18030(text, gb);
+	coder::append_utf16_bytes(text, endian::little, le);
+	coder::append_utf16_bytes(text, endian::big, be);
+
+	// byte order marks win
+	{
+		EXPECT_EQ(coder::detect("\xEF\xBB\xBF" "abc").detected, encoding::utf8);
+		EXPECT_EQ(coder::detect("\xEF\xBB\xBF" "abc").bom_size, 3u);
+		EXPECT_EQ(coder::detect(std::string_view("\xFF\xFE" "a\0", 4)).detected, encoding::utf16le);
+		EXPECT_EQ(coder::detect(std::string_view("\xFE\xFF\0a", 4)).detected, encoding::utf16be);
+		EXPECT_EQ(coder::detect(std::string_view("\xFE\xFF\0a", 4)).confidence, 100);
+	}
+
+	// every encoding of the same text, whole and cut anywhere by the sample
+	for (const size_t sample : { size_t(64), size_t(1001), size_t(1002), size_t(1003), coder::default_detect_sample })
+	{
+		EXPECT_EQ(coder::detect(u8, sample).detected, encoding::utf8) << sample;
+		EXPECT_EQ(coder::detect(gb, sample).detected, encoding::gb18030) << sample;
+		EXPECT_EQ(coder::detect(le, sample).detected, encoding::utf16le) << sample;
+		EXPECT_EQ(coder::detect(be, sample).detected, encoding::utf16be) << sample;
+	}
+	EXPECT_GT(coder::detect(gb).confidence, 50);
+
+	// nothing to tell
+	{
+		EXPECT_EQ(coder::detect("").detected, encoding::unknown);
+		EXPECT_EQ(coder::detect("plain ascii").detected, encoding::utf8);
+		EXPECT_EQ(coder::detect(std::string_view("\x7F" "ELF\x02\x01\x01\0\0\0\0\0\0\0\0\0\x03\0\x3E\0", 20)).detected, encoding::unknown);
+		EXPECT_EQ(coder::detect("\xFF\x80\xFF\x80\xC0\xAF").detected, encoding::unknown);
+	}
+
+	// the guess goes straight to decoding
+	for (const std::string* bytes : { &u8, &gb, &le, &be })
+	{
+		string str;
+		EXPECT_TRUE(str.decode_from(*bytes, coder::detect(*bytes)));
+		EXPECT_EQ(str.raw(), text);
+	}
+	{
+		std::string marked;
+		coder::append_utf16_bytes(text, endian::big, marked, true);
+		string str;
+		EXPECT_TRUE(str.decode_from(marked, coder::detect(marked)));
+		EXPECT_EQ(str.raw(), text);
+		EXPECT_FALSE(str.decode_from("abc", coder::detection()));
+	}
+
+	// benchmark: the default sample of each
+	{
+		size_t sink = 0;
+		auto t0 = std::chrono::system_clock::now();
+		for (int n = 0; n < 1000; ++n)
+		{
+			for (const std::string* bytes : { &u8, &gb, &le, &be })
+				sink += size_t(coder::detect(*bytes).detected);
+		}
+		auto t1 = std::chrono::system_clock::now();
+		std::chrono::duration<float> delta = t1 - t0;
+		std::cout << delta.count() << std::endl;
+		EXPECT_GT(sink, 0u);
+	}
+}
+
 TEST(helper, crc32)
 {
 	using namespace ostr::helper::hash;
@@ -191,6 +845,12 @@ TEST(helper, from_int)
 	EXPECT_TRUE(istr == "678");
 	from_int(-678, istr);
 	EXPECT_TRUE(istr == "-678");
+	from_int(INT_MIN, istr);
+	EXPECT_TRUE(istr == "-2147483648");
+
+	std::u16string u16str;
+	append_int(INT64_MAX, u16str);
+	EXPECT_TRUE(u16str == u"9223372036854775807");
 }
 
 TEST(helper, from_float)
@@ -200,4 +860,13 @@ TEST(helper, from_float)
 	std::string fstr;
 	from_float_round(3.141, fstr);
 	EXPECT_TRUE(fstr == "3.141");
+	from_float_round(3e20f, fstr);
+	EXPECT_TRUE(fstr == "3e+20");
+
+	std::u16string u16str;
+	append_float(0.30000000000000004, u16str);
+	EXPECT_TRUE(u16str == u"0.30000000000000004");
+	u16str.clear();
+	append_float(2.5, u16str, ostr::float_format::fixed, 3);
+	EXPECT_TRUE(u16str == u"2.500");
 }
\ No newline at end of file
@@ -0,0 +1,462 @@
+
+#include <gtest/gtest.h>
+
+#include "ostring/mapped_text.h"
+#include "ostring/reader.h"
+#include "ostring/writer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define OSTR_TEST_FILENO _fileno
+#else
+#define OSTR_TEST_FILENO fileno
+#endif
+
+namespace {
+
+	// an anonymous file removed on close
+	struct temp_file
+	{
+		std::FILE* file = std::tmpfile();
+
+		~temp_file()
+		{
+			std::fclose(file);
+		}
+
+		int fd() const
+		{
+			return OSTR_TEST_FILENO(file);
+		}
+
+		void put(std::string_view bytes)
+		{
+			std::fwrite(bytes.data(), 1, bytes.size(), file);
+			std::fflush(file);
+			std::fseek(file, 0, SEEK_SET);
+		}
+
+		std::string content() const
+		{
+			std::string ans;
+			std::fseek(file, 0, SEEK_SET);
+			char buffer[4096];
+			size_t n;
+			while ((n = std::fread(buffer, 1, sizeof(buffer), file)) != 0)
+				ans.append(buffer, n);
+			return ans;
+		}
+	};
+
+	std::string to_utf8(std::u16string_view str)
+	{
+		std::string ans;
+		EXPECT_TRUE(ostr::string_view(str).encode_to_utf8(ans));
+		return ans;
+	}
+}
+
+TEST(io, u8_writer)
+{
+	using namespace ostr;
+	using namespace ostr::literal;
+
+	{
+		temp_file file;
+		{
+			u8_writer out(file.fd());
+			out.write(u"我™C"_o).write(string(u"𪚥😘")) << u"!"_o;
+			out.format(u" {0} got {1,3} coins\n", u"玩家"_o, 3);
+			out.write_utf8("raw utf-8 ✓");
+			EXPECT_EQ(out.bytes_written(), 0u);
+		}
+		EXPECT_EQ(file.content(), "我™C𪚥😘! 玩家 got   3 coins\nraw utf-8 ✓");
+	}
+
+	{
+		// surrogate pairs split between writes, and a lead never completed
+		const char16_t emoji[] = u"😘";
+		temp_file file;
+		{
+			u8_writer out(file.fd());
+			out.write(std::u16string_view(emoji, 1));
+			out.flush();
+			out.write(std::u16string_view(emoji + 1, 1));
+			out.write(std::u16string_view(emoji, 1));
+			out.write(u"a"_o);
+			out.write(std::u16string_view(emoji, 1));
+		}
+		EXPECT_EQ(file.content(), "😘\xEF\xBF\xBD" "a\xEF\xBF\xBD");
+	}
+
+	{
+		// much larger than the buffer, pairs across every flush
+		std::u16string text;
+		for (int i = 0; i < 5000; ++i)
+			text += u"ab😘中";
+		const std::string big_raw(300, 'x');
+
+		temp_file file;
+		{
+			u8_writer out(file.fd(), 100);
+			for (size_t i = 0; i < text.size(); i += 7)
+				out.write(std::u16string_view(text).substr(i, 7));
+			out.write_utf8(big_raw);
+			out.write(text);
+			EXPECT_TRUE(out.finish());
+			EXPECT_EQ(out.buffered(), 0u);
+		}
+		EXPECT_EQ(file.content(), to_utf8(text) + big_raw + to_utf8(text));
+	}
+
+	{
+		// lines of mixed text, against encoding each string and fwrite
+		std::vector<string> lines;
+		for (int i = 0; i < 1000; ++i)
+			lines.emplace_back(u"第" + std::u16string(i % 13, u'x') + u" line 😘\n");
+
+		temp_file file_std;
+		auto t0 = std::chrono::system_clock::now();
+		for (int n = 0; n < 100; ++n) {
+			for (const auto& line : lines) {
+				std::string temp;
+				EXPECT_TRUE(string_view(line.raw()).encode_to_utf8(temp));
+				std::fwrite(temp.data(), 1, temp.size(), file_std.file);
+			}
+		}
+		std::fflush(file_std.file);
+		auto t1 = std::chrono::system_clock::now();
+
+		temp_file file_writer;
+		{
+			u8_writer out(file_writer.fd());
+			for (int n = 0; n < 100; ++n) {
+				for (const auto& line : lines)
+					out.write(line);
+			}
+		}
+		auto t2 = std::chrono::system_clock::now();
+
+		std::chrono::duration<float> delta_std = t1 - t0;
+		std::chrono::duration<float> delta_writer = t2 - t1;
+		std::cout << delta_std.count() << " " << delta_writer.count() << std::endl;
+		EXPECT_EQ(file_std.content(), file_writer.content());
+	}
+}
+
+TEST(io, u8_reader)
+{
+	using namespace ostr;
+
+	const auto read_all = [](int fd, size_t chunk_size, bool prefetch, char16_t delimiter = u'\n') {
+		std::vector<std::u16string> ans;
+		u8_reader in(fd, chunk_size, prefetch);
+		string_view record;
+		while (delimiter == u'\n' ? in.next_line(record) : in.next_record(delimiter, record))
+			ans.emplace_back(record.raw());
+		EXPECT_TRUE(in.good());
+		return ans;
+	};
+
+	{
+		// every chunk boundary across multibyte sequences, with and without a prefetch thread
+		std::string bytes;
+		std::vector<std::u16string> expected;
+		for (int i = 0; i < 40; ++i)
+		{
+			const std::u16string line = u"第" + std::u16string(i % 7, u'x') + u"行 😘™";
+			expected.push_back(line);
+			bytes += to_utf8(line) + (i % 3 == 0 ? "\r\n" : "\n");
+		}
+		expected.push_back(u"尾𪚥");
+		bytes += to_utf8(expected.back());
+
+		temp_file file;
+		file.put(bytes);
+		for (size_t chunk_size = 64; chunk_size < 72; ++chunk_size)
+		{
+			for (bool prefetch : { false, true })
+			{
+				std::fseek(file.file, 0, SEEK_SET);
+				EXPECT_EQ(read_all(file.fd(), chunk_size, prefetch), expected);
+			}
+		}
+	}
+
+	{
+		// empty records, ill-formed bytes, and a sequence cut by the end
+		temp_file file;
+		file.put("a\n\nb\xC0\xAF" "c\xED\xA0\x80" "d\n\xF0\x9F\x98");
+		const std::vector<std::u16string> expected = { u"a", u"", u"b\uFFFD\uFFFDc\uFFFD\uFFFD\uFFFDd", u"\uFFFD" };
+		EXPECT_EQ(read_all(file.fd(), 64, false), expected);
+	}
+
+	{
+		temp_file file;
+		file.put("k=值;k2=;;");
+		const std::vector<std::u16string> expected = { u"k=值", u"k2=", u"" };
+		EXPECT_EQ(read_all(file.fd(), 64, true, u';'), expected);
+	}
+
+	{
+		temp_file file;
+		EXPECT_TRUE(read_all(file.fd(), 64, false).empty());
+		EXPECT_TRUE(read_all(file.fd(), 64, true).empty());
+	}
+
+	{
+		// lines of mixed text, against splitting fread blocks and decoding each line
+		std::string bytes;
+		for (int i = 0; i < 100000; ++i)
+			bytes += "第" + std::string(i % 13, 'x') + " line 😘\n";
+		temp_file file;
+		file.put(bytes);
+
+		size_t units_std = 0;
+		auto t0 = std::chrono::system_clock::now();
+		{
+			std::fseek(file.file, 0, SEEK_SET);
+			char buffer[4096];
+			std::string pending;
+			size_t n;
+			while ((n = std::fread(buffer, 1, sizeof(buffer), file.file)) != 0)
+			{
+				pending.append(buffer, n);
+				size_t begin = 0, pos;
+				while ((pos = pending.find('\n', begin)) != std::string::npos)
+				{
+					ostr::string decoded;
+					decoded.decode_from_utf8(std::string_view(pending).substr(begin, pos - begin));
+					units_std += decoded.raw().size();
+					begin = pos + 1;
+				}
+				pending.erase(0, begin);
+			}
+		}
+		auto t1 = std::chrono::system_clock::now();
+
+		size_t units_reader = 0;
+		{
+			std::fseek(file.file, 0, SEEK_SET);
+			u8_reader in(file.fd(), u8_reader::default_chunk_size, true);
+			for (string_view line; in.next_line(line);)
+				units_reader += line.raw().size();
+		}
+		auto t2 = std::chrono::system_clock::now();
+
+		std::chrono::duration<float> delta_std = t1 - t0;
+		std::chrono::duration<float> delta_reader = t2 - t1;
+		std::cout << delta_std.count() << " " << delta_reader.count() << std::endl;
+		EXPECT_EQ(units_std, units_reader);
+	}
+}
+
+TEST(io, mapped_text)
+{
+	using namespace ostr;
+
+	// a named file next to the test binary, removed at the end
+	const char* path = "ostr_mapped_text_test.txt";
+	std::u16string whole;
+	for (int i = 0; i < 20000; ++i)
+		whole += u"第" + std::u16string(i % 11, u'x') + u"行 😘™ " + std::u16string(1, char16_t(u'a' + i % 26)) + u"\n";
+	whole += u"尾巴NEEDLE𪚥";
+	{
+		std::FILE* file = std::fopen(path, "wb");
+		ASSERT_NE(file, nullptr);
+		const std::string bytes = to_utf8(whole);
+		std::fwrite(bytes.data(), 1, bytes.size(), file);
+		std::fclose(file);
+	}
+	const string_view expected(whole);
+
+	{
+		mapped_text text(path, 2);
+		ASSERT_TRUE(text.is_open());
+		ASSERT_GT(text.page_count(), 5u);
+
+		// only the pages read are decoded
+		EXPECT_EQ(text.substring(0, 3), expected.substring(0, 3));
+		EXPECT_EQ(text.pages_decoded(), 1u);
+
+		// pages end on code point boundaries and join back into the whole text
+		std::u16string joined;
+		for (size_t i = 0; i < text.page_count(); ++i)
+			joined += text.page(i).raw();
+		EXPECT_EQ(joined, whole);
+		EXPECT_EQ(text.length(), expected.length());
+
+		// ranges within a page, across pages and past the end
+		for (size_t offset : { size_t(0), size_t(40000), size_t(65530), size_t(131000), text.length() - 5 })
+		{
+			for (size_t count : { size_t(1), size_t(20), size_t(70000) })
+				EXPECT_EQ(text.substring(offset, count), expected.substring(offset, count));
+		}
+		EXPECT_TRUE(text.substring(text.length(), 3).is_empty());
+
+		EXPECT_EQ(text.index_of(u"NEEDLE"), expected.index_of(u"NEEDLE"));
+		EXPECT_EQ(text.index_of(u"NEEDLE", text.index_of(u"NEEDLE") + 1), SIZE_MAX);
+		EXPECT_EQ(text.index_of(u"𪚥"), text.length() - 1);
+		EXPECT_EQ(text.index_of(u"missing"), SIZE_MAX);
+		EXPECT_EQ(text.index_of(u"xxxxxxxxxx行", 1000), 1000 + expected.substring(1000).index_of(u"xxxxxxxxxx行"));
+	}
+
+	{
+		// every match found across each page boundary
+		mapped_text text(path, 2);
+		size_t at = 0;
+		size_t found = 0;
+		while ((at = text.index_of(u"行 😘", at)) != SIZE_MAX)
+		{
+			EXPECT_EQ(text.substring(at, 3), string(u"行 😘"));
+			++found;
+			++at;
+		}
+		EXPECT_EQ(found, 20000u);
+	}
+
+	{
+		// pages without pairs, code points are units
+		const char* ascii_path = "ostr_mapped_text_ascii.txt";
+		std::string ascii;
+		for (int i = 0; i < 20000; ++i)
+			ascii += "line " + std::to_string(i) + "\n";
+		std::FILE* file = std::fopen(ascii_path, "wb");
+		ASSERT_NE(file, nullptr);
+		std::fwrite(ascii.data(), 1, ascii.size(), file);
+		std::fclose(file);
+
+		mapped_text text(ascii_path, 2);
+		EXPECT_EQ(text.index_of(u"line 19999"), ascii.find("line 19999"));
+		EXPECT_EQ(text.index_of(u"line 1", 100000), ascii.find("line 1", 100000));
+		EXPECT_EQ(text.substring(ascii.find("line 12345"), 10), string(u"line 12345"));
+		std::remove(ascii_path);
+	}
+
+	{
+		mapped_text missing("ostr_mapped_text_missing.txt");
+		EXPECT_FALSE(missing.is_open());
+		EXPECT_EQ(missing.length(), 0u);
+		EXPECT_EQ(missing.index_of(u"a"), SIZE_MAX);
+	}
+
+	{
+		// searching a large file, against decoding it whole first
+		auto t0 = std::chrono::system_clock::now();
+		size_t at_whole;
+		{
+			std::FILE* file = std::fopen(path, "rb");
+			std::string bytes;
+			char buffer[4096];
+			size_t n;
+			while ((n = std::fread(buffer, 1, sizeof(buffer), file)) != 0)
+				bytes.append(buffer, n);
+			std::fclose(file);
+			string decoded;
+			decoded.decode_from_utf8(bytes);
+			at_whole = decoded.raw().find(u"NEEDLE");
+		}
+		auto t1 = std::chrono::system_clock::now();
+		size_t at_mapped;
+		{
+			mapped_text text(path);
+			at_mapped = text.index_of(u"NEEDLE");
+		}
+		auto t2 = std::chrono::system_clock::now();
+
+		std::chrono::duration<float> delta_whole = t1 - t0;
+		std::chrono::duration<float> delta_mapped = t2 - t1;
+		std::cout << delta_whole.count() << " " << delta_mapped.count() << std::endl;
+		EXPECT_NE(at_whole, std::u16string::npos);
+		EXPECT_NE(at_mapped, SIZE_MAX);
+	}
+
+	std::remove(path);
+}
+
+TEST(io, u8_cached_string)
+{
+	using namespace ostr;
+	using namespace ostr::literal;
+
+	u8_cached_string name(string(u"  玩家 \U0001F601 player  "));
+	EXPECT_FALSE(name.is_cached());
+	EXPECT_EQ(name.utf8(), to_utf8(u"  玩家 \U0001F601 player  "));
+	EXPECT_TRUE(name.is_cached());
+
+	// the same bytes until a mutation
+	const char* const first = name.utf8().data();
+	EXPECT_EQ(name.utf8().data(), first);
+	name.modify([](string& s) { s.trim(); });
+	EXPECT_FALSE(name.is_cached());
+	EXPECT_EQ(name.utf8(), to_utf8(u"玩家 \U0001F601 player"));
+	name.assign(string(u"other"));
+	EXPECT_EQ(name.utf8(), "other");
+
+	// copies encode again, moves take the cache along
+	u8_cached_string copy(name);
+	EXPECT_FALSE(copy.is_cached());
+	EXPECT_EQ(copy.utf8(), "other");
+	const char* const cached = name.utf8().data();
+	u8_cached_string moved(std::move(name));
+	EXPECT_EQ(moved.utf8().data(), cached);
+	copy = std::move(moved);
+	EXPECT_EQ(copy.utf8().data(), cached);
+
+	// many threads asking at once see one encoding
+	{
+		u8_cached_string shared(string(u"shared text ™"));
+		std::vector<std::thread> threads;
+		std::vector<const char*> seen(8);
+		for (size_t i = 0; i < seen.size(); ++i)
+			threads.emplace_back([&shared, &seen, i]() { seen[i] = shared.utf8().data(); });
+		for (auto& thread : threads)
+			thread.join();
+		for (const char* data : seen)
+			EXPECT_EQ(data, shared.utf8().data());
+	}
+
+	// written and formatted from the cache
+	{
+		temp_file file;
+		{
+			u8_writer out(file.fd());
+			out << u8_cached_string(string(u"玩家")) << u"!"_o;
+		}
+		EXPECT_EQ(file.content(), to_utf8(u"玩家!"));
+		EXPECT_EQ(fmt::format("[{:>6}]", u8_cached_string(string(u"玩家"))), to_utf8(u"[  玩家]"));
+		EXPECT_EQ(ofmt::format(u"[{}]", u8_cached_string(string(u"玩家")).str()), u"[玩家]");
+	}
+
+	// benchmark: a string sent many times, encoded each time or once
+	{
+		string text;
+		for (int i = 0; i < 100; ++i)
+			text += u"玩家 player ";
+		const u8_cached_string cached_text(text);
+		size_t sink = 0;
+
+		auto t0 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20000; ++n)
+		{
+			std::string u8;
+			EXPECT_TRUE(text.encode_to_utf8(u8));
+			sink += u8.size();
+		}
+		auto t1 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20000; ++n)
+			sink += cached_text.utf8().size();
+		auto t2 = std::chrono::system_clock::now();
+
+		std::chrono::duration<float> delta_encode = t1 - t0;
+		std::chrono::duration<float> delta_cached = t2 - t1;
+		std::cout << delta_encode.count() << " " << delta_cached.count() << std::endl;
+		EXPECT_GT(sink, 0u);
+	}
+}
@@ -0,0 +1,218 @@
+
+#include <gtest/gtest.h>
+
+#include "olog/olog.h"
+#include "ostring/chrono.h"
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/sinks/null_sink.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	// keeps the utf-8 payload and the source line of every record
+	class collect_sink : public spdlog::sinks::base_sink<std::mutex>
+	{
+	public:
+		std::vector<std::string> messages;
+		std::vector<int> lines;
+		std::vector<spdlog::level::level_enum> levels;
+		// held by a test to stall the background thread
+		std::mutex gate;
+
+	protected:
+		void sink_it_(const spdlog::details::log_msg& msg) override
+		{
+			std::lock_guard<std::mutex> lock(gate);
+			messages.emplace_back(msg.payload.data(), msg.payload.size());
+			lines.push_back(msg.source.line);
+			levels.push_back(msg.level);
+		}
+
+		void flush_() override {}
+	};
+
+	// drops everything, held by a test to stall the background thread
+	class gate_sink : public spdlog::sinks::base_sink<std::mutex>
+	{
+	public:
+		std::mutex gate;
+
+	protected:
+		void sink_it_(const spdlog::details::log_msg&) override
+		{
+			std::lock_guard<std::mutex> lock(gate);
+		}
+
+		void flush_() override {}
+	};
+}
+
+TEST(olog, render)
+{
+	using namespace std::literals;
+
+	auto sink = std::make_shared<collect_sink>();
+	olog::log_options options;
+	options.sinks.push_back(sink);
+	olog::init_log_system(options);
+
+	{
+		// arguments die before the background thread renders them
+		std::string temp = "temporary";
+		ostr::string name(u"你好𪚥");
+		olog::info(u"{0} {1,-4}|{2:.2f}", temp, 7, 3.14159);
+		olog::warn("{} says {}", name, ostr::string_view(u"hi"));
+	}
+	olog::verbose("plain {} text");
+	olog::debug(u"utf-16 {0}", u"😁");
+	LOG_FFL olog::error(u"with source");
+	const int line = __LINE__ - 1;
+	olog::info(u"without {src}", ostr::ofmt::arg(u"src", "source"));
+	olog::fatal("fatal {}", -1);
+
+	ASSERT_EQ(sink->messages.size(), 7u);
+	EXPECT_EQ(sink->messages[0], "temporary 7   |3.14");
+	EXPECT_EQ(sink->messages[1], "你好𪚥 says hi");
+	EXPECT_EQ(sink->messages[2], "plain {} text");
+	EXPECT_EQ(sink->messages[3], "utf-16 😁");
+	EXPECT_EQ(sink->messages[4], "with source");
+	EXPECT_EQ(sink->lines[4], line);
+	EXPECT_EQ(sink->lines[5], 0);
+	EXPECT_EQ(sink->messages[6], "fatal -1");
+	EXPECT_EQ(sink->levels[0], spdlog::level::info);
+	EXPECT_EQ(sink->levels[2], spdlog::level::trace);
+	EXPECT_EQ(sink->levels[6], spdlog::level::critical);
+
+	olog::set_level(olog::level::warn);
+	olog::info(u"filtered");
+	olog::warn(u"kept");
+	olog::flush();
+	ASSERT_EQ(sink->messages.size(), 8u);
+	EXPECT_EQ(sink->messages[7], "kept");
+
+	olog::shutdown_log_system();
+	olog::error(u"after shutdown");
+	EXPECT_EQ(sink->messages.size(), 8u);
+}
+
+TEST(olog, threads)
+{
+	auto sink = std::make_shared<collect_sink>();
+	olog::log_options options;
+	options.sinks.push_back(sink);
+	options.queue_capacity = 4096;
+	olog::init_log_system(options);
+
+	constexpr int thread_count = 4;
+	constexpr int count = 20000;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < thread_count; ++t)
+	{
+		threads.emplace_back([t]()
+			{
+				for (int i = 0; i < count; ++i)
+					olog::info(u"{0} {1} {2}", t, i, std::u16string(i % 64, u'x'));
+			});
+	}
+	for (auto& thread : threads)
+		thread.join();
+	olog::shutdown_log_system();
+
+	// nothing lost with overflow_policy::block, order kept per thread
+	ASSERT_EQ(sink->messages.size(), size_t(thread_count * count));
+	int next[thread_count] = {};
+	for (const auto& message : sink->messages)
+	{
+		int t = 0, i = 0;
+		ASSERT_EQ(std::sscanf(message.c_str(), "%d %d", &t, &i), 2);
+		ASSERT_EQ(next[t], i);
+		EXPECT_EQ(message.size(), message.find(' ', message.find(' ') + 1) + 1 + i % 64);
+		++next[t];
+	}
+}
+
+TEST(olog, drop)
+{
+	auto sink = std::make_shared<collect_sink>();
+	olog::log_options options;
+	options.sinks.push_back(sink);
+	options.queue_capacity = 4096;
+	options.policy = olog::overflow_policy::drop;
+	olog::init_log_system(options);
+
+	const uint64_t dropped_before = olog::dropped_count();
+	constexpr int count = 1000;
+	{
+		std::unique_lock<std::mutex> stall(sink->gate);
+		std::thread([]()
+			{
+				for (int i = 0; i < count; ++i)
+					olog::info(u"record {0}", i);
+			}).join();
+	}
+	olog::flush();
+	olog::shutdown_log_system();
+
+	const uint64_t dropped = olog::dropped_count() - dropped_before;
+	EXPECT_GT(dropped, 0u);
+
+	size_t rendered = 0;
+	bool reported = false;
+	for (const auto& message : sink->messages)
+	{
+		if (message.rfind("record ", 0) == 0)
+			++rendered;
+		else if (message == "olog: " + std::to_string(dropped) + " records dropped")
+			reported = true;
+	}
+	EXPECT_EQ(rendered + dropped, size_t(count));
+	EXPECT_TRUE(reported);
+}
+
+TEST(olog, latency)
+{
+	using namespace std::chrono;
+
+	// the background thread is stalled, only the cost of the callers is measured
+	auto sink = std::make_shared<gate_sink>();
+	olog::log_options options;
+	options.sinks.push_back(sink);
+	options.queue_capacity = 64 << 20;
+	olog::init_log_system(options);
+
+	constexpr int count = 200000;
+	const ostr::string name(u"player");
+	const auto now = system_clock::now();
+	double olog_ns = 0;
+	{
+		std::unique_lock<std::mutex> stall(sink->gate);
+		std::thread([&]()
+			{
+				olog::info(u"warm up");
+				const auto t0 = steady_clock::now();
+				for (int i = 0; i < count; ++i)
+					olog::info(u"{0} moved to {1}, {2} at {3}", name, i, 0.5 * i, now);
+				const auto t1 = steady_clock::now();
+				olog_ns = duration<double, std::nano>(t1 - t0).count() / count;
+			}).join();
+	}
+	olog::shutdown_log_system();
+
+	auto logger = std::make_shared<spdlog::logger>("sync", std::make_shared<spdlog::sinks::null_sink_mt>());
+	const auto t0 = steady_clock::now();
+	for (int i = 0; i < count; ++i)
+		logger->info("{0} moved to {1}, {2}", "player", i, 0.5 * i);
+	const auto t1 = steady_clock::now();
+	const double spdlog_ns = duration<double, std::nano>(t1 - t0).count() / count;
+
+	std::cout << "olog caller " << olog_ns << "ns, spdlog sync " << spdlog_ns << "ns" << std::endl;
+}
@@ -1,7 +1,16 @@
 ﻿
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+#include "ostring/compact_string.h"
 #include "ostring/ostr.h"
+#include "ostring/string_builder.h"
 
 TEST(ostr, literal)
 {
@@ -373,3 +382,342 @@ TEST(ostr, trim)
 		}
 	}
 }
+
+TEST(ostr, latin1_constructor)
+{
+	using namespace ostr;
+
+	// bytes as latin-1, every length around a block
+	std::string bytes;
+	for (int i = 1; i < 256; ++i)
+		bytes.push_back(char(i));
+	for (size_t n = 0; n <= 40; ++n)
+	{
+		const string str(bytes.c_str(), n);
+		ASSERT_EQ(str.raw().size(), n);
+		for (size_t i = 0; i < n; ++i)
+			EXPECT_EQ(str.raw()[i], char16_t(i + 1));
+		EXPECT_EQ(str.length(), n);
+	}
+	EXPECT_EQ(string("caf\xE9").raw(), u"café");
+	EXPECT_EQ(string(bytes).raw().size(), 255u);
+	EXPECT_EQ(string(std::string_view(bytes).substr(200)).raw()[0], char16_t(201));
+
+	// a c string ends at a zero, len or not, a std::string keeps its zeros
+	const char with_zero[] = "ab\0cd";
+	EXPECT_EQ(string(with_zero).raw(), u"ab");
+	EXPECT_EQ(string(with_zero, 4).raw(), u"ab");
+	EXPECT_EQ(string(with_zero, 1).raw(), u"a");
+	EXPECT_EQ(string(std::string(with_zero, 5)).raw(), std::u16string_view(u"ab\0cd", 5));
+
+	// benchmark: widening a long buffer against the per unit assign it replaced
+	{
+		std::string text;
+		for (int i = 0; i < 100000; ++i)
+			text += "plain ascii log line\n";
+		size_t sink = 0;
+
+		auto t0 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20; ++n)
+			sink += string(text.c_str()).length();
+		auto t1 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20; ++n)
+		{
+			std::basic_string_view<unsigned char> sv(reinterpret_cast<const unsigned char*>(text.data()), text.size());
+			std::u16string copy;
+			copy.assign(sv.cbegin(), sv.cend());
+			sink += copy.size() - helper::string::count_surrogate_pair(copy.cbegin(), copy.cend());
+		}
+		auto t2 = std::chrono::system_clock::now();
+
+		std::chrono::duration<float> delta_simd = t1 - t0;
+		std::chrono::duration<float> delta_assign = t2 - t1;
+		std::cout << delta_simd.count() << " " << delta_assign.count() << std::endl;
+		EXPECT_GT(sink, 0u);
+	}
+}
+
+TEST(ostr, compact_string)
+{
+	using namespace ostr;
+	using namespace ostr::literal;
+
+	// narrowed while every unit fits in latin-1
+	compact_string name(u"player café");
+	EXPECT_TRUE(name.is_compact());
+	EXPECT_EQ(name.storage_size(), 11u);
+	EXPECT_EQ(name.length(), 11u);
+	EXPECT_EQ(name.to_string(), string(u"player café"));
+	EXPECT_EQ(name.get_hash(), u"player café"_o.get_hash());
+
+	// widened by the first unit above 0xFF
+	compact_string wide = name + u" 玩家😘"_o;
+	EXPECT_FALSE(wide.is_compact());
+	EXPECT_EQ(wide.length(), 15u);
+	EXPECT_EQ(wide.storage_size(), 16u * 2u);
+	EXPECT_EQ(wide.to_string(), string(u"player café 玩家😘"));
+	EXPECT_EQ(wide.get_hash(), u"player café 玩家😘"_o.get_hash());
+	wide += "!";
+	EXPECT_EQ(wide.to_string(), string(u"player café 玩家😘!"));
+	name += u"s"_o;
+	EXPECT_TRUE(name.is_compact());
+	EXPECT_EQ(compact_string(wide.substring(0, 6)), compact_string("player"));
+	EXPECT_TRUE(wide.substring(0, 6).is_compact());
+	EXPECT_EQ(wide.substring(13, 3).to_string(), string(u"家😘!"));
+	EXPECT_EQ(name.substring(7, 4).to_string(), string(u"café"));
+
+	// views of either width against each other
+	const compact_string_view narrow_sv = "caf\xE9";
+	const compact_string_view wide_sv = u"café"_o;
+	EXPECT_EQ(narrow_sv, wide_sv);
+	EXPECT_EQ(narrow_sv.compare(wide_sv), 0);
+	EXPECT_LT(compact_string_view("cafe"), wide_sv);
+	EXPECT_LT(narrow_sv, compact_string_view(u"cafĀ"_o));
+	EXPECT_GT(compact_string_view(u"玩"_o), narrow_sv);
+	EXPECT_EQ(name.index_of(u"café"_o), 7u);
+	EXPECT_EQ(name.index_of(u"玩"_o), SIZE_MAX);
+	EXPECT_EQ(name.index_of("PLAYER", 0, SIZE_MAX, case_sensitivity::insensitive), 0u);
+	EXPECT_EQ(wide.index_of("\xE9"), 10u);
+	EXPECT_EQ(wide.index_of("!"), 15u);
+	EXPECT_EQ(wide.last_index_of(u"a"_o), 8u);
+	EXPECT_EQ(wide.index_of("a", 3), 8u);
+	EXPECT_TRUE(wide.to_sv().start_with("player"));
+	EXPECT_TRUE(wide.to_sv().end_with(u"😘!"_o));
+	EXPECT_TRUE(name.to_sv().end_with(u"és"_o));
+
+	std::string u8;
+	EXPECT_TRUE(name.encode_to_utf8(u8));
+	EXPECT_EQ(u8, std::string(u8"player cafés"));
+	EXPECT_EQ(ofmt::format(u"[{0}|{1}]", name, wide.substring(13)), u"[player cafés|家😘!]");
+	EXPECT_EQ(fmt::format(u"{:>5}", compact_string("ab")), u"   ab");
+
+	// assigned back narrow
+	wide = compact_string(u"plain"_o);
+	EXPECT_TRUE(wide.is_compact());
+
+	// to and from string, the text and its hash are kept
+	const string from = u"café 玩家😘"_o;
+	const compact_string round(from);
+	EXPECT_FALSE(round.is_compact());
+	EXPECT_TRUE(round.to_string() == from);
+	EXPECT_EQ(round.length(), from.length());
+	EXPECT_TRUE(compact_string(string(u"café")).is_compact());
+	EXPECT_TRUE(compact_string(string(u"café")).to_string() == u"café"_o);
+	EXPECT_EQ(compact_string(string(u"café")).get_hash(), string(u"café").get_hash());
+
+	// benchmark: searching ascii lines against string
+	{
+		std::u16string text;
+		for (int i = 0; i < 10000; ++i)
+			text += u"plain ascii log line ";
+		text += u"needle";
+		const string str(text);
+		const compact_string compact(str);
+		EXPECT_TRUE(compact.is_compact());
+		EXPECT_EQ(compact.storage_size() * 2, str.raw().size() * sizeof(char16_t));
+		size_t sink = 0;
+
+		auto t0 = std::chrono::system_clock::now();
+		for (int n = 0; n < 200; ++n)
+			sink += compact.index_of("needle");
+		auto t1 = std::chrono::system_clock::now();
+		for (int n = 0; n < 200; ++n)
+			sink += str.index_of(u"needle");
+		auto t2 = std::chrono::system_clock::now();
+
+		std::chrono::duration<float> delta_compact = t1 - t0;
+		std::chrono::duration<float> delta_wide = t2 - t1;
+		std::cout << delta_compact.count() << " " << delta_wide.count() << std::endl;
+		EXPECT_EQ(sink, 400u * 210000u);
+	}
+}
+
+TEST(ostr, pmr_string)
+{
+	using namespace ostr;
+	using namespace ostr::literal;
+
+	std::pmr::monotonic_buffer_resource arena;
+	// anything taken from the default resource throws from here on
+	std::pmr::memory_resource* const previous = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+	{
+		pmr::string str(u"  玩家😘 got coins  "_o, &arena);
+		EXPECT_EQ(str.get_allocator().resource(), &arena);
+		EXPECT_EQ(str.length(), 17u);
+
+		const pmr::string trimmed = str.trim_copy();
+		EXPECT_EQ(trimmed.get_allocator().resource(), &arena);
+		EXPECT_EQ(trimmed, u"玩家😘 got coins"_o);
+
+		const pmr::string sub = trimmed.substring(0, 3);
+		EXPECT_EQ(sub.get_allocator().resource(), &arena);
+		EXPECT_EQ(sub, u"玩家😘"_o);
+		EXPECT_EQ(sub.length(), 3u);
+
+		// replace_copy counts positions in code units, kept clear of surrogate pairs here
+		const pmr::string replaced = trimmed.substring(4).replace_copy(u"coins"_o, u"gems"_o);
+		EXPECT_EQ(replaced.get_allocator().resource(), &arena);
+		EXPECT_EQ(replaced, u"got gems"_o);
+
+		const pmr::string formatted = pmr::string(u"{0} got {1}"_o, &arena).format(std::allocator_arg, &arena, sub, 3);
+		EXPECT_EQ(formatted.get_allocator().resource(), &arena);
+		EXPECT_EQ(formatted, u"玩家😘 got 3"_o);
+
+		const pmr::string direct = ofmt::format(std::allocator_arg, std::pmr::polymorphic_allocator<char16_t>(&arena), u"[{0}]", formatted);
+		EXPECT_EQ(direct, u"[玩家😘 got 3]"_o);
+
+		// a memory resource as it is
+		const pmr::string from_resource = ofmt::format(std::allocator_arg, &arena, u"{0} got {1}", sub, 3);
+		EXPECT_EQ(from_resource.get_allocator().resource(), &arena);
+		EXPECT_EQ(from_resource, u"玩家😘 got 3"_o);
+
+		pmr::string decoded(&arena);
+		EXPECT_TRUE(decoded.decode_from_utf8(u8"玩家😘"));
+		EXPECT_TRUE(decoded.decode_from_utf32(U"!"));
+		EXPECT_EQ(decoded, u"玩家😘!"_o);
+		EXPECT_EQ(decoded.length(), 4u);
+
+		// the global allocator is still there for string
+		const string global = string(decoded.to_sv()) + string(u"?");
+		EXPECT_EQ(global, u"玩家😘!?"_o);
+		EXPECT_EQ(pmr::string(global, &arena), u"玩家😘!?"_o);
+		EXPECT_EQ(fmt::format(u"{}", decoded), u"玩家😘!");
+		EXPECT_EQ(ofmt::format(u"{0}", decoded), u"玩家😘!");
+	}
+	std::pmr::set_default_resource(previous);
+
+	// benchmark: a request worth of strings per iteration on many threads, global heap against an arena each
+	{
+		const string line(u"GET /player/玩家/coins?session=0123456789abcdef HTTP/1.1  ");
+		const size_t threads = std::max(2u, std::thread::hardware_concurrency());
+		constexpr int requests = 20000;
+
+		auto run = [&](auto&& handle) {
+			std::vector<std::thread> workers;
+			auto t0 = std::chrono::system_clock::now();
+			for (size_t i = 0; i < threads; ++i)
+				workers.emplace_back(handle);
+			for (auto& worker : workers)
+				worker.join();
+			std::chrono::duration<float> delta = std::chrono::system_clock::now() - t0;
+			return delta.count();
+		};
+
+		std::atomic<size_t> sink_global{ 0 };
+		const float delta_global = run([&]() {
+			size_t sink = 0;
+			for (int n = 0; n < requests; ++n)
+			{
+				const string trimmed = line.trim_copy();
+				const string path = trimmed.substring(4, 20);
+				const string out = path.replace_copy(u"coins"_o, u"gems"_o);
+				sink += out.length() + string(u"{0}:{1}"_o).format(path, n).length();
+			}
+			sink_global += sink;
+		});
+
+		std::atomic<size_t> sink_arena{ 0 };
+		const float delta_arena = run([&]() {
+			size_t sink = 0;
+			char buffer[4096];
+			for (int n = 0; n < requests; ++n)
+			{
+				std::pmr::monotonic_buffer_resource request(buffer, sizeof(buffer));
+				const pmr::string str(line.to_sv(), &request);
+				const pmr::string trimmed = str.trim_copy();
+				const pmr::string path = trimmed.substring(4, 20);
+				const pmr::string out = path.replace_copy(u"coins"_o, u"gems"_o);
+				sink += out.length() + pmr::string(u"{0}:{1}"_o, &request).format(std::allocator_arg, &request, path, n).length();
+			}
+			sink_arena += sink;
+		});
+
+		std::cout << delta_global << " " << delta_arena << std::endl;
+		EXPECT_EQ(sink_global.load(), sink_arena.load());
+	}
+}
+
+TEST(ostr, string_builder)
+{
+	using namespace ostr;
+	using namespace ostr::literal;
+
+	string_builder sb(16);
+	sb.append(u"玩家"_o).append(string(u"😘 got ")).append(U'𪚥').append(U'!');
+	sb.format(u" {0} coins{1}", 3, u".");
+	sb.append_utf8(u8" 我™C😘");
+	// a pair split between two appends
+	const std::u16string_view pair = u"😘";
+	sb.append(pair.substr(0, 1)).append(pair.substr(1));
+	sb << u" end";
+	// a surrogate as a code point is not kept
+	sb.append(codepoint(0xD800));
+
+	const string expected = u"玩家😘 got 𪚥! 3 coins. 我™C😘😘 end�";
+	EXPECT_EQ(sb.length(), expected.length());
+	EXPECT_EQ(sb.origin_length(), expected.raw().size());
+	const string built = sb.build();
+	EXPECT_EQ(built, expected);
+	EXPECT_EQ(built.length(), expected.length());
+	EXPECT_GE(sb.capacity(), sb.origin_length());
+
+	// a large piece across chunks, built into an arena
+	std::u16string large;
+	for (int i = 0; i < 1000; ++i)
+		large += u"a😘b";
+	sb.append(large);
+	std::pmr::monotonic_buffer_resource arena;
+	const pmr::string in_arena = sb.build(std::pmr::polymorphic_allocator<char16_t>(&arena));
+	EXPECT_EQ(in_arena.get_allocator().resource(), &arena);
+	EXPECT_EQ(in_arena.raw(), std::u16string(expected.raw()) + large);
+	EXPECT_EQ(in_arena.length(), expected.length() + 3000u);
+
+	// reused, no chunk is freed or added for the same output
+	const size_t capacity = sb.capacity();
+	for (int round = 0; round < 3; ++round)
+	{
+		sb.clear();
+		EXPECT_TRUE(sb.is_empty());
+		EXPECT_EQ(sb.build(), string());
+		sb.append(large).append(u"!");
+		EXPECT_EQ(sb.build().raw(), large + u"!");
+		EXPECT_EQ(sb.length(), 3001u);
+		EXPECT_EQ(sb.capacity(), capacity);
+	}
+
+	// operator+ on a temporary appends in place
+	const string a = u"a", b = u"😘", c = u"c";
+	EXPECT_EQ(a + b + c, u"a😘c"_o);
+	EXPECT_EQ((a + b + c).length(), 3u);
+	EXPECT_EQ(a, u"a"_o);
+
+	// benchmark: building a report against += and +
+	{
+		const string line = u"player 玩家 got coins\n";
+		size_t sink = 0;
+		string_builder report;
+
+		auto t0 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20; ++n)
+		{
+			report.clear();
+			for (int i = 0; i < 20000; ++i)
+				report.append(line).format(u"{0}\n", i);
+			sink += report.build().length();
+		}
+		auto t1 = std::chrono::system_clock::now();
+		for (int n = 0; n < 20; ++n)
+		{
+			string text;
+			for (int i = 0; i < 20000; ++i)
+				text += line + string(u"{0}\n").format(i);
+			sink += text.length();
+		}
+		auto t2 = std::chrono::system_clock::now();
+
+		std::chrono::duration<float> delta_builder = t1 - t0;
+		std::chrono::duration<float> delta_append = t2 - t1;
+		std::cout << delta_builder.count() << " " << delta_append.count() << std::endl;
+		EXPECT_EQ(sink % 2, 0u);
+	}
+}
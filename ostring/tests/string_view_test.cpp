@@ -3,6 +3,17 @@
 
 #include "ostring/osv.h"
 #include "ostring/ostr.h"
+#include "ostring/u8string.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/ostream_sink.h>
 
 namespace osv {
 	TEST(osv, length)
@@ -433,4 +444,541 @@ namespace osv {
 		EXPECT_EQ(h, 0x335CC04A);
 	}
 
-}
\ No newline at end of file
+
+	TEST(osv, parse_int)
+	{
+		using namespace ostr;
+		using namespace ostr::literal;
+
+		{
+			int i = 0;
+			const parse_result r = u"-42px"_o.parse_int(i);
+			EXPECT_TRUE(r.ec == std::errc());
+			EXPECT_EQ(r.length, 3);
+			EXPECT_EQ(i, -42);
+		}
+		{
+			int64_t i = 0;
+			EXPECT_TRUE(u"9223372036854775807"_o.parse_int(i).ec == std::errc());
+			EXPECT_EQ(i, INT64_MAX);
+			EXPECT_TRUE(u"-9223372036854775808"_o.parse_int(i).ec == std::errc());
+			EXPECT_EQ(i, INT64_MIN);
+			EXPECT_TRUE(u"9223372036854775808"_o.parse_int(i).ec == std::errc::result_out_of_range);
+			EXPECT_EQ(i, INT64_MIN);
+		}
+		{
+			uint64_t u = 0;
+			EXPECT_TRUE(u"18446744073709551615"_o.parse_int(u).ec == std::errc());
+			EXPECT_EQ(u, UINT64_MAX);
+			EXPECT_TRUE(u"18446744073709551616"_o.parse_int(u).ec == std::errc::result_out_of_range);
+			EXPECT_TRUE(u"28446744073709551615"_o.parse_int(u).ec == std::errc::result_out_of_range);
+			EXPECT_TRUE(u"000000000000000000000000018446744073709551615"_o.parse_int(u).ec == std::errc());
+			EXPECT_EQ(u, UINT64_MAX);
+			EXPECT_TRUE(u"-1"_o.parse_int(u).ec == std::errc::invalid_argument);
+		}
+		{
+			int8_t i8 = 0;
+			EXPECT_TRUE(u"127"_o.parse_int(i8).ec == std::errc());
+			EXPECT_EQ(i8, 127);
+			EXPECT_TRUE(u"128"_o.parse_int(i8).ec == std::errc::result_out_of_range);
+			EXPECT_TRUE(u"-128"_o.parse_int(i8).ec == std::errc());
+			EXPECT_EQ(i8, -128);
+			uint16_t u16 = 0;
+			const parse_result r = u"65536"_o.parse_int(u16);
+			EXPECT_TRUE(r.ec == std::errc::result_out_of_range);
+			EXPECT_EQ(r.length, 5);
+		}
+		{
+			uint32_t u = 0;
+			EXPECT_TRUE(u"ff"_o.parse_int(u, 16).ec == std::errc());
+			EXPECT_EQ(u, 0xff);
+			EXPECT_TRUE(u"DeadBeef"_o.parse_int(u, 16).ec == std::errc());
+			EXPECT_EQ(u, 0xdeadbeef);
+			EXPECT_TRUE(u"777"_o.parse_int(u, 8).ec == std::errc());
+			EXPECT_EQ(u, 0777);
+			const parse_result r = u"10112"_o.parse_int(u, 2);
+			EXPECT_EQ(r.length, 4);
+			EXPECT_EQ(u, 0b1011);
+			EXPECT_TRUE(u"100000000"_o.parse_int(u, 16).ec == std::errc::result_out_of_range);
+		}
+		{
+			// a base out of 2 to 36 parses nothing
+			uint32_t u = 7;
+			EXPECT_TRUE(u"10"_o.parse_int(u, 0).ec == std::errc::invalid_argument);
+			EXPECT_TRUE(u"10"_o.parse_int(u, 1).ec == std::errc::invalid_argument);
+			EXPECT_TRUE(u"10"_o.parse_int(u, 37).ec == std::errc::invalid_argument);
+			EXPECT_TRUE(u"10"_o.parse_int(u, -2).ec == std::errc::invalid_argument);
+			EXPECT_EQ(u, 7u);
+			EXPECT_TRUE(u"zz"_o.parse_int(u, 36).ec == std::errc());
+			EXPECT_EQ(u, 36u * 35 + 35);
+			EXPECT_EQ(u"10"_o.to_int(0), 0);
+		}
+		{
+			int i = 7;
+			EXPECT_TRUE(u""_o.parse_int(i).ec == std::errc::invalid_argument);
+			EXPECT_TRUE(u"-"_o.parse_int(i).ec == std::errc::invalid_argument);
+			EXPECT_TRUE(u" 1"_o.parse_int(i).ec == std::errc::invalid_argument);
+			EXPECT_TRUE(u"１"_o.parse_int(i).ec == std::errc::invalid_argument);
+			EXPECT_EQ(i, 7);
+		}
+		{
+			// 8 digits a step, mixed with a non-digit in the middle of a step
+			int64_t i = 0;
+			const parse_result r = u"1234567890123x45678"_o.parse_int(i);
+			EXPECT_EQ(r.length, 13);
+			EXPECT_EQ(i, 1234567890123);
+		}
+
+		EXPECT_EQ(u"  123 "_o.to_int(), 123);
+		EXPECT_EQ(u"12a"_o.to_int(), 0);
+		EXPECT_EQ(u""_o.to_int(), 0);
+		EXPECT_EQ(u"-9000000000"_o.to_int64(), -9000000000);
+		EXPECT_EQ(u"ffffffffffffffff"_o.to_uint64(16), UINT64_MAX);
+	}
+
+	TEST(osv, parse_int_bench)
+	{
+		using namespace ostr;
+
+		std::vector<std::string> narrow;
+		std::vector<std::u16string> wide;
+		uint64_t state = 0x9E3779B97F4A7C15ull;
+		for (int i = 0; i < 100000; ++i)
+		{
+			state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+			const int64_t v = static_cast<int64_t>(state) >> (state % 48);
+			narrow.push_back(std::to_string(v));
+			wide.emplace_back(narrow.back().cbegin(), narrow.back().cend());
+		}
+
+		// wraps around on purpose, unsigned so the overflow is defined
+		uint64_t sum_std = 0;
+		uint64_t sum_ostr = 0;
+		{
+			auto t0 = std::chrono::system_clock::now();
+			for (const auto& s : narrow)
+			{
+				int64_t v = 0;
+				std::from_chars(s.data(), s.data() + s.size(), v);
+				sum_std += static_cast<uint64_t>(v);
+			}
+			auto t1 = std::chrono::system_clock::now();
+			std::chrono::duration<float> delta = t1 - t0;
+			std::cout << delta.count() << std::endl;
+		}
+		{
+			auto t0 = std::chrono::system_clock::now();
+			for (const auto& s : wide)
+			{
+				int64_t v = 0;
+				(void)string_view(s).parse_int(v);
+				sum_ostr += static_cast<uint64_t>(v);
+			}
+			auto t1 = std::chrono::system_clock::now();
+			std::chrono::duration<float> delta = t1 - t0;
+			std::cout << delta.count() << std::endl;
+		}
+		EXPECT_EQ(sum_std, sum_ostr);
+	}
+
+
+	TEST(osv, parse_float)
+	{
+		using namespace ostr;
+		using namespace ostr::literal;
+
+		{
+			double d = 0;
+			const parse_result r = u"-1.5e3,2"_o.parse_float(d);
+			EXPECT_TRUE(r.ec == std::errc());
+			EXPECT_EQ(r.length, 6);
+			EXPECT_EQ(d, -1500.0);
+		}
+
+		const std::u16string_view cases[] =
+		{
+			u"0", u"-0", u"1", u"0.1", u"+.5e-3", u"3.14159", u"1e23", u"8.589973e9",
+			u"9007199254740993", u"9007199254740992.5", u"2.2250738585072011e-308",
+			u"2.2250738585072014e-308", u"4.9406564584124654e-324", u"2.4703282292062328e-324",
+			u"1.7976931348623157e308", u"179769313486231580793728971405301e276",
+			u"0.1000000000000000055511151231257827021181583404541015625",
+			u"0.10000000000000000555111512312578270211815834045410156250000000000000001",
+			u"7.3177701707893310e+15", u"123456789012345678901234567890",
+			u"0.000000000000000000000000000000000000000000001234567890123456789012345",
+		};
+		for (auto c : cases)
+		{
+			const std::string narrow(c.cbegin(), c.cend());
+			double d = -1;
+			const parse_result r = string_view(c).parse_float(d);
+			EXPECT_TRUE(r.ec == std::errc()) << narrow;
+			EXPECT_EQ(r.length, c.size()) << narrow;
+			EXPECT_EQ(d, std::strtod(narrow.c_str(), nullptr)) << narrow;
+			// out of float range
+			const float expected_f = std::strtof(narrow.c_str(), nullptr);
+			if (!std::isfinite(expected_f) || (expected_f == 0 && d != 0))
+				continue;
+			float f = -1;
+			EXPECT_TRUE(string_view(c).parse_float(f).ec == std::errc()) << narrow;
+			EXPECT_EQ(f, expected_f) << narrow;
+		}
+
+		{
+			// 800 digits, halfway between two doubles up to the last non-zero digit
+			std::u16string halfway = u"9007199254740993";
+			halfway.append(800, u'0');
+			halfway.append(u"1e-801");
+			double d = 0;
+			EXPECT_TRUE(string_view(halfway).parse_float(d).ec == std::errc());
+			EXPECT_EQ(d, 9007199254740994.0);
+		}
+
+		{
+			double d = 7;
+			EXPECT_TRUE(u"1e400"_o.parse_float(d).ec == std::errc::result_out_of_range);
+			EXPECT_TRUE(u"1e-400"_o.parse_float(d).ec == std::errc::result_out_of_range);
+			EXPECT_TRUE(u"2.4703282292062327e-324"_o.parse_float(d).ec == std::errc::result_out_of_range);
+			EXPECT_TRUE(u""_o.parse_float(d).ec == std::errc::invalid_argument);
+			EXPECT_TRUE(u"."_o.parse_float(d).ec == std::errc::invalid_argument);
+			EXPECT_TRUE(u"e5"_o.parse_float(d).ec == std::errc::invalid_argument);
+			EXPECT_EQ(d, 7);
+			EXPECT_EQ(u"1e"_o.parse_float(d).length, 1);
+			EXPECT_EQ(u"2.e+"_o.parse_float(d).length, 2);
+			EXPECT_EQ(d, 2);
+			EXPECT_TRUE(u"-Infinity"_o.parse_float(d).length == 9 && d == -std::numeric_limits<double>::infinity());
+			EXPECT_TRUE(u"nan(ind)"_o.parse_float(d).length == 8 && std::isnan(d));
+		}
+
+		EXPECT_EQ(u" 2.5 "_o.to_double(), 2.5);
+		EXPECT_EQ(u"0.1"_o.to_float(), 0.1f);
+		EXPECT_EQ(u"0.1x"_o.to_double(), 0);
+
+		// round trip random doubles
+		uint64_t state = 0x9E3779B97F4A7C15ull;
+		for (int i = 0; i < 100000; ++i)
+		{
+			state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+			double expected;
+			std::memcpy(&expected, &state, sizeof(expected));
+			if (!std::isfinite(expected)) continue;
+			std::u16string str;
+			helper::string::append_float(expected, str, (i & 1) ? float_format::scientific : float_format::general, (i & 2) ? 17 : -1);
+			double d = 0;
+			EXPECT_TRUE(string_view(str).parse_float(d).ec == std::errc());
+			EXPECT_EQ(d, expected);
+		}
+	}
+
+	TEST(osv, parse_float_bench)
+	{
+		using namespace ostr;
+		using namespace ostr::literal;
+
+		// csv-style numeric columns
+		std::u16string csv;
+		uint64_t state = 0x9E3779B97F4A7C15ull;
+		for (int row = 0; row < 20000; ++row)
+		{
+			for (int col = 0; col < 5; ++col)
+			{
+				state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+				const double v = static_cast<double>(static_cast<int64_t>(state >> 20) - (int64_t(1) << 43)) / (1 << (state % 24));
+				if (col != 0) csv.push_back(u',');
+				helper::string::append_float(v, csv, float_format::general, col == 4 ? 6 : -1);
+			}
+			csv.push_back(u'\n');
+		}
+		std::vector<string_view> fields;
+		for (size_t begin = 0, i = 0; i < csv.size(); ++i)
+		{
+			if (csv[i] == u',' || csv[i] == u'\n')
+			{
+				fields.push_back(std::u16string_view(csv).substr(begin, i - begin));
+				begin = i + 1;
+			}
+		}
+
+		double sum_std = 0;
+		double sum_ostr = 0;
+		{
+			auto t0 = std::chrono::system_clock::now();
+			for (auto field : fields)
+			{
+				const std::string narrow(field.raw().cbegin(), field.raw().cend());
+				sum_std += std::strtod(narrow.c_str(), nullptr);
+			}
+			auto t1 = std::chrono::system_clock::now();
+			std::chrono::duration<float> delta = t1 - t0;
+			std::cout << delta.count() << std::endl;
+		}
+		{
+			auto t0 = std::chrono::system_clock::now();
+			for (auto field : fields)
+			{
+				double v = 0;
+				(void)field.parse_float(v);
+				sum_ostr += v;
+			}
+			auto t1 = std::chrono::system_clock::now();
+			std::chrono::duration<float> delta = t1 - t0;
+			std::cout << delta.count() << std::endl;
+		}
+		EXPECT_EQ(sum_std, sum_ostr);
+	}
+
+	TEST(osv, fmt_formatter)
+	{
+		using namespace ostr;
+		using namespace ostr::literal;
+
+		// utf-8 straight into the buffer of fmt
+		EXPECT_EQ(fmt::format("[{}]", u"我™C𪚥😘"_o), "[我™C𪚥😘]");
+		EXPECT_EQ(fmt::format("{} {}", string(u"aé"), u""_o), "aé ");
+		EXPECT_EQ(fmt::format(u"[{:>5}]", u"ab"_o), u"[   ab]");
+		EXPECT_EQ(fmt::format(u"[{:<4}]", string(u"𪚥")), u"[𪚥  ]");
+		// fmt counts the emoji two columns wide
+		EXPECT_EQ(fmt::format("[{:>8}]", u"ab😘"_o), "[    ab😘]");
+		EXPECT_EQ(fmt::format("[{:*<5}]", string(u"aé")), "[aé***]");
+		EXPECT_EQ(fmt::format("[{:^6.2}]", u"abcd"_o), "[  ab  ]");
+
+		// unpaired surrogates
+		const char16_t broken[] = { u'a', 0xD800, u'b', 0xDC00, 0 };
+		EXPECT_EQ(fmt::format("{}", string_view(broken)), "a\xEF\xBF\xBD" "b\xEF\xBF\xBD");
+
+		// longer than the stack buffer, pairs across every chunk border
+		std::u16string long_text;
+		for (int i = 0; i < 300; ++i)
+			long_text += u"a😘";
+		std::string expected;
+		EXPECT_TRUE(string_view(long_text).encode_to_utf8(expected));
+		EXPECT_EQ(fmt::format("{}", string_view(long_text)), expected);
+		for (size_t split = 250; split < 260; ++split)
+		{
+			const auto head = coder::encode_utf8(std::u16string_view(long_text).substr(0, split), expected.data(), false);
+			EXPECT_EQ(head.read, split - (split % 3 == 2 ? 1 : 0));
+		}
+
+		// spdlog formats with the same formatter, no temporary std::string
+		std::ostringstream stream;
+		spdlog::logger logger("osv", std::make_shared<spdlog::sinks::ostream_sink_st>(stream));
+		logger.set_pattern("%v");
+		logger.info("{} joined", string(u"玩家"));
+		EXPECT_EQ(stream.str(), "玩家 joined\n");
+
+		{
+			const string str(long_text);
+			auto t0 = std::chrono::system_clock::now();
+			size_t size_temp = 0;
+			for (int i = 0; i < 20000; ++i) {
+				std::string temp;
+				EXPECT_TRUE(string_view(str.raw()).encode_to_utf8(temp));
+				size_temp += fmt::format("{}", temp).size();
+			}
+			auto t1 = std::chrono::system_clock::now();
+			size_t size_direct = 0;
+			for (int i = 0; i < 20000; ++i) {
+				size_direct += fmt::format("{}", str).size();
+			}
+			auto t2 = std::chrono::system_clock::now();
+			std::chrono::duration<float> delta_temp = t1 - t0;
+			std::chrono::duration<float> delta_direct = t2 - t1;
+			std::cout << delta_temp.count() << " " << delta_direct.count() << std::endl;
+			EXPECT_EQ(size_temp, size_direct);
+		}
+	}
+
+	TEST(osv, utf8_compare)
+	{
+		using namespace ostr;
+		using namespace ostr::literal;
+
+		// equal text of every length around a block
+		const std::u16string text = u"a long ascii prefix of the token, 中文 \U0001F601 then more ascii text";
+		std::string u8;
+		coder::convert_append(text, u8);
+		EXPECT_TRUE(coder::equals(u8, text));
+		EXPECT_EQ(coder::compare(u8, text), 0);
+		for (size_t n = 0; n < 40; ++n)
+		{
+			const std::u16string_view head = std::u16string_view(text).substr(0, n);
+			std::string head8;
+			coder::convert_append(head, head8);
+			EXPECT_TRUE(coder::equals(head8, head)) << n;
+			EXPECT_LT(coder::compare(head8, text), 0) << n;
+			EXPECT_GT(coder::compare(u8, head), 0) << n;
+		}
+
+		// a difference anywhere, in either direction
+		for (size_t i = 0; i < 40; ++i)
+		{
+			std::u16string other = text;
+			other[i] = char16_t(other[i] + 1);
+			EXPECT_FALSE(coder::equals(u8, other)) << i;
+			EXPECT_LT(coder::compare(u8, other), 0) << i;
+		}
+
+		// code point order, a pair sorts after the rest of the first plane unlike code units
+		EXPECT_GT(compare(u8"\U0001F601", u"�"), 0);
+		EXPECT_LT(compare(u8"�", u"\U0001F601"), 0);
+		EXPECT_LT(compare("abc", u"abd"), 0);
+		EXPECT_GT(compare("abd", u"abc"), 0);
+		EXPECT_EQ(compare("", u""), 0);
+		EXPECT_TRUE(equals(u8"我™C𪚥😘", u"我™C𪚥😘"_o));
+		EXPECT_TRUE(equals(u8"我", string(u"我")));
+		EXPECT_FALSE(equals(u8"我", u"我们"_o));
+
+		// ill-formed on either side compares as U+FFFD
+		EXPECT_TRUE(equals("a\xFF" "b", u"a�" "b"));
+		EXPECT_TRUE(equals("a\xE4\xB8" "b", u"a�" "b"));
+		EXPECT_TRUE(equals(u8"a�", std::u16string_view(u"a\xD800", 2)));
+
+		// benchmark: against decoding the token first
+		{
+			std::u16string stored;
+			for (int i = 0; i < 100; ++i)
+				stored += u"session-token-0123456789abcdef-";
+			std::string token;
+			coder::convert_append(stored, token);
+			size_t sink = 0;
+
+			auto t0 = std::chrono::system_clock::now();
+			for (int n = 0; n < 20000; ++n)
+				sink += coder::equals(token, stored);
+			auto t1 = std::chrono::system_clock::now();
+			for (int n = 0; n < 20000; ++n)
+			{
+				std::u16string decoded;
+				coder::convert_append(token, decoded);
+				sink += decoded == stored;
+			}
+			auto t2 = std::chrono::system_clock::now();
+
+			std::chrono::duration<float> delta_direct = t1 - t0;
+			std::chrono::duration<float> delta_decode = t2 - t1;
+			std::cout << delta_direct.count() << " " << delta_decode.count() << std::endl;
+			EXPECT_EQ(sink, 40000u);
+		}
+	}
+
+	TEST(osv, u8string)
+	{
+		using namespace ostr;
+		using namespace ostr::literal;
+
+		// counting against the decoder, around the 16 byte blocks
+		const std::string_view sample = u8"我™C𪚥😘 abc 玩家";
+		for (size_t n = 0; n < 70; ++n)
+		{
+			std::string text;
+			std::u16string text16;
+			while (text.size() < n * 3)
+				text += sample;
+			text.resize(n * 3);
+			// cut back to a whole code point
+			while (!text.empty() && (uint8_t(text.back()) & 0xC0) == 0x80)
+				text.pop_back();
+			if (!text.empty() && uint8_t(text.back()) >= 0xC0)
+				text.pop_back();
+			coder::convert_append(text, text16);
+			const string s16(text16);
+			const u8string_view sv8(text);
+			EXPECT_EQ(sv8.length(), s16.length()) << n;
+			for (size_t i = 0; i <= s16.length(); ++i)
+			{
+				EXPECT_EQ(sv8.substring(i).to_utf16(), s16.to_sv().substring(i)) << n << " " << i;
+				EXPECT_EQ(sv8.left(i).length(), i) << n << " " << i;
+			}
+		}
+
+		// a view ending in a cut sequence, the bytes after it are not read
+		{
+			const char bytes[] = "a\xE4\xBD\xA0";
+			const u8string_view cut(bytes, 3);
+			std::vector<codepoint> cps;
+			for (auto it = cut.begin(); it != cut.end(); ++it)
+				cps.push_back(*it);
+			EXPECT_EQ(cps, (std::vector<codepoint>{ U'a', 0xFFFD }));
+			const u8string_view lead(bytes, 2);
+			auto it = lead.begin();
+			++it;
+			EXPECT_EQ(*it, codepoint(0xFFFD));
+			EXPECT_EQ(it.get_origin_length(), 1u);
+			EXPECT_TRUE(++it == lead.end());
+		}
+
+		const u8string str = u8"我™C𪚥😘玩家C😘";
+		EXPECT_EQ(str.length(), 9u);
+		EXPECT_EQ(str.raw().size(), 26u);
+		EXPECT_EQ(str.substring(3, 2), u8string(u8"𪚥😘"));
+		EXPECT_EQ(str.substring(7), u8string(u8"C😘"));
+		EXPECT_EQ(str.substring(9), u8string());
+		EXPECT_EQ(str.to_sv().right(2), u8"C😘"_u8);
+		EXPECT_EQ(str.to_sv().remove_suffix(7), u8"我™"_u8);
+		EXPECT_EQ(str.to_sv().remove_prefix(100), ""_u8);
+		EXPECT_EQ(str.index_of(u8"😘"), 4u);
+		EXPECT_EQ(str.index_of(u8"😘", 5), 8u);
+		EXPECT_EQ(str.last_index_of(u8"C"), 7u);
+		EXPECT_EQ(str.index_of(u8"c", 0, SIZE_MAX, case_sensitivity::insensitive), 2u);
+		EXPECT_EQ(str.index_of(u8"c"), SIZE_MAX);
+		EXPECT_EQ(str.to_sv().search([](codepoint cp) { return cp == U'家'; }), 6u);
+		EXPECT_TRUE(str.to_sv().start_with(u8"我™"));
+		EXPECT_TRUE(str.to_sv().end_with(u8"😘"));
+
+		// iterators yield code points
+		std::u32string decoded;
+		for (codepoint cp : str)
+			decoded += char32_t(cp);
+		EXPECT_EQ(decoded, U"我™C𪚥😘玩家C😘");
+		EXPECT_EQ(str.to_sv().end() - str.to_sv().begin(), 9u);
+
+		std::vector<u8string_view> parts;
+		EXPECT_EQ(u8"玩家::😘::::C"_u8.split(u8"::", parts, true), 3u);
+		ASSERT_EQ(parts.size(), 3u);
+		EXPECT_EQ(parts[0], u8"玩家"_u8);
+		EXPECT_EQ(parts[1], u8"😘"_u8);
+		EXPECT_EQ(parts[2], u8"C"_u8);
+
+		u8string padded = u8"  玩家 ";
+		EXPECT_EQ(padded.trim_copy(), u8string(u8"玩家"));
+		padded.trim_start();
+		EXPECT_EQ(padded, u8string(u8"玩家 "));
+		EXPECT_EQ(padded.replace_copy(u8"家", u8"家们"), u8string(u8"玩家们 "));
+
+		EXPECT_EQ(u8string(u8"{} 有 {} 个").format(u8"玩家", 3), u8string(u8"玩家 有 3 个"));
+		// fmt counts a cjk character as two columns
+		EXPECT_EQ(fmt::format("[{:>4}]", u8"玩"_u8), std::string(u8"[  玩]"));
+		EXPECT_EQ(ofmt::format(u"{0}/{1}", u8"玩家"_u8, str), u"玩家/我™C𪚥😘玩家C😘");
+
+		// to and from the utf-16 types
+		const string s16 = str.to_utf16();
+		EXPECT_EQ(s16, string(u"我™C𪚥😘玩家C😘"));
+		EXPECT_EQ(u8string(s16), str);
+		EXPECT_EQ(u8string(u"a😘"_o).raw(), std::string_view(u8"a😘"));
+		EXPECT_TRUE(equals(str.raw(), s16.to_sv()));
+
+		// benchmark: counting against decoding
+		{
+			std::string text;
+			for (int i = 0; i < 1000; ++i)
+				text += sample;
+			size_t sink = 0;
+
+			auto t0 = std::chrono::system_clock::now();
+			for (int n = 0; n < 1000; ++n)
+				sink += u8string_view(text).length();
+			auto t1 = std::chrono::system_clock::now();
+			for (int n = 0; n < 1000; ++n)
+			{
+				const u8string_view sv(text);
+				for (auto it = sv.begin(); it != sv.end(); ++it)
+					++sink;
+			}
+			auto t2 = std::chrono::system_clock::now();
+
+			std::chrono::duration<float> delta_count = t1 - t0;
+			std::chrono::duration<float> delta_decode = t2 - t1;
+			std::cout << delta_count.count() << " " << delta_decode.count() << std::endl;
+			EXPECT_EQ(sink, 2u * 1000u * 1000u * u8string_view(sample).length());
+		}
+	}
+}